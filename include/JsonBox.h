@@ -10,13 +10,12 @@
  *
  * Things it does:
  * * Follows the standards established on [http://json.org/](http://json.org/)
- * * Read and write JSON in UTF-8
+ * * Read JSON in UTF-8, UTF-16 or UTF-32 and write it in UTF-8
  * * Uses the STL streams for input and output
  * * Generated JSON can be indented and pretty or compact and hard-to-read
  * * Does not crash when the JSON input contains errors, it simply tries to interpret as much as it can
  *
  * Things it does not do:
- * * Read JSON in UTF-16 or UTF-32
  * * Keep the order of the members in objects (the standard doesn't require keeping the order)
  * * Write useful error messages when the JSON input contains errors
  *
@@ -24,6 +23,15 @@
  * @see JsonBox
  */
 
+#include <JsonBox/CborStreamWriter.h>
+#include <JsonBox/CompressedStream.h>
+#include <JsonBox/Convert.h>
+#include <JsonBox/JsonIndex.h>
+#include <JsonBox/Parser.h>
+#include <JsonBox/Projection.h>
+#include <JsonBox/Snapshot.h>
+#include <JsonBox/TranscodingStream.h>
+#include <JsonBox/Validator.h>
 #include <JsonBox/Value.h>
 
 #endif
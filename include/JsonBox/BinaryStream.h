@@ -0,0 +1,360 @@
+#ifndef JB_BINARY_STREAM_H
+#define JB_BINARY_STREAM_H
+
+#include <cfloat>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <stdint.h>
+
+#include <JsonBox/JsonParsingError.h>
+
+namespace JsonBox {
+	/**
+	 * Byte sink appending to a string. The binary encoders are written
+	 * against sinks so the same code writes to a buffer or to a stream.
+	 * @see JsonBox::StreamSink
+	 */
+	class StringSink {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param newDestination String the bytes are appended to.
+		 */
+		explicit StringSink(std::string &newDestination) :
+			destination(newDestination) {
+		}
+
+		/**
+		 * Appends a byte.
+		 * @param byte Byte to append.
+		 */
+		void put(uint8_t byte) {
+			destination.push_back(static_cast<char>(byte));
+		}
+
+		/**
+		 * Appends a block of bytes.
+		 * @param bytes Pointer to the first byte of the block.
+		 * @param size Number of bytes in the block.
+		 */
+		void write(const char *bytes, size_t size) {
+			destination.append(bytes, size);
+		}
+
+	private:
+		/// String the bytes are appended to.
+		std::string &destination;
+	};
+
+	/**
+	 * Byte sink writing to an output stream.
+	 * @see JsonBox::StringSink
+	 */
+	class StreamSink {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param newDestination Output stream the bytes are written to.
+		 */
+		explicit StreamSink(std::ostream &newDestination) :
+			destination(newDestination) {
+		}
+
+		/**
+		 * Writes a byte.
+		 * @param byte Byte to write.
+		 */
+		void put(uint8_t byte) {
+			destination.put(static_cast<char>(byte));
+		}
+
+		/**
+		 * Writes a block of bytes.
+		 * @param bytes Pointer to the first byte of the block.
+		 * @param size Number of bytes in the block.
+		 */
+		void write(const char *bytes, size_t size) {
+			destination.write(bytes, static_cast<std::streamsize>(size));
+		}
+
+	private:
+		/// Output stream the bytes are written to.
+		std::ostream &destination;
+	};
+
+	/**
+	 * Byte source reading from a block of memory. Throws a JsonParsingError
+	 * when reading past the end of the block.
+	 * @see JsonBox::StreamSource
+	 */
+	class MemorySource {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param data Pointer to the first byte of the block to read.
+		 * @param size Number of bytes in the block.
+		 */
+		MemorySource(const char *data, size_t size) : current(data),
+			end(data + size) {
+		}
+
+		/**
+		 * Reads a byte.
+		 * @return Byte read.
+		 */
+		uint8_t get() {
+			require(1);
+			return static_cast<uint8_t>(*current++);
+		}
+
+		/**
+		 * Reads a block of bytes.
+		 * @param bytes Pointer to where the bytes are copied.
+		 * @param size Number of bytes to read.
+		 */
+		void read(char *bytes, size_t size) {
+			require(size);
+			std::memcpy(bytes, current, size);
+			current += size;
+		}
+
+		/**
+		 * Reads a block of bytes into a string.
+		 * @param result String replaced by the bytes read.
+		 * @param size Number of bytes to read.
+		 */
+		void read(std::string &result, size_t size) {
+			require(size);
+			result.assign(current, size);
+			current += size;
+		}
+
+		/**
+		 * Makes sure there are enough bytes left for the given number of
+		 * elements, each element using at least one byte. Used to reject
+		 * corrupted sizes before allocating for them.
+		 * @param count Number of elements announced.
+		 */
+		void requireElements(uint64_t count) {
+			require(count);
+		}
+
+	private:
+		/**
+		 * Throws a JsonParsingError if there are fewer bytes left than
+		 * required.
+		 * @param size Number of bytes required.
+		 */
+		void require(uint64_t size) const {
+			if (size > static_cast<uint64_t>(end - current)) {
+				throw JsonParsingError("Binary input ends incorrectly.");
+			}
+		}
+
+		/// Pointer to the next byte to read.
+		const char *current;
+
+		/// Pointer past the last byte of the block.
+		const char *end;
+	};
+
+	/**
+	 * Byte source reading from an input stream. Throws a JsonParsingError
+	 * when the stream ends before the value does.
+	 * @see JsonBox::MemorySource
+	 */
+	class StreamSource {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param newInput Input stream to read from.
+		 */
+		explicit StreamSource(std::istream &newInput) : input(*newInput.rdbuf()) {
+		}
+
+		/**
+		 * Reads a byte.
+		 * @return Byte read.
+		 */
+		uint8_t get() {
+			std::streambuf::int_type result = input.sbumpc();
+
+			if (result == std::streambuf::traits_type::eof()) {
+				throw JsonParsingError("Binary input ends incorrectly.");
+			}
+
+			return static_cast<uint8_t>(result);
+		}
+
+		/**
+		 * Reads a block of bytes.
+		 * @param bytes Pointer to where the bytes are copied.
+		 * @param size Number of bytes to read.
+		 */
+		void read(char *bytes, size_t size) {
+			if (input.sgetn(bytes, static_cast<std::streamsize>(size)) != static_cast<std::streamsize>(size)) {
+				throw JsonParsingError("Binary input ends incorrectly.");
+			}
+		}
+
+		/**
+		 * Reads a block of bytes into a string. Large blocks are read in
+		 * pieces so a corrupted size can't allocate more than what the
+		 * stream actually contains.
+		 * @param result String replaced by the bytes read.
+		 * @param size Number of bytes to read.
+		 */
+		void read(std::string &result, size_t size) {
+			static const size_t PIECE_SIZE = 65536;
+			result.clear();
+
+			while (result.size() < size) {
+				size_t offset = result.size();
+				size_t pieceSize = (size - offset < PIECE_SIZE) ? (size - offset) : (PIECE_SIZE);
+				result.resize(offset + pieceSize);
+				read(&result[offset], pieceSize);
+			}
+		}
+
+		/**
+		 * Does nothing, the size of a stream is not known in advance.
+		 * @param count Number of elements announced.
+		 */
+		void requireElements(uint64_t /*count*/) {
+		}
+
+	private:
+		/// Streambuf of the input stream.
+		std::streambuf &input;
+	};
+
+	/// Maximum nesting depth of the arrays and maps read by the binary
+	/// decoders, which recurse once per level. The same as the JSON
+	/// parser's default depth.
+	const unsigned int BINARY_MAXIMUM_DEPTH = 1024;
+
+	/**
+	 * Throws a JsonParsingError if an array or a map is nested deeper than
+	 * BINARY_MAXIMUM_DEPTH, so hostile input can't overflow the stack.
+	 * @param depth Number of arrays and maps containing the new one.
+	 */
+	inline void requireDepth(unsigned int depth) {
+		if (depth >= BINARY_MAXIMUM_DEPTH) {
+			throw JsonParsingError("Binary value exceeds the maximum nesting depth.");
+		}
+	}
+
+	/**
+	 * Writes an unsigned integer in big-endian byte order.
+	 * @param sink Sink to write the bytes to.
+	 * @param value Integer to write.
+	 * @param size Number of bytes to write, from 1 to 8.
+	 */
+	template <typename Sink>
+	void putBigEndian(Sink &sink, uint64_t value, unsigned int size) {
+		char bytes[8];
+
+		for (unsigned int i = size; i > 0; --i) {
+			bytes[i - 1] = static_cast<char>(value & 0xff);
+			value >>= 8;
+		}
+
+		sink.write(bytes, size);
+	}
+
+	/**
+	 * Reads an unsigned integer in big-endian byte order.
+	 * @param source Source to read the bytes from.
+	 * @param size Number of bytes to read, from 1 to 8.
+	 * @return Integer read.
+	 */
+	template <typename Source>
+	uint64_t getBigEndian(Source &source, unsigned int size) {
+		unsigned char bytes[8];
+		uint64_t result = 0;
+
+		source.read(reinterpret_cast<char *>(bytes), size);
+
+		for (unsigned int i = 0; i < size; ++i) {
+			result = (result << 8) | bytes[i];
+		}
+
+		return result;
+	}
+
+	/**
+	 * Reads an unsigned integer in big-endian byte order directly from
+	 * memory, without bounds checking.
+	 * @param bytes Pointer to the first byte of the integer.
+	 * @param size Number of bytes in the integer, from 1 to 8.
+	 * @return Integer read.
+	 */
+	inline uint64_t readBigEndian(const char *bytes, unsigned int size) {
+		uint64_t result = 0;
+
+		for (unsigned int i = 0; i < size; ++i) {
+			result = (result << 8) | static_cast<unsigned char>(bytes[i]);
+		}
+
+		return result;
+	}
+
+	/**
+	 * Gets the bits of a float.
+	 * @param value Float to get the bits of.
+	 * @return IEEE 754 single precision representation of the float.
+	 */
+	inline uint32_t floatToBits(float value) {
+		uint32_t result;
+		std::memcpy(&result, &value, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * Makes a float from its bits.
+	 * @param bits IEEE 754 single precision representation.
+	 * @return Float represented by the bits.
+	 */
+	inline float bitsToFloat(uint32_t bits) {
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * Gets the bits of a double.
+	 * @param value Double to get the bits of.
+	 * @return IEEE 754 double precision representation of the double.
+	 */
+	inline uint64_t doubleToBits(double value) {
+		uint64_t result;
+		std::memcpy(&result, &value, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * Makes a double from its bits.
+	 * @param bits IEEE 754 double precision representation.
+	 * @return Double represented by the bits.
+	 */
+	inline double bitsToDouble(uint64_t bits) {
+		double result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * Checks if a double can be stored in a float without losing precision.
+	 * @param value Double to check.
+	 * @return True if converting the double to a float and back gives the
+	 * same double.
+	 */
+	inline bool isExactFloat(double value) {
+		return value >= -FLT_MAX && value <= FLT_MAX &&
+		       static_cast<double>(static_cast<float>(value)) == value;
+	}
+}
+
+#endif
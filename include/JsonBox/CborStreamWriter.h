@@ -0,0 +1,114 @@
+#ifndef JB_CBOR_STREAM_WRITER_H
+#define JB_CBOR_STREAM_WRITER_H
+
+#include <ostream>
+#include <string>
+
+#include "Export.h"
+
+namespace JsonBox {
+	class Value;
+
+	/**
+	 * Writes CBOR (RFC 8949) item by item, without needing the whole
+	 * document as a Value. Arrays and maps can be started without knowing
+	 * their size, they are then written with indefinite lengths and must be
+	 * closed with end(). Map members are written as a key followed by its
+	 * value.
+	 * @see JsonBox::Value::writeCbor
+	 */
+	class JSONBOX_EXPORT CborStreamWriter {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param newOutput Output stream to write the items to.
+		 * @param newTypedArrays Specifies if arrays of numbers written with
+		 * writeValue(...) are written as RFC 8746 typed arrays.
+		 */
+		explicit CborStreamWriter(std::ostream &newOutput,
+		                          bool newTypedArrays = false);
+
+		/**
+		 * Writes a null item.
+		 */
+		void writeNull();
+
+		/**
+		 * Writes a boolean item.
+		 * @param boolean Boolean to write.
+		 */
+		void writeBoolean(bool boolean);
+
+		/**
+		 * Writes an integer item.
+		 * @param integer Integer to write.
+		 */
+		void writeInteger(int integer);
+
+		/**
+		 * Writes a floating point item, as a single precision float if it
+		 * doesn't lose precision.
+		 * @param number Double to write.
+		 */
+		void writeDouble(double number);
+
+		/**
+		 * Writes a text string item.
+		 * @param str String to write, in UTF-8.
+		 */
+		void writeString(const std::string &str);
+
+		/**
+		 * Writes a value and all its contents.
+		 * @param value Value to write.
+		 */
+		void writeValue(const Value &value);
+
+		/**
+		 * Starts an array of unknown size. Must be closed with end().
+		 */
+		void beginArray();
+
+		/**
+		 * Starts an array of known size. The array ends by itself once its
+		 * elements are written, end() must not be called for it.
+		 * @param size Number of elements in the array.
+		 */
+		void beginArray(size_t size);
+
+		/**
+		 * Starts a map of unknown size. Must be closed with end().
+		 */
+		void beginMap();
+
+		/**
+		 * Starts a map of known size. The map ends by itself once its
+		 * members are written, end() must not be called for it.
+		 * @param size Number of members in the map.
+		 */
+		void beginMap(size_t size);
+
+		/**
+		 * Closes the last array or map started without a size. Throws a
+		 * JsonWritingError if there is none left open.
+		 */
+		void end();
+
+		/**
+		 * Gets the number of arrays and maps of unknown size still open.
+		 * @return Number of containers that end() can close.
+		 */
+		unsigned int getOpenContainerCount() const;
+	private:
+		/// Output stream the items are written to.
+		std::ostream &output;
+
+		/// Specifies if arrays of numbers are written as typed arrays.
+		bool typedArrays;
+
+		/// Number of arrays and maps of unknown size still open.
+		unsigned int openContainerCount;
+	};
+}
+
+#endif
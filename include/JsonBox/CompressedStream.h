@@ -0,0 +1,244 @@
+#ifndef JB_COMPRESSED_STREAM_H
+#define JB_COMPRESSED_STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Export.h"
+
+namespace JsonBox {
+	/**
+	 * Compression formats of the compressed streams. The formats available
+	 * depend on the libraries JsonBox was built with: gzip needs zlib and
+	 * zstd needs libzstd.
+	 */
+	class JSONBOX_EXPORT Compression {
+	public:
+		enum Format {
+			NONE,
+			GZIP,
+			ZSTD
+		};
+
+		/**
+		 * Gets the compression format of a file from its extension.
+		 * @param filePath Path to the file, like "data.json.gz".
+		 * @return GZIP for ".gz", ZSTD for ".zst" and NONE otherwise.
+		 */
+		static Format getFormat(const std::string &filePath);
+
+		/**
+		 * Checks if JsonBox was built with support for a compression format.
+		 * @param format Compression format to check.
+		 * @return True if streams using the format can be created.
+		 */
+		static bool isSupported(Format format);
+	};
+
+	/**
+	 * Streambuf decompressing the data read from another streambuf. The
+	 * compressed data is read and decompressed in large blocks, as the
+	 * characters are needed. Throws a JsonParsingError when the compressed
+	 * data is corrupted or ends before the compressed stream does.
+	 * Concatenated gzip members and zstd frames are read as a single
+	 * stream.
+	 * @see JsonBox::DecompressingInputStream
+	 */
+	class JSONBOX_EXPORT DecompressingStreambuf : public std::streambuf {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * format isn't supported.
+		 * @param newSource Streambuf to read the compressed data from.
+		 * @param format Compression format of the data.
+		 */
+		DecompressingStreambuf(std::streambuf *newSource,
+		                       Compression::Format format);
+
+		/**
+		 * Destructor.
+		 */
+		virtual ~DecompressingStreambuf();
+
+	protected:
+		/**
+		 * Decompresses the next block of characters.
+		 * @return Next character, or traits::eof() at the end of the
+		 * compressed stream.
+		 */
+		virtual int_type underflow();
+
+	private:
+		class Decoder;
+
+		/**
+		 * Copy constructor, not implemented to prevent copies.
+		 */
+		DecompressingStreambuf(const DecompressingStreambuf &src);
+
+		/**
+		 * Assignment operator, not implemented to prevent copies.
+		 */
+		DecompressingStreambuf &operator=(const DecompressingStreambuf &src);
+
+		/// Streambuf the compressed data is read from.
+		std::streambuf *source;
+
+		/// Decoder of the compression format.
+		Decoder *decoder;
+
+		/// Block of compressed data read from the source.
+		std::vector<char> input;
+
+		/// Next compressed character to decompress in the input block.
+		const char *inputNext;
+
+		/// End of the compressed characters in the input block.
+		const char *inputEnd;
+
+		/// Block of decompressed characters, after a putback area.
+		std::vector<char> output;
+	};
+
+	/**
+	 * Streambuf compressing the data written to it into another streambuf.
+	 * The characters are buffered and compressed in large blocks. The
+	 * compressed stream has to be finished by calling finish(), which the
+	 * destructor does if it wasn't done. Throws a JsonWritingError when the
+	 * destination streambuf fails.
+	 * @see JsonBox::CompressingOutputStream
+	 */
+	class JSONBOX_EXPORT CompressingStreambuf : public std::streambuf {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * format isn't supported.
+		 * @param newDestination Streambuf to write the compressed data to.
+		 * @param format Compression format to use, can't be NONE.
+		 */
+		CompressingStreambuf(std::streambuf *newDestination,
+		                     Compression::Format format);
+
+		/**
+		 * Destructor. Finishes the compressed stream if it wasn't done,
+		 * ignoring the errors.
+		 */
+		virtual ~CompressingStreambuf();
+
+		/**
+		 * Compresses the buffered characters and ends the compressed stream.
+		 * Nothing can be written after.
+		 */
+		void finish();
+
+	protected:
+		/**
+		 * Compresses the buffered characters to make room for more.
+		 * @param ch Character that didn't fit in the buffer.
+		 * @return Unspecified value not equal to traits::eof() on success,
+		 * traits::eof() on failure.
+		 */
+		virtual int_type overflow(int_type ch);
+
+		/**
+		 * Compresses the buffered characters and flushes the compressor,
+		 * so everything written so far can be decompressed.
+		 * @return 0 on success, -1 on failure.
+		 */
+		virtual int sync();
+
+	private:
+		class Encoder;
+
+		/**
+		 * How far the compression of the buffered characters goes.
+		 */
+		enum FlushMode {
+			NO_FLUSH,
+			SYNC_FLUSH,
+			FINISH
+		};
+
+		/**
+		 * Copy constructor, not implemented to prevent copies.
+		 */
+		CompressingStreambuf(const CompressingStreambuf &src);
+
+		/**
+		 * Assignment operator, not implemented to prevent copies.
+		 */
+		CompressingStreambuf &operator=(const CompressingStreambuf &src);
+
+		/**
+		 * Compresses the buffered characters into the destination.
+		 * @param mode Specifies if the compressor is also flushed or if the
+		 * compressed stream is ended.
+		 */
+		void compressBuffer(FlushMode mode);
+
+		/// Streambuf the compressed data is written to.
+		std::streambuf *destination;
+
+		/// Encoder of the compression format, NULL once finished.
+		Encoder *encoder;
+
+		/// Block of characters waiting to be compressed.
+		std::vector<char> input;
+
+		/// Block of compressed data to write to the destination.
+		std::vector<char> output;
+	};
+
+	/**
+	 * Input stream decompressing the data read from another input stream.
+	 * Its exception mask includes badbit, so decompression errors are
+	 * thrown to the reader instead of looking like the end of the stream.
+	 * @see JsonBox::DecompressingStreambuf
+	 */
+	class JSONBOX_EXPORT DecompressingInputStream : public std::istream {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param source Input stream to read the compressed data from.
+		 * @param format Compression format of the data.
+		 */
+		DecompressingInputStream(std::istream &source,
+		                         Compression::Format format);
+
+	private:
+		/// Streambuf doing the decompression.
+		DecompressingStreambuf buffer;
+	};
+
+	/**
+	 * Output stream compressing the data written to it into another output
+	 * stream. Its exception mask includes badbit, so compression errors are
+	 * thrown to the writer.
+	 * @see JsonBox::CompressingStreambuf
+	 */
+	class JSONBOX_EXPORT CompressingOutputStream : public std::ostream {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param destination Output stream to write the compressed data to.
+		 * @param format Compression format to use, can't be NONE.
+		 */
+		CompressingOutputStream(std::ostream &destination,
+		                        Compression::Format format);
+
+		/**
+		 * Ends the compressed stream. Nothing can be written after.
+		 * @see JsonBox::CompressingStreambuf::finish
+		 */
+		void finish();
+
+	private:
+		/// Streambuf doing the compression.
+		CompressingStreambuf buffer;
+	};
+}
+
+#endif
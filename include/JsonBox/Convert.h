@@ -1,19 +1,58 @@
 #ifndef JB_CONVERTER_H
 #define JB_CONVERTER_H
 
+#include <cstddef>
 #include <vector>
 #include <string>
 #include <stdint.h>
 
+#include "Export.h"
+
 namespace JsonBox {
-	
+
 	typedef std::vector<int32_t> String32;
 
+	typedef std::vector<uint16_t> String16;
+
 	/**
 	 * This class is used to encode/decode/transcode UTF8, 16 and 32.
+	 *
+	 * Only well-formed UTF-8 is accepted, as defined by the Unicode
+	 * standard: no overlong sequences, no surrogates and nothing above
+	 * U+10FFFF. The invalid sequences and code points met while converting
+	 * are replaced by U+FFFD. Runs of ASCII characters are processed by
+	 * blocks of 16 bytes.
 	 */
-	class Convert {
+	class JSONBOX_EXPORT Convert {
 	public:
+		/// Code point replacing the invalid sequences and code points.
+		static const int32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+		/**
+		 * Validates a block of UTF-8 without decoding it.
+		 * @param utf8 Pointer to the first byte to validate.
+		 * @param size Number of bytes to validate.
+		 * @return Number of bytes before the first invalid or truncated
+		 * sequence, equal to size if all the bytes are valid UTF-8.
+		 */
+		static size_t validateUTF8(const char *utf8, size_t size);
+
+		/**
+		 * Checks if the given string is valid UTF-8.
+		 * @param utf8String String to validate.
+		 * @return True if the string is valid UTF-8, false if not.
+		 * @see JsonBox::Convert::validateUTF8
+		 */
+		static bool isValidUTF8(const std::string &utf8String);
+
+		/**
+		 * Appends a code point encoded in UTF-8 to a string.
+		 * @param codePoint Code point to encode, replaced by U+FFFD if it is
+		 * a surrogate or is out of the Unicode range.
+		 * @param utf8String String receiving the code point's bytes.
+		 */
+		static void appendUTF8(int32_t codePoint, std::string &utf8String);
+
 		/**
 		 * Encode the given UTF32 string to a 8bit UTF8 one.
 		 * @param utf32String UTF32 string to convert to UTF8.
@@ -21,12 +60,28 @@ namespace JsonBox {
 		 */
 		static std::string encodeToUTF8(const String32& utf32String);
 
+		/**
+		 * Encode the given UTF16 string to a 8bit UTF8 one. The unpaired
+		 * surrogates are replaced by U+FFFD.
+		 * @param utf16String UTF16 string to convert to UTF8.
+		 * @return UTF8 string resulting from the conversion.
+		 */
+		static std::string encodeToUTF8(const String16& utf16String);
+
 		/**
 		 * Decode the given 8bit UTF8 string to an UTF32 string.
 		 * @param utf8String UTF8 string to convert to UTF32.
 		 * @return UTF32 string resulting from the conversion.
 		 */
 		static String32 decodeUTF8(const std::string& utf8String);
+
+		/**
+		 * Decode the given 8bit UTF8 string to an UTF16 string. The code
+		 * points above U+FFFF are encoded as surrogate pairs.
+		 * @param utf8String UTF8 string to convert to UTF16.
+		 * @return UTF16 string resulting from the conversion.
+		 */
+		static String16 decodeUTF8ToUTF16(const std::string& utf8String);
 	};
 }
 
@@ -1,6 +1,7 @@
 #ifndef JB_GRAMMAR_H
 #define JB_GRAMMAR_H
 
+#include <cstddef>
 #include <string>
 
 namespace JsonBox {
@@ -78,6 +79,98 @@ namespace JsonBox {
 			}
 		}
 	}
+
+	// Character classes, combined in CHARACTER_CLASSES.
+	namespace CharacterClass {
+		const unsigned char WHITESPACE = 0x01;
+		const unsigned char DIGIT = 0x02;
+		const unsigned char HEX_DIGIT = 0x04;
+		// Escaped by the minimum escaping: quotation mark, reverse solidus
+		// and control characters.
+		const unsigned char ESCAPED = 0x08;
+		// Escaped when all the characters are: ESCAPED and the solidus.
+		const unsigned char ESCAPED_ALL = 0x10;
+		const unsigned char STRUCTURAL = 0x20;
+		// Ends a number or a literal: whitespace, structural characters and
+		// quotation mark.
+		const unsigned char DELIMITER = 0x40;
+	}
+
+	// Classes of each byte, indexed by its unsigned value.
+	constexpr unsigned char CHARACTER_CLASSES[256] = {
+		0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x59, 0x59, 0x18, 0x18, 0x59, 0x18, 0x18, // 0x00
+		0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, // 0x10
+		0x41, 0x00, 0x58, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x10, // 0x20
+		0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x30
+		0x00, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x40
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x18, 0x60, 0x00, 0x00, // 0x50
+		0x00, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x60
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x60, 0x00, 0x00, // 0x70
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x80
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x90
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xa0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xb0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xc0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xd0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xe0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00  // 0xf0
+	};
+
+	// Letter of the short escape sequence of each byte, 0 for the bytes
+	// without one, which are escaped as \u00XX if they must be.
+	constexpr char ESCAPE_LETTERS[256] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 'b', 't', 'n', 0, 'f', 'r', 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '/',
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+	};
+
+	/**
+	 * Checks if a character belongs to one of several classes.
+	 * @param character Character to check.
+	 * @param classes Combination of CharacterClass flags.
+	 * @return True if the character is in one of the classes.
+	 */
+	inline bool isCharacterClass(char character, unsigned char classes) {
+		return (CHARACTER_CLASSES[static_cast<unsigned char>(character)] & classes) != 0;
+	}
+
+	/**
+	 * Gets the JSON escape sequence of a character.
+	 * @param character Character to escape.
+	 * @param sequence Receives the escape sequence, up to 6 characters.
+	 * @return Number of characters of the escape sequence, 2 or 6.
+	 */
+	inline size_t getEscapeSequence(char character, char *sequence) {
+		static const char HEX_DIGITS[] = "0123456789abcdef";
+		char letter = ESCAPE_LETTERS[static_cast<unsigned char>(character)];
+		sequence[0] = Strings::Json::Escape::BEGIN_ESCAPE;
+
+		if (letter != 0) {
+			sequence[1] = letter;
+			return 2;
+
+		} else {
+			sequence[1] = Strings::Json::Escape::BEGIN_UNICODE;
+			sequence[2] = '0';
+			sequence[3] = '0';
+			sequence[4] = HEX_DIGITS[(static_cast<unsigned char>(character) >> 4) & 0x0f];
+			sequence[5] = HEX_DIGITS[static_cast<unsigned char>(character) & 0x0f];
+			return 6;
+		}
+	}
 }
 
 #endif
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <streambuf>
 
+#include <JsonBox/Grammar.h>
+#include <JsonBox/OutputFilter.h>
+
 namespace JsonBox {
 	/**
 	 * Cancels indentations to a streambuf.
@@ -24,10 +27,39 @@ namespace JsonBox {
 		 */
 		std::streambuf::int_type operator()(std::streambuf &destination,
 		                                    std::streambuf::int_type character);
+
+		/**
+		 * Checks if a character must go through the indent canceller: the
+		 * whitespace can be removed, the quotation marks and the reverse solidi
+		 * change the string state.
+		 * @param character Character to check.
+		 * @return True if the character must go through operator()(...).
+		 */
+		bool isTrigger(char character) const {
+			return isCharacterClass(character, CharacterClass::WHITESPACE) ||
+			       character == Structural::BEGIN_END_STRING ||
+			       character == Strings::Json::Escape::BEGIN_ESCAPE;
+		}
 	private:
 		bool afterBackSlash;
 		bool inString;
 	};
+
+	/**
+	 * Filters a block of characters through an IndentCanceller. Only the
+	 * whitespace, quotation marks and reverse solidi go through it one at a time.
+	 * @param inserter IndentCanceller used to filter the characters.
+	 * @param destination Streambuf in which to insert the characters.
+	 * @param block Pointer to the first character of the block.
+	 * @param size Number of characters in the block.
+	 * @return Number of characters successfully filtered.
+	 * @see JsonBox::insertRuns
+	 */
+	inline std::streamsize insertBlock(IndentCanceller &inserter, std::streambuf &destination,
+	                                   const std::streambuf::char_type *block,
+	                                   std::streamsize size) {
+		return insertRuns(inserter, destination, block, size);
+	}
 }
 
 #endif
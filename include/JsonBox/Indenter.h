@@ -3,6 +3,9 @@
 
 #include <streambuf>
 
+#include <JsonBox/Grammar.h>
+#include <JsonBox/OutputFilter.h>
+
 namespace JsonBox {
 	/**
 	 * Adds a level of indentation to a streambuf.
@@ -24,10 +27,36 @@ namespace JsonBox {
 		 */
 		std::streambuf::int_type operator()(std::streambuf &destination,
 		                                    std::streambuf::int_type character);
+
+		/**
+		 * Checks if a character must go through the indenter: the first
+		 * character of each line is indented and the new lines start one.
+		 * @param character Character to check.
+		 * @return True if the character must go through operator()(...).
+		 */
+		bool isTrigger(char character) const {
+			return atStartOfLine || character == Whitespace::NEW_LINE;
+		}
 	private:
 		/// Used to indicate if we are at the start of a new line.
 		bool atStartOfLine;
 	};
+
+	/**
+	 * Filters a block of characters through an Indenter. Only the new lines and
+	 * the first character of each line go through it one at a time.
+	 * @param inserter Indenter used to filter the characters.
+	 * @param destination Streambuf in which to insert the characters.
+	 * @param block Pointer to the first character of the block.
+	 * @param size Number of characters in the block.
+	 * @return Number of characters successfully filtered.
+	 * @see JsonBox::insertRuns
+	 */
+	inline std::streamsize insertBlock(Indenter &inserter, std::streambuf &destination,
+	                                   const std::streambuf::char_type *block,
+	                                   std::streamsize size) {
+		return insertRuns(inserter, destination, block, size);
+	}
 }
 
 #endif
@@ -0,0 +1,120 @@
+#ifndef JB_JSON_INDEX_H
+#define JB_JSON_INDEX_H
+
+#include <string>
+#include <stdint.h>
+
+#include "Export.h"
+#include <JsonBox/MappedFile.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	/**
+	 * Index of the byte ranges of the values of a large JSON file, used to
+	 * load a single value without parsing the whole file. The index is
+	 * built once by scanning the file with build(...) and saved next to it.
+	 * Opening the index then maps both files in memory: looking up a value
+	 * is a binary search in the index and loading it only parses its own
+	 * bytes. Values are identified by their JSON Pointer (RFC 6901), like
+	 * "/records/42" or "/users/alice".
+	 */
+	class JSONBOX_EXPORT JsonIndex {
+	public:
+		/**
+		 * Scans a JSON file and writes the index of its values down to a
+		 * given depth. The scan only looks at the structure of the JSON, the
+		 * values are not parsed. Throws an std::invalid_argument if the JSON
+		 * file can't be opened, a JsonParsingError if its structure is
+		 * invalid or a JsonWritingError if the index can't be written.
+		 * @param jsonFilePath Path to the JSON file to index.
+		 * @param indexFilePath Path to the index file to write.
+		 * @param maximumDepth Depth of the deepest values indexed. 0 only
+		 * indexes the root, 1 also indexes its elements or members, etc.
+		 */
+		static void build(const std::string &jsonFilePath,
+		                  const std::string &indexFilePath,
+		                  unsigned int maximumDepth = 1);
+
+		/**
+		 * Parameterized constructor. Opens a JSON file and its index. Throws
+		 * an std::invalid_argument if a file can't be opened or a
+		 * JsonParsingError if the index is invalid or wasn't built from a
+		 * file of the JSON file's size.
+		 * @param jsonFilePath Path to the indexed JSON file.
+		 * @param indexFilePath Path to the index file.
+		 */
+		JsonIndex(const std::string &jsonFilePath,
+		          const std::string &indexFilePath);
+
+		/**
+		 * Gets the number of values in the index.
+		 * @return Number of indexed values.
+		 */
+		size_t getSize() const;
+
+		/**
+		 * Gets the JSON Pointer of an indexed value. Values are sorted by
+		 * JSON Pointer.
+		 * @param index Index of the value, from 0 to getSize() - 1.
+		 * @return JSON Pointer of the value, or an empty string if the index
+		 * is out of range.
+		 */
+		std::string getPointer(size_t index) const;
+
+		/**
+		 * Checks if a value is in the index.
+		 * @param pointer JSON Pointer of the value.
+		 * @return True if the value is indexed.
+		 */
+		bool contains(const std::string &pointer) const;
+
+		/**
+		 * Gets the byte range of a value in the JSON file.
+		 * @param pointer JSON Pointer of the value.
+		 * @param offset Receives the offset of the value's first byte.
+		 * @param size Receives the number of bytes of the value.
+		 * @return True if the value is indexed, false if it isn't and
+		 * nothing was received.
+		 */
+		bool getRange(const std::string &pointer, uint64_t &offset,
+		              uint64_t &size) const;
+
+		/**
+		 * Loads a value from the JSON file, parsing only its bytes.
+		 * @param pointer JSON Pointer of the value.
+		 * @param result Value replaced by the loaded value.
+		 * @return True if the value is indexed and was loaded, false if it
+		 * isn't indexed and the result wasn't changed.
+		 */
+		bool load(const std::string &pointer, Value &result) const;
+
+	private:
+		/**
+		 * Finds a value in the index.
+		 * @param pointer JSON Pointer of the value.
+		 * @return Position of the value's entry in the index file, or 0 if
+		 * it isn't indexed.
+		 */
+		uint64_t find(const std::string &pointer) const;
+
+		/**
+		 * Gets bytes of the index file, throws a JsonParsingError if they
+		 * are past its end.
+		 * @param position Offset of the first byte.
+		 * @param length Number of bytes needed.
+		 * @return Pointer to the first byte.
+		 */
+		const char *getBytes(uint64_t position, uint64_t length) const;
+
+		/// Content of the JSON file.
+		MappedFile jsonFile;
+
+		/// Content of the index file.
+		MappedFile indexFile;
+
+		/// Number of values in the index.
+		uint64_t entryCount;
+	};
+}
+
+#endif
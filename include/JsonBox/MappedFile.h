@@ -0,0 +1,72 @@
+#ifndef JB_MAPPED_FILE_H
+#define JB_MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "Export.h"
+
+namespace JsonBox {
+	/**
+	 * Read-only view of a whole file's content. The file is mapped in memory
+	 * when the platform supports it, so its pages are loaded on demand and
+	 * shared with the other processes mapping the same file. Otherwise, the
+	 * file is read into memory.
+	 */
+	class JSONBOX_EXPORT MappedFile {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * file can't be opened.
+		 * @param filePath Path to the file to map.
+		 */
+		explicit MappedFile(const std::string &filePath);
+
+		/**
+		 * Destructor. Unmaps the file.
+		 */
+		~MappedFile();
+
+		/**
+		 * Gets the file's content.
+		 * @return Pointer to the first byte of the file, NULL if it is empty.
+		 */
+		const char *getData() const;
+
+		/**
+		 * Gets the file's size.
+		 * @return Number of bytes in the file.
+		 */
+		size_t getSize() const;
+
+		/**
+		 * Checks if the file is mapped in memory or was read into memory.
+		 * @return True if the file is mapped in memory.
+		 */
+		bool isMapped() const;
+	private:
+		/**
+		 * Copy constructor, not implemented to prevent copies.
+		 */
+		MappedFile(const MappedFile &src);
+
+		/**
+		 * Assignment operator, not implemented to prevent copies.
+		 */
+		MappedFile &operator=(const MappedFile &src);
+
+		/// Pointer to the first byte of the file.
+		const char *data;
+
+		/// Number of bytes in the file.
+		size_t size;
+
+		/// Specifies if the data has to be unmapped.
+		bool mapped;
+
+		/// Content of the file when it couldn't be mapped.
+		std::vector<char> buffer;
+	};
+}
+
+#endif
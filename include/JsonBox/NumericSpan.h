@@ -0,0 +1,96 @@
+#ifndef JB_NUMERIC_SPAN_H
+#define JB_NUMERIC_SPAN_H
+
+#include <cstddef>
+
+namespace JsonBox {
+	/**
+	 * View of contiguous numbers owned by someone else, like the elements of
+	 * an array value using a typed storage. The view doesn't own the numbers
+	 * and is invalidated when the array it views is modified through the
+	 * value.
+	 * @tparam T Type of the numbers, const qualified for read-only views.
+	 * @see JsonBox::Value::getDoubleArray
+	 */
+	template <typename T>
+	class NumericSpan {
+	public:
+		typedef T value_type;
+		typedef T *iterator;
+		typedef T &reference;
+		typedef size_t size_type;
+
+		/**
+		 * Default constructor. Makes an empty view.
+		 */
+		NumericSpan() : first(NULL), count(0) {
+		}
+
+		/**
+		 * Parameterized constructor.
+		 * @param newFirst Pointer to the first number.
+		 * @param newCount Number of numbers in the view.
+		 */
+		NumericSpan(T *newFirst, size_t newCount) : first(newFirst),
+			count(newCount) {
+		}
+
+		/**
+		 * Gets the numbers viewed.
+		 * @return Pointer to the first number, NULL if the view is empty.
+		 */
+		T *data() const {
+			return first;
+		}
+
+		/**
+		 * Gets the number of numbers viewed.
+		 * @return Number of numbers in the view.
+		 */
+		size_t size() const {
+			return count;
+		}
+
+		/**
+		 * Checks if the view is empty.
+		 * @return True if there are no numbers in the view.
+		 */
+		bool empty() const {
+			return count == 0;
+		}
+
+		/**
+		 * Gets an iterator to the first number.
+		 * @return Pointer to the first number.
+		 */
+		T *begin() const {
+			return first;
+		}
+
+		/**
+		 * Gets an iterator past the last number.
+		 * @return Pointer past the last number.
+		 */
+		T *end() const {
+			return first + count;
+		}
+
+		/**
+		 * Accesses a number. The index is not checked.
+		 * @param index Index of the number.
+		 * @return Reference to the number.
+		 */
+		T &operator[](size_t index) const {
+			return first[index];
+		}
+
+	private:
+		/// Pointer to the first number.
+		T *first;
+
+		/// Number of numbers in the view.
+		size_t count;
+	};
+}
+
+#endif
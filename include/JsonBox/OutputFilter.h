@@ -7,6 +7,79 @@
 #include <streambuf>
 
 namespace JsonBox {
+	/**
+	 * Filters a block of characters through an inserter one character at a
+	 * time. Used by OutputFilter::xsputn for the inserters that don't provide
+	 * their own overload of this function.
+	 * @param inserter Inserter used to filter the characters.
+	 * @param destination Streambuf in which to insert the characters.
+	 * @param block Pointer to the first character of the block.
+	 * @param size Number of characters in the block.
+	 * @return Number of characters successfully filtered.
+	 * @see JsonBox::OutputFilter
+	 */
+	template <typename Inserter>
+	std::streamsize insertBlock(Inserter &inserter, std::streambuf &destination,
+	                            const std::streambuf::char_type *block,
+	                            std::streamsize size) {
+		std::streamsize result = 0;
+
+		while (result < size &&
+		       inserter(destination, std::streambuf::traits_type::to_int_type(block[result])) != std::streambuf::traits_type::eof()) {
+			++result;
+		}
+
+		return result;
+	}
+
+	/**
+	 * Filters a block of characters through an inserter that only needs to
+	 * see some of them. The inserters that use it tell which characters they
+	 * transform or that change their state with an isTrigger(char) function.
+	 * The first character of each run of other characters also goes through
+	 * the inserter, so its state is updated as if it had seen the whole run,
+	 * and the rest of the run is forwarded to the destination in a single
+	 * call.
+	 * @param inserter Inserter used to filter the characters.
+	 * @param destination Streambuf in which to insert the characters.
+	 * @param block Pointer to the first character of the block.
+	 * @param size Number of characters in the block.
+	 * @return Number of characters successfully filtered.
+	 * @see JsonBox::insertBlock
+	 */
+	template <typename Inserter>
+	std::streamsize insertRuns(Inserter &inserter, std::streambuf &destination,
+	                           const std::streambuf::char_type *block,
+	                           std::streamsize size) {
+		std::streamsize result = 0;
+
+		while (result < size) {
+			bool trigger = inserter.isTrigger(block[result]);
+
+			if (inserter(destination, std::streambuf::traits_type::to_int_type(block[result])) == std::streambuf::traits_type::eof()) {
+				return result;
+			}
+
+			++result;
+			std::streamsize end = result;
+
+			while (!trigger && end < size && !inserter.isTrigger(block[end])) {
+				++end;
+			}
+
+			if (end != result) {
+				std::streamsize written = destination.sputn(block + result, end - result);
+				result += written;
+
+				if (result != end) {
+					return result;
+				}
+			}
+		}
+
+		return result;
+	}
+
 	/**
 	 * Templated class used to filter output in an std::ostream. The custom
 	 * mechanic of the filtering is easily implemented in the given Inserter. An
@@ -73,6 +146,20 @@ namespace JsonBox {
 			return result ;
 		}
 
+		/**
+		 * Filters a block of characters. The block is handed to the
+		 * inserter's insertBlock(...) function, which lets inserters that
+		 * support it forward the runs of characters they don't transform in
+		 * a single call instead of one character at a time.
+		 * @param s Pointer to the first character of the block.
+		 * @param count Number of characters in the block.
+		 * @return Number of characters successfully filtered.
+		 * @see JsonBox::insertBlock
+		 */
+		virtual std::streamsize xsputn(const char_type *s, std::streamsize count) {
+			return (destination) ? (insertBlock(inserter, *destination, s, count)) : (0);
+		}
+
 		/**
 		 * Since it's an output filter, we don't need to do anything here.
 		 */
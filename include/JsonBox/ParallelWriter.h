@@ -0,0 +1,422 @@
+#ifndef JB_PARALLEL_WRITER_H
+#define JB_PARALLEL_WRITER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <JsonBox/Grammar.h>
+#include <JsonBox/Value.h>
+#include <JsonBox/Writer.h>
+
+namespace JsonBox {
+	/**
+	 * Writes values as JSON using several threads for the large arrays and
+	 * objects. The elements of a large container are split in consecutive
+	 * ranges, each range is written into a buffer by one of the threads of a
+	 * pool kept for the whole write, and the buffers are written to the
+	 * output in order as soon as they are ready, while the threads go on
+	 * with the next ranges. Only a few ranges per thread are in flight at
+	 * once, so the memory used stays proportional to the number of threads.
+	 * The output is exactly the same as the one of the Writer with the same
+	 * policies.
+	 * @tparam IndentPolicy Either JsonBox::Compact or a JsonBox::Pretty.
+	 * @tparam EscapePolicy Either JsonBox::MinimumEscaping or
+	 * JsonBox::AllEscaping.
+	 * @see JsonBox::Writer
+	 */
+	template <typename IndentPolicy, typename EscapePolicy>
+	class ParallelWriter {
+	public:
+		enum {
+			/// Containers with fewer elements than this are written sequentially.
+			MINIMUM_PARALLEL_SIZE = 8192,
+
+			/// Smallest number of elements given to a thread.
+			MINIMUM_CHUNK_SIZE = 256,
+
+			/// Number of ranges each thread gets in a large container.
+			CHUNKS_PER_THREAD = 8,
+
+			/// Number of ranges per thread written or waiting to be written.
+			CHUNKS_IN_FLIGHT_PER_THREAD = 2
+		};
+
+		/**
+		 * Writes a value as JSON.
+		 * @param output Output stream to write the value to.
+		 * @param value Value to write.
+		 * @param threadCount Maximum number of threads to use. 0 uses one
+		 * thread per hardware thread.
+		 */
+		static void write(std::ostream &output, const Value &value,
+		                  unsigned int threadCount = 0) {
+			if (threadCount == 0) {
+				threadCount = std::thread::hardware_concurrency();
+			}
+
+			if (threadCount <= 1) {
+				SequentialWriter::write(output, value);
+
+			} else {
+				std::streamsize precisionBackup = output.precision(17);
+				WorkerPool pool(threadCount);
+				writeValue(output, value, 0, pool);
+				output.precision(precisionBackup);
+			}
+		}
+
+	private:
+		typedef Writer<IndentPolicy, EscapePolicy> SequentialWriter;
+
+		/**
+		 * Threads writing the ranges of elements, started once per write.
+		 */
+		class WorkerPool {
+		public:
+			/**
+			 * Starts the threads.
+			 * @param newThreadCount Number of threads to start.
+			 */
+			explicit WorkerPool(unsigned int newThreadCount) : mutex(),
+				available(), finished(), tasks(), stopping(false), threads() {
+				threads.reserve(newThreadCount);
+
+				try {
+					for (unsigned int i = 0; i < newThreadCount; ++i) {
+						threads.push_back(std::thread(&WorkerPool::work, this));
+					}
+
+				} catch (...) {
+					stop();
+					throw;
+				}
+			}
+
+			/**
+			 * Destructor. Waits for the threads to end.
+			 */
+			~WorkerPool() {
+				stop();
+			}
+
+			/**
+			 * Gets the number of threads of the pool.
+			 * @return Number of threads.
+			 */
+			unsigned int getThreadCount() const {
+				return static_cast<unsigned int>(threads.size());
+			}
+
+			/**
+			 * Queues a task for the threads.
+			 * @param task Function to run.
+			 * @param done Flag set once the task has run, read with
+			 * waitFor(...).
+			 */
+			void submit(const std::function<void()> &task, bool &done) {
+				std::lock_guard<std::mutex> lock(mutex);
+				tasks.push_back(Task(task, &done));
+				available.notify_one();
+			}
+
+			/**
+			 * Waits for a task to have run.
+			 * @param done Flag given with the task.
+			 */
+			void waitFor(const bool &done) {
+				std::unique_lock<std::mutex> lock(mutex);
+
+				while (!done) {
+					finished.wait(lock);
+				}
+			}
+
+		private:
+			/// Function to run and flag to set once it has run.
+			typedef std::pair<std::function<void()>, bool *> Task;
+
+			/**
+			 * Copy constructor, not implemented to prevent copies.
+			 */
+			WorkerPool(const WorkerPool &src);
+
+			/**
+			 * Assignment operator, not implemented to prevent copies.
+			 */
+			WorkerPool &operator=(const WorkerPool &src);
+
+			/**
+			 * Runs the tasks queued until the pool is stopped. Run by the
+			 * threads.
+			 */
+			void work() {
+				std::unique_lock<std::mutex> lock(mutex);
+
+				for (;;) {
+					while (tasks.empty() && !stopping) {
+						available.wait(lock);
+					}
+
+					if (tasks.empty()) {
+						return;
+					}
+
+					Task task = tasks.front();
+					tasks.pop_front();
+					lock.unlock();
+					task.first();
+					lock.lock();
+					*task.second = true;
+					finished.notify_all();
+				}
+			}
+
+			/**
+			 * Stops the threads once the tasks queued have run and waits for
+			 * them to end.
+			 */
+			void stop() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+					available.notify_all();
+				}
+
+				for (std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i) {
+					i->join();
+				}
+
+				threads.clear();
+			}
+
+			/// Guards the tasks, the flags of the tasks and stopping.
+			std::mutex mutex;
+
+			/// Signaled when a task is queued or when the pool stops.
+			std::condition_variable available;
+
+			/// Signaled when a task has run.
+			std::condition_variable finished;
+
+			/// Tasks waiting for a thread.
+			std::deque<Task> tasks;
+
+			/// Specifies if the threads must end once the tasks have run.
+			bool stopping;
+
+			/// Threads running the tasks.
+			std::vector<std::thread> threads;
+		};
+
+		/**
+		 * Range of elements written into a buffer by the pool.
+		 */
+		struct Chunk {
+			/// Default constructor.
+			Chunk() : buffer(), error(), done(false) {
+			}
+
+			/// Text of the elements.
+			std::string buffer;
+
+			/// Exception thrown while writing the elements, if any.
+			std::exception_ptr error;
+
+			/// Specifies if the buffer is ready.
+			bool done;
+		};
+
+		/**
+		 * Writes a value, looking for large containers to split between the
+		 * threads.
+		 * @param output Output stream to write the value to.
+		 * @param value Value to write.
+		 * @param level Indentation level of the line the value starts on.
+		 * @param pool Threads to use.
+		 */
+		static void writeValue(std::ostream &output, const Value &value,
+		                       unsigned int level, WorkerPool &pool) {
+			if (value.isObject()) {
+				const Object &object = value.getObject();
+				output.put(Structural::BEGIN_OBJECT);
+				writeElements(output, object.begin(), object.end(), object.size(), level, pool);
+				output.put(Structural::END_OBJECT);
+
+			} else if (value.isArray() && value.getArrayStorage() == Value::GENERIC_ARRAY) {
+				const Array &array = value.getArray();
+				output.put(Structural::BEGIN_ARRAY);
+				writeElements(output, array.begin(), array.end(), array.size(), level, pool);
+				output.put(Structural::END_ARRAY);
+
+			} else {
+				SequentialWriter::writeValue(output, value, level);
+			}
+		}
+
+		/**
+		 * Writes the elements of a container, without its brackets.
+		 * @param output Output stream to write the elements to.
+		 * @param begin Iterator to the first element.
+		 * @param end Iterator past the last element.
+		 * @param size Number of elements in the container.
+		 * @param level Indentation level of the container.
+		 * @param pool Threads to use.
+		 */
+		template <typename Iterator>
+		static void writeElements(std::ostream &output, Iterator begin,
+		                          Iterator end, size_t size,
+		                          unsigned int level, WorkerPool &pool) {
+			if (size < MINIMUM_PARALLEL_SIZE) {
+				// The container is too small to be worth splitting, but its
+				// elements might be large containers.
+				for (Iterator i = begin; i != end; ++i) {
+					if (i != begin) {
+						output.put(Structural::VALUE_SEPARATOR);
+					}
+
+					IndentPolicy::writeNewLine(output, level + 1);
+					writeName(output, i);
+					writeValue(output, elementValue(i), level + 1, pool);
+				}
+
+			} else {
+				size_t threadCount = pool.getThreadCount();
+				size_t chunkSize = std::max<size_t>(MINIMUM_CHUNK_SIZE, size / (threadCount * CHUNKS_PER_THREAD));
+				size_t maximumInFlight = threadCount * CHUNKS_IN_FLIGHT_PER_THREAD;
+				std::deque<Chunk> chunks;
+				Iterator current = begin;
+				size_t remaining = size;
+
+				try {
+					while (remaining > 0 || !chunks.empty()) {
+						// We keep the threads busy with the next ranges.
+						while (chunks.size() < maximumInFlight && remaining > 0) {
+							size_t count = std::min(chunkSize, remaining);
+							Iterator chunkEnd = current;
+							std::advance(chunkEnd, count);
+							chunks.push_back(Chunk());
+							Chunk &chunk = chunks.back();
+							pool.submit(std::bind(&ParallelWriter::writeChunk<Iterator>,
+							                      std::ref(chunk), std::cref(output),
+							                      current, chunkEnd, current == begin,
+							                      level + 1), chunk.done);
+							current = chunkEnd;
+							remaining -= count;
+						}
+
+						// We write the ranges in order, while the threads
+						// write the following ones.
+						Chunk &chunk = chunks.front();
+						pool.waitFor(chunk.done);
+
+						if (chunk.error) {
+							std::rethrow_exception(chunk.error);
+						}
+
+						output.write(chunk.buffer.data(), chunk.buffer.size());
+						chunks.pop_front();
+					}
+
+				} catch (...) {
+					// The threads still reference the ranges in flight.
+					for (typename std::deque<Chunk>::iterator i = chunks.begin(); i != chunks.end(); ++i) {
+						pool.waitFor(i->done);
+					}
+
+					throw;
+				}
+			}
+
+			if (size > 0) {
+				IndentPolicy::writeNewLine(output, level);
+			}
+		}
+
+		/**
+		 * Writes a range of elements into a buffer. Run by the threads.
+		 * @param chunk Range receiving the text of the elements or the
+		 * exception thrown while writing them.
+		 * @param format Stream whose formatting settings are used.
+		 * @param begin Iterator to the first element of the range.
+		 * @param end Iterator past the last element of the range.
+		 * @param first True if the range starts at the container's first
+		 * element.
+		 * @param level Indentation level of the elements.
+		 */
+		template <typename Iterator>
+		static void writeChunk(Chunk &chunk, const std::ostream &format,
+		                       Iterator begin, Iterator end, bool first,
+		                       unsigned int level) {
+			try {
+				std::ostringstream text;
+				text.imbue(format.getloc());
+				text.flags(format.flags());
+				text.precision(format.precision());
+
+				for (Iterator i = begin; i != end; ++i) {
+					if (!first || i != begin) {
+						text.put(Structural::VALUE_SEPARATOR);
+					}
+
+					IndentPolicy::writeNewLine(text, level);
+					writeName(text, i);
+					SequentialWriter::writeValue(text, elementValue(i), level);
+				}
+
+				chunk.buffer = text.str();
+
+			} catch (...) {
+				chunk.error = std::current_exception();
+			}
+		}
+
+		/**
+		 * Writes nothing, array elements don't have names.
+		 * @param output Output stream.
+		 * @param element Iterator to the array element.
+		 */
+		static void writeName(std::ostream &/*output*/, Array::const_iterator /*element*/) {
+		}
+
+		/**
+		 * Writes an object member's name followed by the name separator.
+		 * @param output Output stream to write the name to.
+		 * @param element Iterator to the object member.
+		 */
+		static void writeName(std::ostream &output, Object::const_iterator element) {
+			SequentialWriter::writeString(output, element->first);
+			IndentPolicy::writeNameSeparator(output);
+		}
+
+		/**
+		 * Gets the value of an array element.
+		 * @param element Iterator to the array element.
+		 * @return Reference to the array element.
+		 */
+		static const Value &elementValue(Array::const_iterator element) {
+			return *element;
+		}
+
+		/**
+		 * Gets the value of an object member.
+		 * @param element Iterator to the object member.
+		 * @return Reference to the object member's value.
+		 */
+		static const Value &elementValue(Object::const_iterator element) {
+			return element->second;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef JB_PARSER_H
+#define JB_PARSER_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Export.h"
+#include <JsonBox/Validator.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	/**
+	 * Reusable JSON parser. Keeps its scratch buffers from one call to the
+	 * next, so a loop parsing many small documents with the same parser
+	 * stops allocating anything outside of the values built.
+	 *
+	 * Parsing into an existing Value reuses what it already holds: strings
+	 * keep their capacity, array elements are parsed in place and object
+	 * members with the same names are reused, the others being erased.
+	 * Parsing messages of a common shape into the same Value then only
+	 * allocates for what grows.
+	 *
+	 * The arrays containing only integers or only doubles can be given a
+	 * typed storage with setTypedArrays(...), as long as their numbers are
+	 * written back as they were read.
+	 *
+	 * The nested arrays and objects are tracked on a stack kept on the
+	 * heap, so the call stack used doesn't depend on the JSON. The nesting
+	 * depth and the size of the documents are limited, a JsonParsingError
+	 * being thrown past the limits.
+	 *
+	 * Short strings can also be interned: the string values read with the
+	 * same text then share one immutable storage, kept by the parser from
+	 * one document to the next, which saves memory when values like
+	 * statuses or country codes repeat. The values copy an interned string
+	 * before modifying it. The count of the values sharing a string is
+	 * atomic, so they can be copied and destroyed from several threads.
+	 * The number of strings kept by the parser is limited, the table being
+	 * emptied when it is full. Only the string values are interned: the
+	 * object members' names are the std::string keys of JsonBox::Object,
+	 * so each member owns its name. Parsing into a value that already
+	 * holds the members reuses their names instead of allocating new ones.
+	 * @see JsonBox::Value::loadFromStream
+	 */
+	class JSONBOX_EXPORT Parser {
+		friend class Value;
+	public:
+		/// Maximum nesting depth of the arrays and objects parsed, unless
+		/// changed with setMaximumDepth(...).
+		static const unsigned int DEFAULT_MAXIMUM_DEPTH = 1024;
+
+		/// Maximum number of strings kept interned, unless changed with
+		/// setMaximumInternedCount(...).
+		static const size_t DEFAULT_MAXIMUM_INTERNED_COUNT = 4096;
+
+		/**
+		 * Default constructor. The depth is limited to
+		 * DEFAULT_MAXIMUM_DEPTH, the size isn't limited, the strings aren't
+		 * interned, up to DEFAULT_MAXIMUM_INTERNED_COUNT of them being kept
+		 * once they are, and the arrays use the generic storage.
+		 */
+		Parser();
+
+		/**
+		 * Destructor.
+		 */
+		~Parser();
+
+		/**
+		 * Parses JSON from a block of memory, without copying it.
+		 * @param json Pointer to the first byte of the JSON.
+		 * @param size Number of bytes of the JSON.
+		 * @param result Value receiving the JSON's value.
+		 */
+		void parse(const char *json, size_t size, Value &result);
+
+		/**
+		 * Parses JSON from a string, without copying it.
+		 * @param json String containing the JSON.
+		 * @param result Value receiving the JSON's value.
+		 */
+		void parse(const std::string &json, Value &result);
+
+		/**
+		 * Parses JSON from an input stream.
+		 * @param input Input stream to read from.
+		 * @param result Value receiving the JSON's value.
+		 * @see JsonBox::Value::loadFromStream
+		 */
+		void parse(std::istream &input, Value &result);
+
+		/**
+		 * Parses JSON from a block of memory without throwing on invalid
+		 * JSON. The JSON is validated before being parsed, so a malformed
+		 * document is rejected without unwinding and without building
+		 * anything, only memory errors being thrown. UTF-16 and UTF-32 are
+		 * first converted to UTF-8, the positions of their errors then
+		 * being in the converted text.
+		 * @param json Pointer to the first byte of the JSON.
+		 * @param size Number of bytes of the JSON.
+		 * @param result Value receiving the JSON's value, left untouched if
+		 * the JSON is invalid.
+		 * @return Result of the validation, with the kind, the offset, the
+		 * line and the column of the error if the JSON is invalid.
+		 * @see JsonBox::validate
+		 */
+		ValidationResult tryParse(const char *json, size_t size,
+		                          Value &result);
+
+		/**
+		 * Parses JSON from a string without throwing on invalid JSON.
+		 * @param json String containing the JSON.
+		 * @param result Value receiving the JSON's value, left untouched if
+		 * the JSON is invalid.
+		 * @return Result of the validation.
+		 * @see JsonBox::Parser::tryParse(const char *, size_t, Value &)
+		 */
+		ValidationResult tryParse(const std::string &json, Value &result);
+
+		/**
+		 * Parses JSON from an input stream without throwing on invalid
+		 * JSON. The stream is read until its end into a buffer kept by the
+		 * parser. Errors of the stream itself are still thrown if its
+		 * exception mask asks for it.
+		 * @param input Input stream to read from.
+		 * @param result Value receiving the JSON's value, left untouched if
+		 * the JSON is invalid.
+		 * @return Result of the validation, TOO_LARGE if the stream is longer
+		 * than the maximum size.
+		 * @see JsonBox::Parser::tryParse(const char *, size_t, Value &)
+		 */
+		ValidationResult tryParse(std::istream &input, Value &result);
+
+		/**
+		 * Gets the maximum nesting depth of the arrays and objects parsed.
+		 * @return Maximum number of containers nested in each other.
+		 */
+		unsigned int getMaximumDepth() const;
+
+		/**
+		 * Sets the maximum nesting depth of the arrays and objects parsed.
+		 * The values built are copied, compared and written recursively,
+		 * so very deep documents are best rejected.
+		 * @param newMaximumDepth Maximum number of containers nested in
+		 * each other.
+		 */
+		void setMaximumDepth(unsigned int newMaximumDepth);
+
+		/**
+		 * Gets the maximum size of the documents parsed.
+		 * @return Maximum number of bytes of a document.
+		 */
+		size_t getMaximumSize() const;
+
+		/**
+		 * Sets the maximum size of the documents parsed. Streams are then
+		 * read in blocks, so past the end of the value.
+		 * @param newMaximumSize Maximum number of bytes of a document.
+		 */
+		void setMaximumSize(size_t newMaximumSize);
+
+		/**
+		 * Checks if the arrays of numbers are given a typed storage.
+		 * @return True if the typed arrays are enabled.
+		 */
+		bool getTypedArrays() const;
+
+		/**
+		 * Enables or disables the typed storage of the arrays of numbers.
+		 * When enabled, the arrays containing only integers use the
+		 * INT32_ARRAY storage and the arrays containing only doubles use the
+		 * DOUBLE_ARRAY storage. Their elements must then be read with the
+		 * typed accessors, getArray() throwing for them. The arrays with
+		 * a number that wouldn't be written back with the text it was read
+		 * from, like 1.10 or an integer too large for an int, keep the
+		 * generic storage, which keeps the text.
+		 * @param newTypedArrays Specifies if the arrays of numbers are given
+		 * a typed storage.
+		 * @see JsonBox::Value::getArrayStorage
+		 */
+		void setTypedArrays(bool newTypedArrays);
+
+		/**
+		 * Gets the maximum size of the strings interned.
+		 * @return Maximum number of bytes of the strings interned, 0 if the
+		 * strings aren't interned.
+		 */
+		size_t getMaximumInternedSize() const;
+
+		/**
+		 * Sets the maximum size of the strings interned. The string values
+		 * that aren't longer and have no escape sequences share their
+		 * storage with the other ones read with the same text. The object
+		 * members' names are the keys of std::map and aren't shared.
+		 * @param newMaximumInternedSize Maximum number of bytes of the
+		 * strings interned, 0 to stop interning.
+		 */
+		void setMaximumInternedSize(size_t newMaximumInternedSize);
+
+		/**
+		 * Gets the maximum number of strings kept interned.
+		 * @return Maximum number of distinct strings kept by the parser.
+		 */
+		size_t getMaximumInternedCount() const;
+
+		/**
+		 * Sets the maximum number of strings kept interned. When a new
+		 * string is read while the parser keeps that many, the strings
+		 * interned are forgotten, as with clearInternedStrings(), so the
+		 * memory used doesn't grow with the number of documents parsed.
+		 * @param newMaximumInternedCount Maximum number of distinct strings
+		 * kept by the parser.
+		 */
+		void setMaximumInternedCount(size_t newMaximumInternedCount);
+
+		/**
+		 * Gets the number of strings interned.
+		 * @return Number of distinct strings kept by the parser.
+		 */
+		size_t getInternedStringCount() const;
+
+		/**
+		 * Forgets the strings interned. The values still sharing them keep
+		 * them. Interning per document is done by calling it before each
+		 * parse.
+		 */
+		void clearInternedStrings();
+
+	private:
+		class MemoryInput;
+
+		/**
+		 * Hashes the interned strings by their text.
+		 */
+		struct StringHash {
+			/**
+			 * Hashes a string's text.
+			 * @param string String to hash.
+			 * @return Hash of the string's text.
+			 */
+			size_t operator()(const Value::String *string) const;
+		};
+
+		/**
+		 * Compares the interned strings by their text.
+		 */
+		struct StringEqual {
+			/**
+			 * Compares two strings' text.
+			 * @param left First string to compare.
+			 * @param right Second string to compare.
+			 * @return True if the strings have the same text.
+			 */
+			bool operator()(const Value::String *left,
+			                const Value::String *right) const;
+		};
+
+		/// Interned strings, each one being its own key so its text is
+		/// only stored once.
+		typedef std::unordered_set<Value::String *, StringHash, StringEqual> StringTable;
+
+		/**
+		 * Array or object being parsed.
+		 */
+		struct Frame {
+			/// Value containing the array or the object.
+			Value *value;
+
+			/// Projection applied to the members or the elements, NULL if
+			/// they are loaded whole.
+			const Projection *projection;
+
+			/// Number of elements read in an array.
+			size_t count;
+
+			/// Index of the object's first member in the members read.
+			size_t firstMember;
+
+			/// Specifies if the object had members before being parsed.
+			bool reusing;
+
+			/// Specifies if a member or an element was started and the
+			/// separator following it is expected next.
+			bool afterValue;
+		};
+
+		/**
+		 * Validates and parses JSON from a block of memory in UTF-8.
+		 * @param json Pointer to the first byte of the JSON.
+		 * @param size Number of bytes of the JSON.
+		 * @param byteOrderMarkSize Size of the byte order mark starting the
+		 * JSON.
+		 * @param result Value receiving the JSON's value.
+		 * @return Result of the validation.
+		 */
+		ValidationResult tryParseUTF8(const char *json, size_t size,
+		                              size_t byteOrderMarkSize,
+		                              Value &result);
+
+		/**
+		 * Copy constructor, not implemented to prevent copies.
+		 */
+		Parser(const Parser &src);
+
+		/**
+		 * Assignment operator, not implemented to prevent copies.
+		 */
+		Parser &operator=(const Parser &src);
+
+		/// Input stream over the memory parsed, created on first use.
+		MemoryInput *memoryInput;
+
+		/// Scratch buffer receiving the object members' names and the
+		/// numbers' text.
+		std::string buffer;
+
+		/// Members read in the objects being parsed that already had
+		/// members, used to erase the ones that aren't in the JSON.
+		std::vector<const Value *> members;
+
+		/// Scratch buffer receiving the documents read from streams by
+		/// tryParse(...).
+		std::string document;
+
+		/// Scratch buffer receiving the documents converted to UTF-8 by
+		/// tryParse(...).
+		std::string transcoded;
+
+		/// Arrays and objects being parsed, from the outermost one.
+		std::vector<Frame> frames;
+
+		/// Maximum nesting depth of the arrays and objects.
+		unsigned int maximumDepth;
+
+		/// Maximum number of bytes of a document.
+		size_t maximumSize;
+
+		/// Specifies if the arrays of numbers are given a typed storage.
+		bool typedArrays;
+
+		/// Maximum number of bytes of the strings interned, 0 if they
+		/// aren't.
+		size_t maximumInternedSize;
+
+		/// Maximum number of strings kept interned.
+		size_t maximumInternedCount;
+
+		/// Interned strings, each holding a reference for the parser.
+		StringTable strings;
+
+		/// Scratch string receiving the strings read before they are
+		/// interned, also used to look them up.
+		Value::String internedText;
+	};
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef JB_PROJECTION_H
+#define JB_PROJECTION_H
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include "Export.h"
+
+namespace JsonBox {
+	/**
+	 * Selects the parts of a JSON document to load. Passed to
+	 * Value::loadFromString(...) or Value::loadFromStream(...), only the
+	 * selected object members are parsed, the others are skipped by
+	 * matching their brackets, without building their values.
+	 *
+	 * Members are selected either by JSON Pointers (RFC 6901), like "/id"
+	 * or "/user/name", or by a filter called with the name of every member
+	 * at every depth. A selected member is loaded with all its contents.
+	 * The arrays are never shortened: what remains of the JSON Pointers is
+	 * applied to each of their elements, so "/events/id" selects the "id"
+	 * member of every object in the "events" array.
+	 * @see JsonBox::Value::loadFromStream
+	 */
+	class JSONBOX_EXPORT Projection {
+		friend class Value;
+	public:
+		/**
+		 * Filter deciding if object members are loaded. Can be a function,
+		 * a lambda or any function object, so it can carry its own state.
+		 * Takes the name of the member and returns true to load the member
+		 * and its contents, which are filtered in turn, false to skip it.
+		 */
+		typedef std::function<bool(const std::string &)> MemberFilter;
+
+		/**
+		 * Default constructor. Selects nothing until JSON Pointers are added.
+		 * @see JsonBox::Projection::addPointer
+		 */
+		Projection();
+
+		/**
+		 * Parameterized constructor. Selects the members accepted by a
+		 * filter.
+		 * @param newFilter Filter called with the name of each member.
+		 */
+		explicit Projection(MemberFilter newFilter);
+
+		/**
+		 * Selects the value at a JSON Pointer along with all its contents.
+		 * The empty pointer selects the whole document. Has no effect on a
+		 * projection using a member filter.
+		 * @param pointer JSON Pointer of the value to select.
+		 * @return Reference to the projection, so pointers can be chained.
+		 */
+		Projection &addPointer(const std::string &pointer);
+
+	private:
+		/**
+		 * Selects an object member.
+		 * @param name Name of the member.
+		 * @param memberProjection Receives the projection to apply to the
+		 * member's value, NULL if it is loaded whole.
+		 * @return True if the member is loaded, false if it is skipped.
+		 */
+		bool selectMember(const std::string &name,
+		                  const Projection *&memberProjection) const;
+
+		/// Filter deciding which members are loaded, empty if the JSON
+		/// Pointers decide.
+		MemberFilter filter;
+
+		/// Specifies if the value is loaded with all its contents.
+		bool complete;
+
+		/// Projections of the members selected by the JSON Pointers.
+		std::map<std::string, Projection> members;
+	};
+}
+
+#endif
@@ -0,0 +1,436 @@
+#ifndef JB_REFORMATTER_H
+#define JB_REFORMATTER_H
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <JsonBox/Grammar.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/Writer.h>
+
+namespace JsonBox {
+	/**
+	 * Reformats JSON by passing its tokens from an input stream to an output
+	 * stream, without building any Value. Strings, numbers and literals are
+	 * copied byte for byte, only the whitespace between the tokens is
+	 * rewritten by the indentation policy. The memory used only depends on
+	 * the nesting depth, so documents of any size can be minified or
+	 * re-indented. A sequence of top-level values, like JSON lines, is
+	 * written one value per line.
+	 *
+	 * The grammar is checked token by token: the order of the values, names
+	 * and separators, the numbers, the literals and the escape sequences.
+	 * Only the UTF-8 of the strings isn't, JsonBox::validate(...) does it.
+	 * @tparam IndentPolicy Compact to minify, Pretty<...> to indent.
+	 * @see JsonBox::Writer
+	 */
+	template <typename IndentPolicy>
+	class Reformatter {
+	public:
+		/**
+		 * Reformats all the JSON values of an input stream. Throws a
+		 * JsonParsingError if a token isn't allowed where it is found, if a
+		 * number, a literal or an escape sequence is invalid or if the input
+		 * ends inside a string or a container. Stops at the first character
+		 * that can't be written, with the output's badbit set.
+		 * @param input Input stream to read the JSON from.
+		 * @param output Output stream to write the reformatted JSON to.
+		 * @return Number of top-level values written.
+		 */
+		static size_t reformat(std::istream &input, std::ostream &output) {
+			typedef std::streambuf::traits_type Traits;
+			std::streambuf *source = input.rdbuf();
+			std::streambuf *destination = output.rdbuf();
+			std::string containers;
+			std::string token;
+			size_t count = 0;
+			Expected expected = VALUE;
+			Traits::int_type character;
+
+			while (output && !Traits::eq_int_type(character = skipWhiteSpace(source), Traits::eof())) {
+				char current = Traits::to_char_type(source->sbumpc());
+
+				if (containers.empty() && count > 0) {
+					// Each top-level value goes on its own line.
+					output.put(Whitespace::NEW_LINE);
+				}
+
+				switch (current) {
+				case Structural::BEGIN_OBJECT:
+				case Structural::BEGIN_ARRAY:
+					require(expected, VALUE, current);
+					put(output, destination, current);
+					containers.push_back(current);
+					character = skipWhiteSpace(source);
+
+					if (Traits::eq_int_type(character, Traits::to_int_type(getEnd(current)))) {
+						// Empty containers stay on one line.
+						put(output, destination, Traits::to_char_type(source->sbumpc()));
+						containers.erase(containers.size() - 1);
+						endValue(containers, expected, count);
+
+					} else {
+						IndentPolicy::writeNewLine(output, static_cast<unsigned int>(containers.size()));
+						expected = (current == Structural::BEGIN_OBJECT) ? (NAME) : (VALUE);
+					}
+
+					break;
+
+				case Structural::END_OBJECT:
+				case Structural::END_ARRAY:
+					if (containers.empty() || getEnd(containers[containers.size() - 1]) != current) {
+						throw JsonParsingError(std::string("Unmatched closing bracket found: '").append(1, current).append("'"));
+					}
+
+					require(expected, SEPARATOR, current);
+					containers.erase(containers.size() - 1);
+					IndentPolicy::writeNewLine(output, static_cast<unsigned int>(containers.size()));
+					put(output, destination, current);
+					endValue(containers, expected, count);
+					break;
+
+				case Structural::VALUE_SEPARATOR:
+					requireContainer(containers, current);
+					require(expected, SEPARATOR, current);
+					put(output, destination, current);
+					IndentPolicy::writeNewLine(output, static_cast<unsigned int>(containers.size()));
+					expected = (containers[containers.size() - 1] == Structural::BEGIN_OBJECT) ? (NAME) : (VALUE);
+					break;
+
+				case Structural::NAME_SEPARATOR:
+					requireContainer(containers, current);
+					require(expected, NAME_SEPARATOR, current);
+					IndentPolicy::writeNameSeparator(output);
+					expected = VALUE;
+					break;
+
+				case Structural::BEGIN_END_STRING:
+					if (expected != NAME) {
+						require(expected, VALUE, current);
+					}
+
+					put(output, destination, current);
+					copyString(source, output, destination);
+
+					if (expected == NAME) {
+						expected = NAME_SEPARATOR;
+
+					} else {
+						endValue(containers, expected, count);
+					}
+
+					break;
+
+				default:
+					require(expected, VALUE, current);
+
+					// Numbers and literals end at the next whitespace or
+					// structural character.
+					token.assign(1, current);
+					character = source->sgetc();
+
+					while (!Traits::eq_int_type(character, Traits::eof()) &&
+					       !isDelimiter(Traits::to_char_type(character))) {
+						token.push_back(Traits::to_char_type(character));
+						character = source->snextc();
+					}
+
+					if (!isNumber(token) && token != Literals::TRUE_STRING &&
+					    token != Literals::FALSE_STRING && token != Literals::NULL_STRING) {
+						throw JsonParsingError(std::string("Invalid number or literal found: '").append(token).append("'"));
+					}
+
+					for (std::string::const_iterator i = token.begin(); output && i != token.end(); ++i) {
+						put(output, destination, *i);
+					}
+
+					endValue(containers, expected, count);
+					break;
+				}
+			}
+
+			if (output && !containers.empty()) {
+				throw JsonParsingError("Input ends inside a container.");
+			}
+
+			return count;
+		}
+
+	private:
+		/**
+		 * Tokens allowed at a point of the JSON.
+		 */
+		enum Expected {
+			/// A value, at the top level, after an opening bracket or after
+			/// a separator.
+			VALUE,
+			/// An object member's name.
+			NAME,
+			/// The name separator after a member's name.
+			NAME_SEPARATOR,
+			/// A value separator or a closing bracket, after a value in a
+			/// container.
+			SEPARATOR
+		};
+
+		/**
+		 * Throws a JsonParsingError if a token isn't the one expected.
+		 * @param expected Tokens allowed where the token was found.
+		 * @param required Tokens the token belongs to.
+		 * @param token First character of the token found.
+		 */
+		static void require(Expected expected, Expected required, char token) {
+			if (expected != required) {
+				std::string message;
+
+				switch (expected) {
+				case VALUE:
+					message = "Expected a value before: '";
+					break;
+
+				case NAME:
+					message = "Expected an object member's name before: '";
+					break;
+
+				case NAME_SEPARATOR:
+					message = "Missing name separator before: '";
+					break;
+
+				default:
+					message = "Missing separator before: '";
+					break;
+				}
+
+				throw JsonParsingError(message.append(1, token).append("'"));
+			}
+		}
+
+		/**
+		 * Updates the tokens expected after a value.
+		 * @param containers Opening brackets of the containers still open
+		 * after the value.
+		 * @param expected Receives the tokens allowed after the value.
+		 * @param count Number of top-level values, incremented if the value
+		 * is one.
+		 */
+		static void endValue(const std::string &containers, Expected &expected,
+		                     size_t &count) {
+			if (containers.empty()) {
+				expected = VALUE;
+				++count;
+
+			} else {
+				expected = SEPARATOR;
+			}
+		}
+
+		/**
+		 * Checks if a token follows the grammar of the JSON numbers.
+		 * @param token Characters of the token.
+		 * @return True if the token is a valid number.
+		 */
+		static bool isNumber(const std::string &token) {
+			std::string::const_iterator i = token.begin();
+
+			if (i != token.end() && *i == Numbers::MINUS) {
+				++i;
+			}
+
+			if (i != token.end() && *i == '0') {
+				++i;
+
+			} else if (!skipDigits(i, token.end())) {
+				return false;
+			}
+
+			if (i != token.end() && *i == Numbers::DECIMAL_POINT) {
+				++i;
+
+				if (!skipDigits(i, token.end())) {
+					return false;
+				}
+			}
+
+			if (i != token.end() && (*i == Numbers::LOWER_EXP || *i == Numbers::UPPER_EXP)) {
+				++i;
+
+				if (i != token.end() && (*i == Numbers::PLUS || *i == Numbers::MINUS)) {
+					++i;
+				}
+
+				if (!skipDigits(i, token.end())) {
+					return false;
+				}
+			}
+
+			return i == token.end();
+		}
+
+		/**
+		 * Skips one or more digits.
+		 * @param i Iterator moved past the digits.
+		 * @param end End of the token.
+		 * @return True if there was at least one digit.
+		 */
+		static bool skipDigits(std::string::const_iterator &i,
+		                       std::string::const_iterator end) {
+			std::string::const_iterator first = i;
+
+			while (i != end && isCharacterClass(*i, CharacterClass::DIGIT)) {
+				++i;
+			}
+
+			return i != first;
+		}
+
+		/**
+		 * Skips the whitespace in a streambuf.
+		 * @param source Streambuf to read from.
+		 * @return Next character, not extracted, or traits::eof().
+		 */
+		static std::streambuf::int_type skipWhiteSpace(std::streambuf *source) {
+			typedef std::streambuf::traits_type Traits;
+			std::streambuf::int_type character = source->sgetc();
+
+			while (!Traits::eq_int_type(character, Traits::eof()) &&
+			       isCharacterClass(Traits::to_char_type(character), CharacterClass::WHITESPACE)) {
+				character = source->snextc();
+			}
+
+			return character;
+		}
+
+		/**
+		 * Checks if a character ends a number or a literal.
+		 * @param character Character to check.
+		 * @return True if the character is whitespace, structural or a
+		 * quotation mark.
+		 */
+		static bool isDelimiter(char character) {
+			return isCharacterClass(character, CharacterClass::DELIMITER);
+		}
+
+		/**
+		 * Gets the closing bracket of a container.
+		 * @param begin Opening bracket of the container.
+		 * @return Matching closing bracket.
+		 */
+		static char getEnd(char begin) {
+			return (begin == Structural::BEGIN_OBJECT) ? (Structural::END_OBJECT) : (Structural::END_ARRAY);
+		}
+
+		/**
+		 * Throws a JsonParsingError if a separator is outside of any
+		 * container.
+		 * @param containers Opening brackets of the open containers.
+		 * @param separator Separator found.
+		 */
+		static void requireContainer(const std::string &containers,
+		                             char separator) {
+			if (containers.empty()) {
+				throw JsonParsingError(std::string("Separator found outside of a container: '").append(1, separator).append("'"));
+			}
+		}
+
+		/**
+		 * Writes a character straight to an output stream's streambuf.
+		 * Sets the stream's badbit if the character can't be written.
+		 * @param output Output stream to write to.
+		 * @param destination Streambuf of the output stream.
+		 * @param character Character to write.
+		 */
+		static void put(std::ostream &output, std::streambuf *destination,
+		                char character) {
+			typedef std::streambuf::traits_type Traits;
+
+			if (Traits::eq_int_type(destination->sputc(character), Traits::eof())) {
+				output.setstate(std::ios_base::badbit);
+			}
+		}
+
+		/**
+		 * Copies a string's text and its closing quotation mark, with its
+		 * escape sequences untouched. Throws a JsonParsingError if the input
+		 * ends before the string, or if it contains a control character or
+		 * an invalid escape sequence.
+		 * @param source Streambuf to read from, after the opening quotation
+		 * mark.
+		 * @param output Output stream to write to, left with its badbit set
+		 * if a character can't be written.
+		 * @param destination Streambuf of the output stream.
+		 */
+		static void copyString(std::streambuf *source, std::ostream &output,
+		                       std::streambuf *destination) {
+			typedef std::streambuf::traits_type Traits;
+			Traits::int_type character = source->sbumpc();
+			bool escaped = false;
+			// Number of hexadecimal digits left in a \u escape sequence.
+			unsigned int hexDigits = 0;
+
+			while (output && !Traits::eq_int_type(character, Traits::eof())) {
+				char current = Traits::to_char_type(character);
+				put(output, destination, current);
+
+				if (static_cast<unsigned char>(current) < 0x20) {
+					throw JsonParsingError("Invalid control character found in a string.");
+
+				} else if (hexDigits != 0) {
+					if (!isCharacterClass(current, CharacterClass::HEX_DIGIT)) {
+						throw JsonParsingError("Invalid escape sequence found in a string.");
+					}
+
+					--hexDigits;
+
+				} else if (escaped) {
+					escaped = false;
+
+					if (current == Strings::Json::Escape::BEGIN_UNICODE) {
+						hexDigits = 4;
+
+					} else if (current != Strings::Json::Escape::QUOTATION_MARK &&
+					           current != Strings::Json::Escape::REVERSE_SOLIDUS &&
+					           current != Strings::Json::Escape::SOLIDUS &&
+					           current != Strings::Json::Escape::BACKSPACE &&
+					           current != Strings::Json::Escape::FORM_FEED &&
+					           current != Strings::Json::Escape::LINE_FEED &&
+					           current != Strings::Json::Escape::CARRIAGE_RETURN &&
+					           current != Strings::Json::Escape::TAB) {
+						throw JsonParsingError("Invalid escape sequence found in a string.");
+					}
+
+				} else if (current == Strings::Json::Escape::BEGIN_ESCAPE) {
+					escaped = true;
+
+				} else if (current == Structural::BEGIN_END_STRING) {
+					return;
+				}
+
+				character = source->sbumpc();
+			}
+
+			if (output) {
+				throw JsonParsingError("Input ends inside a string.");
+			}
+		}
+	};
+
+	/**
+	 * Minifies or indents all the JSON values of an input stream, passing
+	 * their tokens through without building any Value.
+	 * @param input Input stream to read the JSON from.
+	 * @param output Output stream to write the reformatted JSON to.
+	 * @param indent Specifies if the output is indented with tabs, like
+	 * Value::writeToStream(...) does, or written without whitespace.
+	 * @return Number of top-level values written.
+	 * @see JsonBox::Reformatter
+	 */
+	inline size_t reformat(std::istream &input, std::ostream &output,
+	                       bool indent) {
+		return (indent) ? (Reformatter<Pretty<> >::reformat(input, output)) : (Reformatter<Compact>::reformat(input, output));
+	}
+}
+
+#endif
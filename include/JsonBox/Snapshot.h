@@ -0,0 +1,285 @@
+#ifndef JB_SNAPSHOT_H
+#define JB_SNAPSHOT_H
+
+#include <string>
+#include <stdint.h>
+
+#include "Export.h"
+#include <JsonBox/MappedFile.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	/**
+	 * Read-only view of a value inside a snapshot. Reading a view doesn't
+	 * parse or allocate anything, except for getString() and toValue(),
+	 * it directly reads the snapshot's bytes. Views are small and are meant
+	 * to be copied around, they stay valid as long as their snapshot is
+	 * open. Throws a JsonParsingError when reading a corrupted snapshot.
+	 * @see JsonBox::Snapshot
+	 */
+	class JSONBOX_EXPORT SnapshotValue {
+	public:
+		/**
+		 * Default constructor. Makes a view of a null value that doesn't
+		 * belong to any snapshot.
+		 */
+		SnapshotValue();
+
+		/**
+		 * Gets the type of the value.
+		 * @return Type of the value, never UNKNOWN nor RAW_JSON.
+		 */
+		Value::Type getType() const;
+
+		/**
+		 * Checks if the value is a string.
+		 * @return True if the value is a string, false if not.
+		 */
+		bool isString() const;
+
+		/**
+		 * Checks if the value is an integer.
+		 * @return True if the value is an integer, false if not.
+		 */
+		bool isInteger() const;
+
+		/**
+		 * Checks if the value is a double.
+		 * @return True if the value is a double, false if not.
+		 */
+		bool isDouble() const;
+
+		/**
+		 * Checks if the value is an object.
+		 * @return True if the value is an object, false if not.
+		 */
+		bool isObject() const;
+
+		/**
+		 * Checks if the value is an array.
+		 * @return True if the value is an array, false if not.
+		 */
+		bool isArray() const;
+
+		/**
+		 * Checks if the value is a boolean.
+		 * @return True if the value is a boolean, false if not.
+		 */
+		bool isBoolean() const;
+
+		/**
+		 * Checks if the value is null.
+		 * @return True if the value is null, false if not.
+		 */
+		bool isNull() const;
+
+		/**
+		 * Gets a copy of the value's string.
+		 * @return Value's string, or an empty string if the value isn't a
+		 * string.
+		 */
+		std::string getString() const;
+
+		/**
+		 * Gets the value's string directly in the snapshot.
+		 * @return Pointer to the string's null terminated UTF-8 bytes, or to
+		 * an empty string if the value isn't a string.
+		 * @see JsonBox::SnapshotValue::getStringSize
+		 */
+		const char *getStringData() const;
+
+		/**
+		 * Gets the size of the value's string.
+		 * @return Number of bytes in the string, or 0 if the value isn't a
+		 * string.
+		 */
+		size_t getStringSize() const;
+
+		/**
+		 * Gets the value's integer value.
+		 * @return Value's integer value, or 0 if the value doesn't contain a
+		 * numeric value.
+		 */
+		int getInteger() const;
+
+		/**
+		 * Gets the value's double value.
+		 * @return Value's double value, or 0.0 if the value doesn't contain a
+		 * numeric value.
+		 */
+		double getDouble() const;
+
+		/**
+		 * Gets the value's boolean value.
+		 * @return Value's boolean value, or false if the value isn't a
+		 * boolean.
+		 */
+		bool getBoolean() const;
+
+		/**
+		 * Gets the number of elements of an array or of members of an
+		 * object.
+		 * @return Number of elements or members, or 0 if the value is
+		 * neither an array nor an object.
+		 */
+		size_t getSize() const;
+
+		/**
+		 * Gets an array's element.
+		 * @param index Index of the element.
+		 * @return View of the element, or of a null value if the value isn't
+		 * an array or if the index is out of range.
+		 */
+		SnapshotValue operator[](size_t index) const;
+
+		/**
+		 * Finds an object's member. Uses a binary search on the sorted
+		 * member names.
+		 * @param key Name of the member.
+		 * @return View of the member's value, or of a null value if the
+		 * value isn't an object or doesn't have the member.
+		 */
+		SnapshotValue operator[](const std::string &key) const;
+
+		/**
+		 * Finds an object's member.
+		 * @param key Null terminated name of the member.
+		 * @return View of the member's value, or of a null value if the
+		 * value isn't an object or doesn't have the member.
+		 * @see JsonBox::SnapshotValue::operator[](const std::string &key)
+		 */
+		SnapshotValue operator[](const char *key) const;
+
+		/**
+		 * Finds an object's member.
+		 * @param key Pointer to the first byte of the member's name.
+		 * @param keySize Number of bytes in the member's name.
+		 * @return View of the member's value, or of a null value if the
+		 * value isn't an object or doesn't have the member.
+		 * @see JsonBox::SnapshotValue::operator[](const std::string &key)
+		 */
+		SnapshotValue find(const char *key, size_t keySize) const;
+
+		/**
+		 * Gets the name of an object's member. Members are sorted by name.
+		 * @param index Index of the member.
+		 * @return View of the member's name, or of a null value if the value
+		 * isn't an object or if the index is out of range.
+		 */
+		SnapshotValue getMemberName(size_t index) const;
+
+		/**
+		 * Gets the value of an object's member. Members are sorted by name.
+		 * @param index Index of the member.
+		 * @return View of the member's value, or of a null value if the value
+		 * isn't an object or if the index is out of range.
+		 */
+		SnapshotValue getMemberValue(size_t index) const;
+
+		/**
+		 * Copies the value and all its contents into a Value.
+		 * @return Value equal to the one the snapshot was written from.
+		 */
+		Value toValue() const;
+	private:
+		friend class Snapshot;
+
+		/**
+		 * Parameterized constructor.
+		 * @param newData Pointer to the first byte of the snapshot.
+		 * @param newSize Number of bytes in the snapshot.
+		 * @param newOffset Offset of the value's node in the snapshot.
+		 */
+		SnapshotValue(const char *newData, size_t newSize, uint64_t newOffset);
+
+		/**
+		 * Gets bytes of the snapshot, throws a JsonParsingError if they are
+		 * past its end.
+		 * @param position Offset of the first byte.
+		 * @param length Number of bytes needed.
+		 * @return Pointer to the first byte.
+		 */
+		const char *getBytes(uint64_t position, uint64_t length) const;
+
+		/**
+		 * Gets the tag of the value's node.
+		 * @return Tag giving the value's type.
+		 */
+		uint8_t getTag() const;
+
+		/**
+		 * Gets the element or member count of an array or object node, or
+		 * the size of a string node. Throws a JsonParsingError if the node's
+		 * offsets or bytes would go past the end of the snapshot.
+		 * @return Number of elements or members, or the string's size.
+		 */
+		uint32_t getCount() const;
+
+		/**
+		 * Makes a view of another node of the snapshot. Throws a
+		 * JsonParsingError if the node isn't before the current one, since
+		 * the nodes are written after the ones they refer to.
+		 * @param position Offset in the snapshot of the node's offset.
+		 * @return View of the node.
+		 */
+		SnapshotValue getNode(uint64_t position) const;
+
+		/**
+		 * Copies the value and all its contents into a Value. Throws a
+		 * JsonParsingError past BINARY_MAXIMUM_DEPTH nested arrays and
+		 * objects.
+		 * @param result Value replaced by the copy.
+		 * @param depth Number of arrays and objects containing the value.
+		 */
+		void copyTo(Value &result, unsigned int depth) const;
+
+		/// Pointer to the first byte of the snapshot.
+		const char *data;
+
+		/// Number of bytes in the snapshot.
+		size_t size;
+
+		/// Offset of the value's node, 0 for a null value without node.
+		uint64_t offset;
+	};
+
+	/**
+	 * Snapshot of a value opened for reading. The snapshot file is mapped in
+	 * memory, so opening it is immediate whatever its size and its pages are
+	 * shared with the other processes reading the same snapshot. Snapshots
+	 * are written with Value::writeSnapshot(...).
+	 * @see JsonBox::SnapshotValue
+	 * @see JsonBox::Value::writeSnapshot
+	 */
+	class JSONBOX_EXPORT Snapshot {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * file can't be opened or a JsonParsingError if it isn't a snapshot.
+		 * @param filePath Path to the snapshot file to open.
+		 */
+		explicit Snapshot(const std::string &filePath);
+
+		/**
+		 * Gets the value the snapshot was written from.
+		 * @return View of the root value, valid as long as the snapshot is
+		 * open.
+		 */
+		SnapshotValue getRoot() const;
+
+		/**
+		 * Checks if the snapshot is mapped in memory or was read into
+		 * memory because the platform can't map files.
+		 * @return True if the snapshot is mapped in memory.
+		 */
+		bool isMapped() const;
+	private:
+		/// Content of the snapshot file.
+		MappedFile file;
+
+		/// Offset of the root value's node.
+		uint64_t rootOffset;
+	};
+}
+
+#endif
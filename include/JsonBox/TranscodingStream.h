@@ -0,0 +1,150 @@
+#ifndef JB_TRANSCODING_STREAM_H
+#define JB_TRANSCODING_STREAM_H
+
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Export.h"
+
+namespace JsonBox {
+	/**
+	 * Unicode encodings of the JSON documents read.
+	 */
+	class JSONBOX_EXPORT Encoding {
+	public:
+		enum Format {
+			UTF8,
+			UTF16LE,
+			UTF16BE,
+			UTF32LE,
+			UTF32BE
+		};
+
+		/**
+		 * Detects the encoding of a document from its first bytes. A byte
+		 * order mark decides if there is one. Otherwise, since a JSON
+		 * document starts with an ASCII character, the position of the
+		 * null bytes gives the encoding, as described in RFC 4627.
+		 * @param bytes First bytes of the document.
+		 * @param size Number of bytes given, at most 4 are used.
+		 * @param byteOrderMarkSize Receives the size of the byte order mark,
+		 * 0 if there is none.
+		 * @return Encoding of the document, UTF8 when in doubt.
+		 */
+		static Format detect(const char *bytes, size_t size,
+		                     size_t &byteOrderMarkSize);
+	};
+
+	/**
+	 * Streambuf converting the text read from another streambuf to UTF-8.
+	 * The text is read and converted in blocks, as the characters are
+	 * needed, so documents of any size are converted with bounded memory.
+	 * Unpaired surrogates, code points out of the Unicode range and
+	 * truncated code units are replaced by U+FFFD. Throws a
+	 * JsonParsingError if the source is longer than a maximum size.
+	 * @see JsonBox::TranscodingInputStream
+	 */
+	class JSONBOX_EXPORT TranscodingStreambuf : public std::streambuf {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param newSource Streambuf to read the text from, after its byte
+		 * order mark.
+		 * @param newFormat Encoding of the text.
+		 * @param prefix Bytes of the text already read from the source,
+		 * converted before the ones still in it.
+		 * @param newMaximumSize Maximum number of bytes of the text,
+		 * counting the prefix.
+		 */
+		TranscodingStreambuf(std::streambuf *newSource,
+		                     Encoding::Format newFormat,
+		                     const std::string &prefix = std::string(),
+		                     size_t newMaximumSize = std::numeric_limits<size_t>::max());
+
+	protected:
+		/**
+		 * Converts the next block of characters.
+		 * @return Next character, or traits::eof() at the end of the text.
+		 */
+		virtual int_type underflow();
+
+	private:
+		/**
+		 * Copy constructor, not implemented to prevent copies.
+		 */
+		TranscodingStreambuf(const TranscodingStreambuf &src);
+
+		/**
+		 * Assignment operator, not implemented to prevent copies.
+		 */
+		TranscodingStreambuf &operator=(const TranscodingStreambuf &src);
+
+		/**
+		 * Reads more bytes from the source, after the ones not converted
+		 * yet.
+		 */
+		void fillInput();
+
+		/**
+		 * Converts the bytes read to UTF-8 until the output block is full.
+		 * @param limit Size of the output block.
+		 */
+		void convertInput(size_t limit);
+
+		/// Streambuf the text is read from.
+		std::streambuf *source;
+
+		/// Encoding of the text.
+		Encoding::Format format;
+
+		/// Block of bytes read from the source.
+		std::vector<char> input;
+
+		/// Position of the next byte to convert in the input block.
+		size_t inputNext;
+
+		/// End of the bytes read in the input block.
+		size_t inputEnd;
+
+		/// Specifies if the source has no more bytes.
+		bool sourceEnded;
+
+		/// Number of bytes that can still be read from the source.
+		size_t remainingSize;
+
+		/// Block of characters converted to UTF-8, after a putback area.
+		std::string output;
+	};
+
+	/**
+	 * Input stream converting the text read from another input stream to
+	 * UTF-8. The source stream is read in blocks, so it ends up past the
+	 * characters read from this stream. Its exception mask includes badbit,
+	 * so the errors of the streambuf are thrown to the reader.
+	 * @see JsonBox::TranscodingStreambuf
+	 */
+	class JSONBOX_EXPORT TranscodingInputStream : public std::istream {
+	public:
+		/**
+		 * Parameterized constructor.
+		 * @param source Input stream to read the text from, after its byte
+		 * order mark.
+		 * @param format Encoding of the text.
+		 * @param prefix Bytes of the text already read from the source.
+		 * @param maximumSize Maximum number of bytes of the text.
+		 */
+		TranscodingInputStream(std::istream &source, Encoding::Format format,
+		                       const std::string &prefix = std::string(),
+		                       size_t maximumSize = std::numeric_limits<size_t>::max());
+
+	private:
+		/// Streambuf doing the conversion.
+		TranscodingStreambuf buffer;
+	};
+}
+
+#endif
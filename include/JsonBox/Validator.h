@@ -0,0 +1,97 @@
+#ifndef JB_VALIDATOR_H
+#define JB_VALIDATOR_H
+
+#include <cstddef>
+#include <istream>
+
+#include "Export.h"
+
+namespace JsonBox {
+	/**
+	 * Result of the validation of a JSON document.
+	 * @see JsonBox::validate
+	 */
+	struct JSONBOX_EXPORT ValidationResult {
+		/**
+		 * Kinds of errors found in JSON documents.
+		 */
+		enum Error {
+			VALID,
+			UNEXPECTED_END,
+			UNEXPECTED_CHARACTER,
+			TRAILING_CHARACTERS,
+			INVALID_STRING,
+			INVALID_ESCAPE,
+			INVALID_UTF8,
+			INVALID_NUMBER,
+			INVALID_LITERAL,
+			TOO_DEEP,
+			TOO_LARGE
+		};
+
+		/**
+		 * Default constructor. Describes a valid document.
+		 */
+		ValidationResult();
+
+		/// Specifies if the document is valid.
+		bool valid;
+
+		/// Kind of error found, VALID if the document is valid.
+		Error error;
+
+		/// Offset of the byte where the error was found, 0 if the document
+		/// is valid.
+		size_t position;
+
+		/// Line where the error was found, starting at 1, 0 if the document
+		/// is valid or too large.
+		size_t line;
+
+		/// Column where the error was found, in bytes from the start of
+		/// the line and starting at 1, 0 if the document is valid or too
+		/// large.
+		size_t column;
+
+		/// Static string describing the error, NULL if the document is
+		/// valid.
+		const char *message;
+	};
+
+	/**
+	 * Maximum nesting depth of the arrays and objects accepted by the
+	 * validation by default.
+	 */
+	const unsigned int MAXIMUM_VALIDATION_DEPTH = 1024;
+
+	/**
+	 * Checks that a block of memory contains exactly one valid JSON value,
+	 * optionally surrounded by whitespace, without building it. The JSON
+	 * grammar is checked strictly, along with the well-formedness of the
+	 * UTF-8 in the strings. Nothing is allocated, so it is much cheaper than
+	 * loading the JSON into a Value.
+	 * @param json Pointer to the first byte of the JSON.
+	 * @param size Number of bytes of the JSON.
+	 * @param maximumDepth Maximum nesting depth of the arrays and objects.
+	 * Only depths over MAXIMUM_VALIDATION_DEPTH allocate.
+	 * @return Result of the validation, with the position of the first
+	 * error if the JSON is invalid.
+	 * @see JsonBox::MAXIMUM_VALIDATION_DEPTH
+	 */
+	JSONBOX_EXPORT ValidationResult validate(const char *json, size_t size,
+	                                         unsigned int maximumDepth = MAXIMUM_VALIDATION_DEPTH);
+
+	/**
+	 * Checks that an input stream contains exactly one valid JSON value,
+	 * reading it until its end without building it.
+	 * @param input Input stream to read the JSON from.
+	 * @param maximumDepth Maximum nesting depth of the arrays and objects.
+	 * @return Result of the validation, with the position of the first
+	 * error, counted from where the stream was, if the JSON is invalid.
+	 * @see JsonBox::validate(const char *, size_t, unsigned int)
+	 */
+	JSONBOX_EXPORT ValidationResult validate(std::istream &input,
+	                                         unsigned int maximumDepth = MAXIMUM_VALIDATION_DEPTH);
+}
+
+#endif
@@ -1,14 +1,24 @@
 #ifndef JB_VALUE_H
 #define JB_VALUE_H
 
+#include <atomic>
+#include <exception>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <iostream>
+#include <stdint.h>
 
 #include "Export.h"
+#include <JsonBox/NumericSpan.h>
+#include <JsonBox/Projection.h>
+#include <JsonBox/Validator.h>
 
 namespace JsonBox {
+	class Parser;
+
 	/**
 	 * Represents a json value. Can be a string, an integer, a floating point
 	 * number, an object, an array, a boolean value or a null value. To put it
@@ -28,14 +38,26 @@ namespace JsonBox {
 		 * @return Output parameter with the valud json written into it.
 		 */
 		friend std::ostream &operator<<(std::ostream &output, const Value &v);
+
+		template <typename IndentPolicy, typename EscapePolicy, typename CachePolicy>
+		friend class Writer;
+
+		friend class MsgPackReader;
+
+		friend class CborReader;
+
+		friend class UbjsonReader;
+
+		friend class Parser;
 	public:
 		typedef std::vector<Value> Array;
 		typedef std::map<std::string, Value> Object;
 		/**
 		 * Represents the different types a value can be. A value can only be
-		 * one of these types at a time. The UNKNOWN type is only used
-		 * temporarily internally when loading values from an input stream or
-		 * file.
+		 * one of these types at a time. The RAW_JSON type holds JSON that is
+		 * already serialized and is written out as is. The UNKNOWN type is
+		 * only used temporarily internally when loading values from an input
+		 * stream or file.
 		 */
 		enum Type {
 			STRING,
@@ -45,9 +67,26 @@ namespace JsonBox {
 			ARRAY,
 			BOOLEAN,
 			NULL_VALUE,
+			RAW_JSON,
 			UNKNOWN
 		};
 
+		/**
+		 * Represents the different ways an array's elements can be stored.
+		 * GENERIC_ARRAY stores a Value per element and can hold anything.
+		 * The other storages keep the numbers contiguous, without a Value
+		 * nor an allocation per element, and are used for arrays that only
+		 * contain numbers.
+		 * @see JsonBox::Value::setArrayStorage
+		 */
+		enum ArrayStorage {
+			GENERIC_ARRAY,
+			INT32_ARRAY,
+			INT64_ARRAY,
+			FLOAT_ARRAY,
+			DOUBLE_ARRAY
+		};
+
 		/**
 		 * Replaces characters with their JSON equivalent. The only difference
 		 * from escapeAllCharacters is that the solidi won't be escaped in this
@@ -259,9 +298,12 @@ namespace JsonBox {
 		/**
 		 * Bracket operator overload. If the value doesn't represent an object,
 		 * it is changed to do so and accesses the object's member value. If
-		 * the object's member doesn't exist, it is created.
+		 * the object's member doesn't exist, it is created. Discards the
+		 * serialized forms cached for the value, since the member can be
+		 * modified through the returned reference.
 		 * @param key Key identifier of the object's value to get.
 		 * @return Reference to the object's member's value.
+		 * @see JsonBox::ContainerCache
 		 */
 		Value &operator[](const std::string &key);
 
@@ -281,7 +323,10 @@ namespace JsonBox {
 		 * the array, it initializes the array with empty values up to the
 		 * required index. If the value already represents an array and the
 		 * index is too high for the size of the array, the array is resized
-		 * to be of size index + 1.
+		 * to be of size index + 1. An array using a typed storage is first
+		 * converted to the generic storage. Discards the serialized forms
+		 * cached for the value, since the element can be modified through the
+		 * returned reference.
 		 * @param index Index of the value to get.
 		 * @return Reference to the value at the received index in the array.
 		 */
@@ -351,6 +396,14 @@ namespace JsonBox {
 		 */
 		bool isNull() const;
 
+		/**
+		 * Checks if the value is a raw JSON fragment.
+		 * @return True if the value contains already serialized JSON, false
+		 * if not.
+		 * @see JsonBox::Value::setRawJson
+		 */
+		bool isRawJson() const;
+
 		/**
 		 * Gets the value's string value.
 		 * @return Value's string value, or an empty string if the value doesn't
@@ -371,7 +424,9 @@ namespace JsonBox {
 		 * Gets the value's string value or converts its numeric, boolean or
 		 * null value to a string.
 		 * @return Value's string value. If the value contains a numeric,
-		 * a boolean or a null value, it is converted to a string.
+		 * a boolean or a null value, it is converted to a string. If it
+		 * contains a raw JSON fragment, the fragment is returned. Numbers
+		 * read by the parser and not modified return their JSON text.
 		 */
 		const std::string getToString() const;
 
@@ -459,9 +514,14 @@ namespace JsonBox {
 		void setObject(const Object &newObject);
 
 		/**
-		 * Gets the value's array value.
+		 * Gets the value's array value. The arrays using a typed storage
+		 * aren't converted: their numbers are read with getInt32Array(),
+		 * getInt64Array(), getFloatArray() or getDoubleArray(), or they are
+		 * first converted with setArrayStorage(GENERIC_ARRAY). A
+		 * std::logic_error is thrown if the array uses a typed storage.
 		 * @return Value's array value, or an empty Array if the value doesn't
 		 * contain an array.
+		 * @see JsonBox::Value::getArrayStorage
 		 */
 		const Array &getArray() const;
 
@@ -472,6 +532,115 @@ namespace JsonBox {
 		 */
 		void setArray(const Array &newArray);
 
+		/**
+		 * Gets how the value's array elements are stored.
+		 * @return Storage used by the array, GENERIC_ARRAY if the value
+		 * doesn't contain an array.
+		 */
+		ArrayStorage getArrayStorage() const;
+
+		/**
+		 * Converts the value's array to another storage. Converting to the
+		 * generic storage always works. Converting to an integer storage
+		 * only works if all the elements are numbers with integer values in
+		 * the storage's range. Converting to a floating point storage only
+		 * works if all the elements are numbers, converting them to floats
+		 * can lose precision.
+		 * @param newStorage Storage to convert the array to.
+		 * @return True if the array now uses the requested storage, false if
+		 * the value isn't an array or if its elements can't be converted, in
+		 * which case the array is left untouched.
+		 */
+		bool setArrayStorage(ArrayStorage newStorage);
+
+		/**
+		 * Gets the value's 32 bit integers.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the INT32_ARRAY storage.
+		 */
+		NumericSpan<const int32_t> getInt32Array() const;
+
+		/**
+		 * Gets the value's 32 bit integers for modification. Discards the
+		 * serialized forms cached for the value.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the INT32_ARRAY storage.
+		 */
+		NumericSpan<int32_t> getInt32Array();
+
+		/**
+		 * Gets the value's 64 bit integers.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the INT64_ARRAY storage.
+		 */
+		NumericSpan<const int64_t> getInt64Array() const;
+
+		/**
+		 * Gets the value's 64 bit integers for modification. Discards the
+		 * serialized forms cached for the value.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the INT64_ARRAY storage.
+		 */
+		NumericSpan<int64_t> getInt64Array();
+
+		/**
+		 * Gets the value's floats.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the FLOAT_ARRAY storage.
+		 */
+		NumericSpan<const float> getFloatArray() const;
+
+		/**
+		 * Gets the value's floats for modification. Discards the serialized
+		 * forms cached for the value.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the FLOAT_ARRAY storage.
+		 */
+		NumericSpan<float> getFloatArray();
+
+		/**
+		 * Gets the value's doubles.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the DOUBLE_ARRAY storage.
+		 */
+		NumericSpan<const double> getDoubleArray() const;
+
+		/**
+		 * Gets the value's doubles for modification. Discards the serialized
+		 * forms cached for the value.
+		 * @return View of the array's numbers, or an empty view if the value
+		 * isn't an array using the DOUBLE_ARRAY storage.
+		 */
+		NumericSpan<double> getDoubleArray();
+
+		/**
+		 * Sets the value as an array of 32 bit integers using the INT32_ARRAY
+		 * storage.
+		 * @param newArray Numbers that the array will contain.
+		 */
+		void setTypedArray(const std::vector<int32_t> &newArray);
+
+		/**
+		 * Sets the value as an array of 64 bit integers using the INT64_ARRAY
+		 * storage. The integers that don't fit in an int are seen as doubles
+		 * by the generic storage.
+		 * @param newArray Numbers that the array will contain.
+		 */
+		void setTypedArray(const std::vector<int64_t> &newArray);
+
+		/**
+		 * Sets the value as an array of floats using the FLOAT_ARRAY storage.
+		 * @param newArray Numbers that the array will contain.
+		 */
+		void setTypedArray(const std::vector<float> &newArray);
+
+		/**
+		 * Sets the value as an array of doubles using the DOUBLE_ARRAY
+		 * storage.
+		 * @param newArray Numbers that the array will contain.
+		 */
+		void setTypedArray(const std::vector<double> &newArray);
+
 		/**
 		 * Gets the value's boolean value.
 		 * @return Value's boolean value, or false if the value doesn't contain
@@ -500,6 +669,25 @@ namespace JsonBox {
 		 */
 		void setNull();
 
+		/**
+		 * Gets the value's raw JSON fragment.
+		 * @return Value's already serialized JSON, or an empty string if the
+		 * value doesn't contain a raw JSON fragment.
+		 */
+		const std::string &getRawJson() const;
+
+		/**
+		 * Sets the value as a raw JSON fragment. The writers output the
+		 * fragment as is, without parsing it, escaping it or indenting it,
+		 * which is useful to embed JSON that was serialized elsewhere. The
+		 * fragment is not validated, it must contain exactly one valid JSON
+		 * value.
+		 * @param newRawJson Already serialized JSON that the Value will
+		 * contain. The value's type is changed if necessary to contain the
+		 * fragment.
+		 */
+		void setRawJson(const std::string &newRawJson);
+
 		/**
 		 * Loads the current value from a string containing the JSON to parse.
 		 * @param json String containing the JSON to parse.
@@ -507,24 +695,100 @@ namespace JsonBox {
 		void loadFromString(const std::string &json);
 
 		/**
-		 * Loads a Value from a stream containing valid JSON in UTF-8. Does not
-		 * read the stream if it is in UTF-32 or UTF-16. All the json escape
-		 * sequences in string values are converted to their char equivalent,
-		 * including unicode characters. Unicode characters that use two "\u"
-		 * sequences are interpreted as two unicode characters, so it doesn't
-		 * support perfect parsing.
+		 * Loads the parts of a JSON string selected by a projection. The
+		 * object members that aren't selected are skipped without being
+		 * parsed.
+		 * @param json String containing the JSON to parse.
+		 * @param projection Selects the object members to load.
+		 * @see JsonBox::Projection
+		 */
+		void loadFromString(const std::string &json,
+		                    const Projection &projection);
+
+		/**
+		 * Loads a Value from a stream containing valid JSON in UTF-8, UTF-16
+		 * or UTF-32. The encoding is detected from the byte order mark or
+		 * from the null bytes starting the stream. UTF-16 and UTF-32 are
+		 * converted to UTF-8 in blocks as they are parsed, so the stream is
+		 * read past the end of the value. All the json escape sequences in
+		 * string values are converted to their char equivalent, including
+		 * unicode characters and surrogate pairs. The arrays use the
+		 * generic storage. The nested arrays and objects are parsed without
+		 * recursion, a JsonParsingError being thrown past
+		 * Parser::DEFAULT_MAXIMUM_DEPTH levels. A Parser allows other limits
+		 * and typed arrays.
 		 * @param input Input stream to read from. Can be a file stream.
+		 * @see JsonBox::Parser
 		 */
 		void loadFromStream(std::istream &input);
 
+		/**
+		 * Loads the parts of a JSON stream selected by a projection. The
+		 * object members that aren't selected are skipped by matching their
+		 * brackets, without being parsed or stored.
+		 * @param input Input stream to read from. Can be a file stream.
+		 * @param projection Selects the object members to load.
+		 * @see JsonBox::Projection
+		 */
+		void loadFromStream(std::istream &input, const Projection &projection);
+
+		/**
+		 * Loads the current value from a string containing JSON, without
+		 * throwing if the JSON is invalid. The JSON is validated first, so
+		 * malformed documents cost neither an exception nor a partial load.
+		 * @param json String containing the JSON to parse.
+		 * @return Result of the validation, with the kind, the offset, the
+		 * line and the column of the error if the JSON is invalid, in which
+		 * case the value is left untouched.
+		 * @see JsonBox::Parser::tryParse
+		 */
+		ValidationResult tryLoadFromString(const std::string &json);
+
+		/**
+		 * Loads the current value from a stream containing JSON, without
+		 * throwing if the JSON is invalid. The stream is read until its end.
+		 * @param input Input stream to read from.
+		 * @return Result of the validation, the value being left untouched
+		 * if the JSON is invalid.
+		 * @see JsonBox::Parser::tryParse
+		 */
+		ValidationResult tryLoadFromStream(std::istream &input);
+
 		/**
 		 * Loads a value from a file. Loads the file then calls the
-		 * loadFromStream(...) method.
+		 * loadFromStream(...) method. Files ending with ".gz" or ".zst" are
+		 * decompressed on the fly, in blocks, as they are parsed.
 		 * @param filePath Path to the JSON file to load.
 		 * @see JsonBox::Value::loadFromStream
+		 * @see JsonBox::DecompressingInputStream
 		 */
 		void loadFromFile(const std::string &filePath);
 
+		/**
+		 * Loads the current value lazily from a string containing the JSON
+		 * to parse. Objects and arrays only record where they start in the
+		 * JSON and are parsed one level at a time when they are first
+		 * navigated, with operator[], getObject(), getArray() or any other
+		 * method needing their contents. The nested containers they contain
+		 * are skipped by matching their brackets and become lazy in turn.
+		 * The JSON is copied once and shared by all the lazy containers.
+		 * Errors in a container are only found when it is parsed, and every
+		 * later access to it throws them again. The containers are parsed
+		 * under a lock, so the value can be read from several threads.
+		 * @param json String containing the JSON to parse.
+		 * @see JsonBox::Value::loadFromStream
+		 */
+		void loadLazilyFromString(const std::string &json);
+
+		/**
+		 * Loads the current value lazily from a stream containing JSON in
+		 * UTF-8, UTF-16 or UTF-32. The whole stream is read, only the
+		 * containers' parsing is deferred.
+		 * @param input Input stream to read from.
+		 * @see JsonBox::Value::loadLazilyFromString
+		 */
+		void loadLazilyFromStream(std::istream &input);
+
 		/**
 		 * Writes the value to an output stream in valid JSON. Uses the
 		 * overloaded output operator.
@@ -533,34 +797,416 @@ namespace JsonBox {
 		 * not.
 		 * @param escapeAll Specifies whether or not all the JSON escapable
 		 * characters should be escaped.
+		 * @param threadCount Number of threads used to write the large arrays
+		 * and objects. 0 uses one thread per hardware thread.
 		 * @see JsonBox::Value::operator<<(std::ostream& output, const Value& v)
 		 * @see JsonBox::Value::escapeAllCharacters
 		 * @see JsonBox::Value::escapeMinimumCharacters
+		 * @see JsonBox::ParallelWriter
 		 */
 		void writeToStream(std::ostream &output, bool indent = true,
-		                   bool escapeAll = false) const;
+		                   bool escapeAll = false,
+		                   unsigned int threadCount = 1) const;
 
 		/**
-		 * Writes the value to a JSON file. Uses writeToStream(...).
+		 * Writes the value to a JSON file. Uses writeToStream(...). Files
+		 * ending with ".gz" or ".zst" are compressed on the fly, in blocks,
+		 * as they are written.
 		 * @param filePath Path to the file to write.
 		 * @param indent Specifies if the output is to have nice indentation or
 		 * not.
 		 * @param escapeAll Specifies if all the JSON escapable characters
 		 * should be escaped or not.
+		 * @param threadCount Number of threads used to write the large arrays
+		 * and objects. 0 uses one thread per hardware thread.
 		 * @see JsonBox::Value::writeToStream
+		 * @see JsonBox::CompressingOutputStream
 		 */
 		void writeToFile(const std::string &filePath, bool indent = true,
-		                 bool escapeAll = false) const;
+		                 bool escapeAll = false,
+		                 unsigned int threadCount = 1) const;
+
+		/**
+		 * Loads a value from a stream containing MessagePack. Only the first
+		 * value in the stream is read. Integers that don't fit in an int are
+		 * loaded as doubles, binary data is loaded as strings and map keys
+		 * that are not strings are converted to strings. A JsonParsingError
+		 * is thrown if the arrays and maps are nested deeper than
+		 * BINARY_MAXIMUM_DEPTH levels.
+		 * @param input Input stream to read from. Can be a file stream.
+		 * @see JsonBox::Value::writeMsgPack
+		 */
+		void loadFromMsgPack(std::istream &input);
+
+		/**
+		 * Loads a value from a buffer containing MessagePack.
+		 * @param data Pointer to the first byte of the buffer.
+		 * @param size Number of bytes in the buffer.
+		 * @see JsonBox::Value::loadFromMsgPack(std::istream &input)
+		 */
+		void loadFromMsgPack(const char *data, size_t size);
+
+		/**
+		 * Writes the value to an output stream in MessagePack. Uses the most
+		 * compact encoding for each integer, double and string. Doubles are
+		 * written as 32 bit floats when it doesn't lose precision. Raw JSON
+		 * fragments are parsed and written as the values they contain.
+		 * @param output Output stream to write the value to.
+		 * @see JsonBox::Value::loadFromMsgPack
+		 */
+		void writeMsgPack(std::ostream &output) const;
+
+		/**
+		 * Appends the value to a buffer in MessagePack.
+		 * @param buffer String to append the encoded value to.
+		 * @see JsonBox::Value::writeMsgPack(std::ostream &output)
+		 */
+		void writeMsgPack(std::string &buffer) const;
+
+		/**
+		 * Loads a value from a stream containing CBOR (RFC 8949). Only the
+		 * first item in the stream is read. Indefinite length strings, arrays
+		 * and maps are supported, as are the RFC 8746 typed arrays except
+		 * the 128 bit floats ones. Other tags are ignored. Integers that
+		 * don't fit in an int are loaded as doubles, byte strings are loaded
+		 * as strings and map keys that are not strings are converted to
+		 * strings. A JsonParsingError is thrown if the arrays, maps and tags
+		 * are nested deeper than BINARY_MAXIMUM_DEPTH levels.
+		 * @param input Input stream to read from. Can be a file stream.
+		 * @param typedArrays Specifies if the typed arrays are loaded in the
+		 * matching typed array storage instead of the generic one.
+		 * @see JsonBox::Value::writeCbor
+		 */
+		void loadFromCbor(std::istream &input, bool typedArrays = false);
+
+		/**
+		 * Loads a value from a buffer containing CBOR.
+		 * @param data Pointer to the first byte of the buffer.
+		 * @param size Number of bytes in the buffer.
+		 * @param typedArrays Specifies if the typed arrays are loaded in the
+		 * matching typed array storage instead of the generic one.
+		 * @see JsonBox::Value::loadFromCbor(std::istream &input, bool typedArrays)
+		 */
+		void loadFromCbor(const char *data, size_t size,
+		                  bool typedArrays = false);
+
+		/**
+		 * Writes the value to an output stream in CBOR. Uses definite
+		 * lengths and the shortest encoding for each integer and length.
+		 * Doubles are written as single precision floats when it doesn't
+		 * lose precision.
+		 * @param output Output stream to write the value to.
+		 * @param typedArrays Specifies if the arrays containing only
+		 * integers or only doubles are written as RFC 8746 typed arrays.
+		 * @see JsonBox::Value::loadFromCbor
+		 * @see JsonBox::CborStreamWriter
+		 */
+		void writeCbor(std::ostream &output, bool typedArrays = false) const;
+
+		/**
+		 * Appends the value to a buffer in CBOR.
+		 * @param buffer String to append the encoded value to.
+		 * @param typedArrays Specifies if the arrays containing only
+		 * integers or only doubles are written as RFC 8746 typed arrays.
+		 * @see JsonBox::Value::writeCbor(std::ostream &output, bool typedArrays)
+		 */
+		void writeCbor(std::string &buffer, bool typedArrays = false) const;
+
+		/**
+		 * Loads a value from a stream containing Universal Binary JSON. Only
+		 * the first value in the stream is read. Integers that don't fit in
+		 * an int are loaded as doubles and high-precision numbers are parsed
+		 * like JSON numbers. A JsonParsingError is thrown if the arrays and
+		 * objects are nested deeper than BINARY_MAXIMUM_DEPTH levels.
+		 * @param input Input stream to read from. Can be a file stream.
+		 * @param typedArrays Specifies if the strongly typed arrays of
+		 * numbers are loaded in the matching typed array storage instead of
+		 * the generic one.
+		 * @see JsonBox::Value::writeUbjson
+		 */
+		void loadFromUbjson(std::istream &input, bool typedArrays = false);
+
+		/**
+		 * Loads a value from a buffer containing Universal Binary JSON.
+		 * @param data Pointer to the first byte of the buffer.
+		 * @param size Number of bytes in the buffer.
+		 * @param typedArrays Specifies if the strongly typed arrays of
+		 * numbers are loaded in the matching typed array storage instead of
+		 * the generic one.
+		 * @see JsonBox::Value::loadFromUbjson(std::istream &input, bool typedArrays)
+		 */
+		void loadFromUbjson(const char *data, size_t size,
+		                    bool typedArrays = false);
+
+		/**
+		 * Writes the value to an output stream in Universal Binary JSON.
+		 * Non-empty arrays containing only integers or only doubles are
+		 * written as strongly typed, count prefixed arrays: one type marker
+		 * followed by the numbers' bytes. Integers use the narrowest integer
+		 * type, doubles are written as 32 bit floats when it doesn't lose
+		 * precision and infinities and NaN are written as null.
+		 * @param output Output stream to write the value to.
+		 * @see JsonBox::Value::loadFromUbjson
+		 */
+		void writeUbjson(std::ostream &output) const;
+
+		/**
+		 * Appends the value to a buffer in Universal Binary JSON.
+		 * @param buffer String to append the encoded value to.
+		 * @see JsonBox::Value::writeUbjson(std::ostream &output)
+		 */
+		void writeUbjson(std::string &buffer) const;
+
+		/**
+		 * Writes the value to a snapshot file. Snapshots are opened with
+		 * JsonBox::Snapshot, which maps them in memory and reads them without
+		 * parsing. Raw JSON fragments are parsed and written as the values
+		 * they contain.
+		 * @param filePath Path to the snapshot file to write.
+		 * @see JsonBox::Snapshot
+		 */
+		void writeSnapshot(const std::string &filePath) const;
 	private:
+		/**
+		 * Contents of an integer or a double value. The numbers read by the
+		 * parser keep their JSON text, stored right after the structure in
+		 * the same allocation, and are converted the first time they are
+		 * accessed. The conversion is published through an atomic state, so
+		 * the number can be read from several threads. The writer outputs
+		 * the text of the numbers that were not modified, so they are
+		 * written back exactly as they were read, without losing precision.
+		 */
+		struct Number {
+			/**
+			 * Conversion states of a number.
+			 */
+			enum State {
+				/// Only the text contains the number.
+				TEXT,
+				/// A thread is storing the number converted from the text.
+				CONVERTING,
+				/// The integer or the double contains the number.
+				CONVERTED
+			};
+
+			/**
+			 * Parameterized constructor.
+			 * @param newInteger Integer contained by the number.
+			 */
+			explicit Number(int newInteger);
+
+			/**
+			 * Parameterized constructor.
+			 * @param newDouble Double contained by the number.
+			 */
+			explicit Number(double newDouble);
+
+			/**
+			 * Allocates a number read by the parser, with room for its text.
+			 * @param newText JSON text of the number, converted when the
+			 * number is first accessed.
+			 * @return Pointer to the new number, deleted like the others.
+			 */
+			static Number *create(const std::string &newText);
+
+			/**
+			 * Allocates a copy of a number, with room for its text.
+			 * @param src Number to copy.
+			 * @return Pointer to the new number, deleted like the others.
+			 */
+			static Number *copy(const Number &src);
+
+			/**
+			 * Replaces the number with the text of another number read by
+			 * the parser, reusing the number's allocation.
+			 * @param newText JSON text of the number, shorter than the
+			 * capacity.
+			 */
+			void setText(const std::string &newText);
+
+			/**
+			 * Frees a number, whether it was allocated with its text or
+			 * not.
+			 * @param pointer Pointer to the number's memory.
+			 */
+			static void operator delete(void *pointer);
+
+			/**
+			 * Gets the JSON text the number was read from.
+			 * @return Null-terminated text following the structure, which
+			 * must only be read if the length isn't 0.
+			 */
+			const char *getText() const;
+
+			/// Number of an integer or a double value, once converted.
+			union {
+				int integerValue;
+				double doubleValue;
+			} value;
+
+			/// Length of the JSON text, 0 if the number was set.
+			unsigned int length;
+
+			/// Room for the text after the structure, with its null
+			/// character. Capped, so the longest texts aren't reused.
+			unsigned short capacity;
+
+			/// Conversion state, CONVERTED if the number has no text.
+			std::atomic<unsigned char> state;
+
+		private:
+			/**
+			 * Allocates a number with room for a text after the structure.
+			 * @param room Number of bytes following the structure.
+			 * @return Pointer to the new number, containing 0.
+			 */
+			static Number *allocate(size_t room);
+
+			/**
+			 * Copy constructor, not implemented to prevent copies that
+			 * wouldn't carry the text.
+			 */
+			Number(const Number &src);
+
+			/**
+			 * Assignment operator, not implemented to prevent copies that
+			 * wouldn't carry the text.
+			 */
+			Number &operator=(const Number &src);
+		};
+
+		/**
+		 * Contents of a string value. The strings read by the parser keep
+		 * their escaped JSON text and are only unescaped the first time they
+		 * are accessed. The writer outputs the text of the strings read by
+		 * the parser as is when its escaping policy allows it. Strings
+		 * interned by a parser are shared by several values and copied
+		 * before being modified.
+		 */
+		struct String {
+			/**
+			 * Parameterized constructor.
+			 * @param newText Unescaped string contained by the value.
+			 */
+			explicit String(const std::string &newText);
+
+			/**
+			 * Copy constructor.
+			 * @param src String to copy.
+			 */
+			String(const String &src);
+
+			/**
+			 * Assignment operator.
+			 * @param src String to copy.
+			 * @return Reference to the modified string.
+			 */
+			String &operator=(const String &src);
+
+			/// String, or its JSON text if it contains escape sequences.
+			std::string text;
+
+			/// Whether the text contains escape sequences to decode.
+			bool escaped;
+
+			/// Whether the unescaped string was decoded from the text yet.
+			std::atomic<bool> decoded;
+
+			/// Text with its escape sequences decoded, once it is accessed.
+			std::string unescaped;
+
+			/// Whether the text was read by the parser and is valid JSON.
+			bool verbatim;
+
+			/// Number of values and parsers sharing the string, atomic so
+			/// values sharing it can be copied from several threads.
+			std::atomic<size_t> references;
+		};
+
+		/**
+		 * Object or array loaded lazily that wasn't parsed yet.
+		 */
+		struct LazyContainer {
+			/**
+			 * Parameterized constructor.
+			 * @param newDocument JSON document containing the container.
+			 * @param newPosition Offset of the container's opening bracket.
+			 */
+			LazyContainer(const std::shared_ptr<const std::string> &newDocument,
+			              size_t newPosition);
+
+			/// JSON document, shared by all its lazy containers.
+			std::shared_ptr<const std::string> document;
+
+			/// Offset of the container's opening bracket in the document.
+			size_t position;
+		};
+
+		/**
+		 * Serialized forms of a container cached by the writers, identified
+		 * by the writer's configuration and the indentation level the
+		 * container was written at.
+		 * @see JsonBox::ContainerCache
+		 */
+		typedef std::map<std::pair<const void *, unsigned int>, std::string> SerializedForms;
+
+		/**
+		 * State of the features a value opts into, kept behind a single
+		 * pointer so the values using none of them only pay for it.
+		 */
+		struct Extension {
+			/**
+			 * Default constructor.
+			 */
+			Extension();
+
+			/**
+			 * Destructor.
+			 */
+			~Extension();
+
+			/// Serialized forms cached by the writers using a
+			/// ContainerCache.
+			SerializedForms serializedForms;
+
+			/// Source of the contents of an object or an array loaded
+			/// lazily, NULL once they are parsed or if the value isn't lazy.
+			std::atomic<LazyContainer *> lazyContainer;
+
+			/// Error thrown by the lazy container's parsing, thrown again by
+			/// the later accesses.
+			std::exception_ptr lazyError;
+
+			/// Lock under which the serialized forms are filled and the lazy
+			/// container is parsed.
+			std::mutex mutex;
+
+		private:
+			/**
+			 * Copy constructor, not implemented to prevent copies.
+			 */
+			Extension(const Extension &src);
+
+			/**
+			 * Assignment operator, not implemented to prevent copies.
+			 */
+			Extension &operator=(const Extension &src);
+		};
+
 		/**
 		 * Union used to contain the pointer to the value's data.
 		 */
 		union ValueDataPointer {
-			std::string *stringValue;
-			int *intValue;
-			double *doubleValue;
+			String *stringValue;
+			std::string *rawJsonValue;
+			/// Used by both the integer and the double values.
+			Number *numberValue;
 			Object *objectValue;
 			Array *arrayValue;
+			std::vector<int32_t> *int32ArrayValue;
+			std::vector<int64_t> *int64ArrayValue;
+			std::vector<float> *floatArrayValue;
+			std::vector<double> *doubleArrayValue;
 			bool *boolValue;
 
 			/**
@@ -572,19 +1218,13 @@ namespace JsonBox {
 			 * Parameterized constructor.
 			 * @param newStringValue Pointer to set to the string pointer.
 			 */
-			ValueDataPointer(std::string *newStringValue);
+			ValueDataPointer(String *newStringValue);
 
 			/**
 			 * Parameterized constructor.
-			 * @param newIntValue Pointer to set to the int pointer.
+			 * @param newNumberValue Pointer to set to the number pointer.
 			 */
-			ValueDataPointer(int *newIntValue);
-
-			/**
-			 * Parameterized constructor.
-			 * @param newDoubleValue Pointer to set to the double pointer.
-			 */
-			ValueDataPointer(double *newDoubleValue);
+			ValueDataPointer(Number *newNumberValue);
 
 			/**
 			 * Parameterized constructor.
@@ -627,26 +1267,161 @@ namespace JsonBox {
 		static void readString(std::istream &input, std::string &result);
 
 		/**
-		 * Reads a JSON object from an input stream.
-		 * @param input Input stream to read the object from.
-		 * @param result Object read from the input stream.
+		 * Reads a JSON string from an input stream without decoding its
+		 * escape sequences. Throws a JsonParsingError if a \\u escape
+		 * sequence has less than four hexadecimal digits or if the input
+		 * ends before the closing quotation mark.
+		 * @param input Input stream to read the string value from, after
+		 * its opening quotation mark.
+		 * @param result String receiving the escaped text, in place of its
+		 * previous text so its capacity is reused.
 		 */
-		static void readObject(std::istream &input, Object &result);
+		static void readEscapedString(std::istream &input, String &result);
 
 		/**
-		 * Reads a JSON array from an input stream.
-		 * @param input Input stream to read the array from.
-		 * @param result Array read from the input stream.
+		 * Reads the four hexadecimal digits of a \\u escape sequence.
+		 * @param i Iterator on the first digit, moved past the digits read.
+		 * @param end End of the escaped text.
+		 * @return UTF-16 code unit read, or -1 if the digits are invalid.
+		 */
+		static int32_t readHexCodeUnit(std::string::const_iterator &i,
+		                               std::string::const_iterator end);
+
+		/**
+		 * Reads the literal null, true or false from an input stream.
+		 * Throws a JsonParsingError if null is misspelled.
+		 * @param input Input stream positioned after the literal's first
+		 * character.
+		 * @param firstCharacter First character of the literal.
+		 * @return True if the literal was read, false if a boolean was
+		 * misspelled.
+		 */
+		bool readLiteral(std::istream &input, char firstCharacter);
+
+		/**
+		 * Reads a JSON string from an input stream, sharing the parser's
+		 * interned string with the same text if it is short enough and has
+		 * no escape sequences.
+		 * @param input Input stream positioned after the opening quotation
+		 * mark.
+		 * @param parser Parser holding the interned strings.
 		 */
-		static void readArray(std::istream &input, Array &result);
+		void readInternedString(std::istream &input, Parser &parser);
+
+		/**
+		 * Gets the string of a copy of a value. A shared string is shared
+		 * by the copy as well, the others are copied.
+		 * @param string String of the value copied.
+		 * @return String of the copy.
+		 */
+		static String *copyString(String *string);
+
+		/**
+		 * Releases a value's string, deleting it if no other value or
+		 * parser shares it.
+		 * @param string String to release.
+		 */
+		static void releaseString(String *string);
+
+		/**
+		 * Decodes the escape sequences of a string read by the parser.
+		 * Invalid escape sequences are skipped.
+		 * @param escaped Text of the string between its quotation marks.
+		 * @param result UTF-8 string decoded.
+		 */
+		static void unescapeString(const std::string &escaped,
+		                           std::string &result);
+
+		/**
+		 * Reads the members and the elements of the arrays and objects on
+		 * the parser's stack, until the stack is back to a given size. The
+		 * nested containers are pushed on the stack instead of being read
+		 * recursively. The members already in the objects are reused if the
+		 * JSON has them and erased otherwise, the elements already in the
+		 * arrays are reused in place and the extra ones are erased.
+		 * @param input Input stream positioned in the innermost container.
+		 * @param container Lazy container being parsed, NULL if the nested
+		 * containers are parsed right away.
+		 * @param parser Parser holding the stack of containers.
+		 * @param base Size of the stack when the reading is done.
+		 */
+		static void readContainers(std::istream &input,
+		                           const LazyContainer *container,
+		                           Parser &parser, size_t base);
+
+		/**
+		 * Starts reading an array element or an object member's value from
+		 * an input stream. A nested array or object is only pushed on the
+		 * parser's stack.
+		 * @param input Input stream to read the value from.
+		 * @param result Value read from the input stream.
+		 * @param container Lazy container being parsed. If not NULL, objects
+		 * and arrays are skipped and loaded lazily.
+		 * @param projection Projection applied to the value, NULL if it is
+		 * loaded whole.
+		 * @param parser Parser holding the scratch buffers.
+		 * @return True if a value was started, false if the input ended
+		 * first.
+		 */
+		static bool readElement(std::istream &input, Value &result,
+		                        const LazyContainer *container,
+		                        const Projection *projection, Parser &parser);
+
+		/**
+		 * Finishes reading the innermost container on the parser's stack
+		 * and pops it. The members that weren't read are erased from an
+		 * object, the extra elements from an array.
+		 * @param parser Parser holding the stack of containers.
+		 */
+		static void endContainer(Parser &parser);
+
+		/**
+		 * Erases the members of an object that weren't read while parsing
+		 * it again.
+		 * @param object Object parsed.
+		 * @param members Members read, from the first one of the object.
+		 * Its entries for the object are removed.
+		 * @param firstMember Index of the object's first member read.
+		 */
+		static void eraseStaleMembers(Object &object,
+		                              std::vector<const Value *> &members,
+		                              size_t firstMember);
+
+		/**
+		 * Skips a JSON value in an input stream without parsing it. Objects
+		 * and arrays are skipped by matching their brackets.
+		 * @param input Input stream positioned on the value's first
+		 * character. Left on the character following the value.
+		 */
+		static void skipValue(std::istream &input);
+
+		/**
+		 * Deletes an object or an array without recursing into the nested
+		 * ones: they are taken from their parents and deleted in turn.
+		 * @param object Object to delete, or NULL.
+		 * @param array Generic array to delete, or NULL.
+		 */
+		static void deleteContainers(Object *object, Array *array);
+
+		/**
+		 * Takes the non-empty object or generic array of a value about to be
+		 * deleted, leaving a null value.
+		 * @param value Value to take the container from.
+		 * @param objects Receives the value's object.
+		 * @param arrays Receives the value's array.
+		 */
+		static void takeContainer(Value &value, std::vector<Object *> &objects,
+		                          std::vector<Array *> &arrays);
 
 		/**
 		 * Reads a JSON number from an input stream.
 		 * @param input Input stream to read the array from.
 		 * @param result Value containing the integer or the double read from
 		 * the input stream.
+		 * @param buffer Scratch buffer receiving the number's text.
 		 */
-		static void readNumber(std::istream &input, Value &result);
+		static void readNumber(std::istream &input, Value &result,
+		                       std::string &buffer);
 
 		/**
 		 * Advances through the input stream until it reaches a character that
@@ -659,34 +1434,271 @@ namespace JsonBox {
 		static void readToNonWhiteSpace(std::istream &input,
 		                                char &currentCharacter);
 
+		/**
+		 * Checks if a number read by the parser follows the JSON grammar.
+		 * Only those keep their text, so the writer never outputs invalid
+		 * numbers.
+		 * @param text Characters of the number read by the parser.
+		 * @return True if the text is a valid JSON number.
+		 */
+		static bool isJsonNumber(const std::string &text);
+
+		/**
+		 * Gets the number of an integer value, converting it from its JSON
+		 * text the first time if it was read by the parser. The first thread
+		 * to convert it keeps the conversion, so the value can be read from
+		 * several threads.
+		 * @return Number of the value, which must be an integer.
+		 */
+		int getIntegerNumber() const;
+
+		/**
+		 * Gets the number of a double value, converting it from its JSON
+		 * text the first time if it was read by the parser, like
+		 * getIntegerNumber().
+		 * @return Number of the value, which must be a double.
+		 */
+		double getDoubleNumber() const;
+
+		/**
+		 * Gets the JSON text of an integer or a double value that was read
+		 * by the parser and not modified since.
+		 * @return Null-terminated text of the number, or NULL if the value
+		 * isn't a number or the number has no text.
+		 */
+		const char *getNumberText() const;
+
+		/**
+		 * Gets the string of a string value, decoding its escape sequences
+		 * if it wasn't done yet. The decoding is done once, under a lock, in
+		 * a member separate from the text, so the value can be read from
+		 * several threads.
+		 * @return String of the value, which must be a string.
+		 */
+		const std::string &getUnescapedString() const;
+
+		/**
+		 * Gets the JSON text of a string value that was read by the parser
+		 * and can still be written as is.
+		 * @return Pointer to the string's text, without its quotation marks,
+		 * or NULL if the value isn't a string or the string must be escaped
+		 * again.
+		 */
+		const std::string *getVerbatimString() const;
+
+		/**
+		 * Reads a JSON document from an input stream, after detecting its
+		 * encoding.
+		 * @param input Input stream to read from.
+		 * @param projection Selects the object members to load, NULL to
+		 * load everything.
+		 * @param parser Parser holding the scratch buffers.
+		 * @see JsonBox::Encoding::detect
+		 */
+		void readDocument(std::istream &input, const Projection *projection,
+		                  Parser &parser);
+
+		/**
+		 * Reads a JSON value from an input stream in UTF-8. The containers
+		 * and strings the value already holds are reused.
+		 * @param input Input stream to read from.
+		 * @param projection Selects the object members to load, NULL to
+		 * load everything.
+		 * @param parser Parser holding the scratch buffers.
+		 * @return True if a value was read, false if the input ended first.
+		 */
+		bool readValue(std::istream &input, const Projection *projection,
+		               Parser &parser);
+
+		/**
+		 * Starts reading a JSON value from an input stream in UTF-8. Scalars
+		 * are read whole, arrays and objects are pushed on the parser's
+		 * stack, to be read by readContainers(...).
+		 * @param input Input stream to read from.
+		 * @param projection Selects the object members to load, NULL to
+		 * load everything.
+		 * @param parser Parser holding the scratch buffers.
+		 * @return True if a value was started, false if the input ended
+		 * first.
+		 */
+		bool beginValue(std::istream &input, const Projection *projection,
+		                Parser &parser);
+
+		/**
+		 * Makes the value an object or an array, keeping the container it
+		 * already holds, and pushes it on the parser's stack. Throws a JsonParsingError if
+		 * the stack is as deep as the parser allows.
+		 * @param bracket Opening bracket of the container.
+		 * @param projection Selects the object members to load, NULL to
+		 * load everything.
+		 * @param parser Parser holding the stack of containers.
+		 */
+		void beginContainer(char bracket, const Projection *projection,
+		                    Parser &parser);
+
+		/**
+		 * Loads the current value lazily from a JSON document, converted to
+		 * UTF-8 in place if needed.
+		 * @param document Buffer containing the JSON, shared by the lazy
+		 * containers.
+		 * @see JsonBox::Value::loadLazilyFromString
+		 */
+		void loadLazilyFromDocument(const std::shared_ptr<std::string> &document);
+
+		/**
+		 * Makes the value an object or an array parsed when first navigated.
+		 * @param document JSON document containing the container.
+		 * @param position Offset of the container's opening bracket.
+		 */
+		void setLazyContainer(const std::shared_ptr<const std::string> &document,
+		                      size_t position);
+
+		/**
+		 * Parses the value's contents if it is a lazy container that wasn't
+		 * parsed yet. Declared const so the const accessors can parse the
+		 * container, the same way the numbers are converted. The contents
+		 * are parsed aside, under the extension's lock, and only replace
+		 * the empty container once complete. A JsonParsingError is kept and
+		 * thrown again by the later calls.
+		 */
+		void parseLazyContainer() const;
+
+		/**
+		 * Copies another value's lazy container, if it still has one, under
+		 * its lock so it can't be parsed meanwhile.
+		 * @param src Value to copy, of the same type as the current value,
+		 * which holds no data yet.
+		 * @return True if the source was a lazy container, false if its
+		 * contents must be copied.
+		 */
+		bool copyLazyContainer(const Value &src);
+
 		/**
 		 * Frees up the dynamic memory allocated by the value.
 		 */
 		void clear();
 
 		/**
-		 * Outputs the value in JSON format.
+		 * Copies the array of another value, keeping its storage. The value
+		 * must not own any data.
+		 * @param src Value containing the array to copy.
+		 */
+		void copyArray(const Value &src);
+
+		/**
+		 * Converts the value's array to the generic storage if it uses a
+		 * typed one.
+		 */
+		void convertToGenericArray();
+
+		/**
+		 * Uses a typed storage for the value's array if all its elements are
+		 * integers or if all its elements are doubles, and if the writers
+		 * output them back as the text they were read from. Called by the
+		 * parser when its typed arrays are enabled.
+		 * @see JsonBox::Parser::setTypedArrays
+		 */
+		void detectTypedArray();
+
+		/**
+		 * Converts the value's arrays and the nested ones to the generic
+		 * storage. Called by the binary decoders when the typed arrays
+		 * aren't requested.
+		 */
+		void convertTypedArrays();
+
+		/**
+		 * Copies the value's array elements into numbers.
+		 * @param result Vector receiving the numbers.
+		 * @return True if all the elements are numbers that can be converted
+		 * to the vector's type.
+		 */
+		template <typename T>
+		bool copyNumbers(std::vector<T> &result) const;
+
+		/**
+		 * Gets the number of elements in the value's array.
+		 * @return Number of elements, whatever the array's storage.
+		 */
+		size_t getArraySize() const;
+
+		/**
+		 * Gets a copy of an element of the value's array.
+		 * @param index Index of the element, must be in range.
+		 * @return Copy of the element, whatever the array's storage.
+		 */
+		Value getArrayElement(size_t index) const;
+
+		/**
+		 * Checks if the value's array is equal to another value's array.
+		 * @param rhs Value containing the other array.
+		 * @return True if the arrays have equal elements.
+		 */
+		bool isArrayEqual(const Value &rhs) const;
+
+		/**
+		 * Checks if the value's array is lexicographically less than another
+		 * value's array.
+		 * @param rhs Value containing the other array.
+		 * @return True if the array is less than the other one.
+		 */
+		bool isArrayLess(const Value &rhs) const;
+
+		/**
+		 * Discards the serialized forms cached for the value. Called by all
+		 * the methods that can modify the value's contents.
+		 */
+		void discardSerializedForms();
+
+		/**
+		 * Gets the value's extension, creating it if the value has none
+		 * yet. Can be called from several threads at once.
+		 * @return Extension of the value.
+		 */
+		Extension &getExtension() const;
+
+		/**
+		 * Gets the lazy container whose contents weren't parsed yet.
+		 * @return Lazy container of the value, NULL if it isn't lazy.
+		 */
+		const LazyContainer *getLazyContainer() const;
+
+		/**
+		 * Outputs the value in JSON format. Picks the writer specialized for
+		 * the requested combination of indentation and escaping.
 		 * @param output Output stream used to output the value in JSON format.
 		 * @param indent Specifies if the JSON being output must be indented or
 		 * not. False is to output the JSON in compact format.
 		 * @param escapeAll Specifies if the strings must escape all characters
 		 * or only the minimum.
-		 * @see JsonBox::Value::escapeAllCharacters(const std::string str)
-		 * @see JsonBox::Value::escapeMinimumCharacters(const std::string str)
-		 * @see JsonBox::Value::output(std::ostream& output, unsigned int& level, bool indent, bool escapeAll)
+		 * @param threadCount Number of threads to use, the parallel writer is
+		 * only used when it is not 1.
+		 * @see JsonBox::Writer
+		 * @see JsonBox::ParallelWriter
 		 */
 		void output(std::ostream &output, bool indent = true,
-		            bool escapeAll = false) const;
+		            bool escapeAll = false, unsigned int threadCount = 1) const;
 
 		/**
 		 * Type of data the value contains.
 		 */
 		Type type;
 
+		/**
+		 * Storage used by the elements when the value is an array.
+		 */
+		ArrayStorage arrayStorage;
+
 		/**
 		 * Pointer to the Value's data.
 		 */
 		ValueDataPointer data;
+
+		/**
+		 * Cached serialized forms and lazy container, NULL if the value uses
+		 * neither. Created by the const writers, so it is atomic.
+		 */
+		mutable std::atomic<Extension *> extension;
 	};
 
 	/**
@@ -0,0 +1,535 @@
+#ifndef JB_WRITER_H
+#define JB_WRITER_H
+
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <JsonBox/Grammar.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	/**
+	 * Indentation policy that writes the JSON on a single line without any
+	 * whitespace between the tokens. Produces the same output as filtering
+	 * indented JSON through an IndentCanceller.
+	 * @see JsonBox::Writer
+	 * @see JsonBox::IndentCanceller
+	 */
+	struct Compact {
+		/**
+		 * Called where a line break would be written. Writes nothing.
+		 * @param output Output stream to write to.
+		 * @param level Indentation level of the new line.
+		 */
+		static void writeNewLine(std::ostream &/*output*/, unsigned int /*level*/) {
+		}
+
+		/**
+		 * Writes the separator between an object member's name and its
+		 * value.
+		 * @param output Output stream to write to.
+		 */
+		static void writeNameSeparator(std::ostream &output) {
+			output.put(Structural::NAME_SEPARATOR);
+		}
+	};
+
+	/**
+	 * Indentation policy that writes each array element and object member on
+	 * its own line. With the default parameters, produces the same output as
+	 * filtering the JSON through an Indenter at each level.
+	 * @tparam Width Number of indentation characters per level.
+	 * @tparam Character Character used to indent the lines.
+	 * @see JsonBox::Writer
+	 * @see JsonBox::Indenter
+	 */
+	template <unsigned int Width = 1, char Character = Whitespace::HORIZONTAL_TAB>
+	struct Pretty {
+		/**
+		 * Writes a line break followed by the indentation of the new line.
+		 * @param output Output stream to write to.
+		 * @param level Indentation level of the new line.
+		 */
+		static void writeNewLine(std::ostream &output, unsigned int level) {
+			output.put(Whitespace::NEW_LINE);
+
+			for (unsigned int i = level * Width; i > 0; --i) {
+				output.put(Character);
+			}
+		}
+
+		/**
+		 * Writes the separator between an object member's name and its
+		 * value.
+		 * @param output Output stream to write to.
+		 */
+		static void writeNameSeparator(std::ostream &output) {
+			output.put(Whitespace::SPACE);
+			output.put(Structural::NAME_SEPARATOR);
+			output.put(Whitespace::SPACE);
+		}
+	};
+
+	/**
+	 * Escaping policy that only escapes the characters JSON requires to be
+	 * escaped: the quotation mark, the reverse solidus and the control
+	 * characters.
+	 * @see JsonBox::Value::escapeMinimumCharacters
+	 * @see JsonBox::Escaper
+	 */
+	struct MinimumEscaping {
+		/**
+		 * Checks if a character has to be escaped in a string.
+		 * @param character Character to check.
+		 * @return True if the character must be escaped, false if not.
+		 */
+		static bool isEscaped(char character) {
+			return isCharacterClass(character, CharacterClass::ESCAPED);
+		}
+
+		/**
+		 * Checks if a string read by the parser can be written with its
+		 * original escaping.
+		 * @param escaped Valid JSON text of the string.
+		 * @return Always true, valid JSON text escapes at least the minimum.
+		 */
+		static bool isVerbatim(const std::string &/*escaped*/) {
+			return true;
+		}
+	};
+
+	/**
+	 * Escaping policy that escapes all the JSON escapable characters, which
+	 * means the solidi are also escaped.
+	 * @see JsonBox::Value::escapeAllCharacters
+	 * @see JsonBox::SolidusEscaper
+	 */
+	struct AllEscaping {
+		/**
+		 * Checks if a character has to be escaped in a string.
+		 * @param character Character to check.
+		 * @return True if the character must be escaped, false if not.
+		 */
+		static bool isEscaped(char character) {
+			return isCharacterClass(character, CharacterClass::ESCAPED_ALL);
+		}
+
+		/**
+		 * Checks if a string read by the parser can be written with its
+		 * original escaping.
+		 * @param escaped Valid JSON text of the string.
+		 * @return True if the text doesn't contain any solidus.
+		 */
+		static bool isVerbatim(const std::string &escaped) {
+			return escaped.find(Strings::Std::SOLIDUS) == std::string::npos;
+		}
+	};
+
+	/**
+	 * Caching policy that doesn't cache anything, every value is written
+	 * from scratch.
+	 * @see JsonBox::Writer
+	 */
+	struct NoCache {
+		/// Specifies that the containers' serialized forms are not cached.
+		static const bool CACHES_CONTAINERS = false;
+	};
+
+	/**
+	 * Caching policy that keeps the serialized form of each object and array
+	 * inside the value, for each writer configuration and indentation level
+	 * the container is written with. Writing the same value again only copies
+	 * the cached bytes of the containers that didn't change.
+	 *
+	 * The cached forms of a value are discarded by all its non-const methods.
+	 * Since the members and elements are reached through the non-const
+	 * bracket operators, modifying a value deep in a tree discards the cached
+	 * forms of all the containers on the path from the root, and only those.
+	 * A reference to a member or element obtained before writing must be
+	 * obtained again through the bracket operators before modifying it, or
+	 * the containers holding it will keep their stale forms.
+	 *
+	 * Each cached container keeps its own copy of its serialized bytes, so
+	 * the memory used grows with the depth of the tree.
+	 *
+	 * The forms are filled under a lock held by each container, so the same
+	 * value can be written from several threads at once, as long as none of
+	 * them modifies it.
+	 * @see JsonBox::Writer
+	 */
+	struct ContainerCache {
+		/// Specifies that the containers' serialized forms are cached.
+		static const bool CACHES_CONTAINERS = true;
+	};
+
+	/**
+	 * Writes values as JSON. The formatting is chosen at compile time through
+	 * the policies, so each combination is compiled into its own specialized
+	 * writing loop instead of stacking output filters on the stream.
+	 * For example, to write with four spaces of indentation:
+	 * @code
+	 * JsonBox::Writer<JsonBox::Pretty<4, ' '>, JsonBox::MinimumEscaping>::write(std::cout, value);
+	 * @endcode
+	 * The members of objects are always written sorted by name, since
+	 * objects are sorted maps.
+	 * @tparam IndentPolicy Either JsonBox::Compact or a JsonBox::Pretty.
+	 * @tparam EscapePolicy Either JsonBox::MinimumEscaping or
+	 * JsonBox::AllEscaping.
+	 * @tparam CachePolicy Either JsonBox::NoCache or JsonBox::ContainerCache.
+	 * @see JsonBox::Value::writeToStream
+	 */
+	template <typename IndentPolicy, typename EscapePolicy,
+	          typename CachePolicy = NoCache>
+	class Writer {
+	public:
+		/**
+		 * Writes a value as JSON.
+		 * @param output Output stream to write the value to.
+		 * @param value Value to write.
+		 */
+		static void write(std::ostream &output, const Value &value) {
+			std::streamsize precisionBackup = output.precision(17);
+			writeValue(output, value, 0);
+			output.precision(precisionBackup);
+		}
+
+		/**
+		 * Writes an object as JSON.
+		 * @param output Output stream to write the object to.
+		 * @param object Object to write.
+		 */
+		static void write(std::ostream &output, const Object &object) {
+			std::streamsize precisionBackup = output.precision(17);
+			writeObject(output, object, 0);
+			output.precision(precisionBackup);
+		}
+
+		/**
+		 * Writes an array as JSON.
+		 * @param output Output stream to write the array to.
+		 * @param array Array to write.
+		 */
+		static void write(std::ostream &output, const Array &array) {
+			std::streamsize precisionBackup = output.precision(17);
+			writeArray(output, array, 0);
+			output.precision(precisionBackup);
+		}
+
+		/**
+		 * Writes a value at a given indentation level. Expects the stream's
+		 * precision to already be set for the doubles.
+		 * @param output Output stream to write the value to.
+		 * @param value Value to write.
+		 * @param level Indentation level of the line the value starts on.
+		 */
+		static void writeValue(std::ostream &output, const Value &value,
+		                       unsigned int level) {
+			switch (value.getType()) {
+			case Value::STRING:
+				if (value.getVerbatimString() && EscapePolicy::isVerbatim(*value.getVerbatimString())) {
+					output.put(Structural::BEGIN_END_STRING);
+					output << *value.getVerbatimString();
+					output.put(Structural::BEGIN_END_STRING);
+
+				} else {
+					writeString(output, value.getString());
+				}
+
+				break;
+
+			case Value::INTEGER:
+				if (value.getNumberText()) {
+					output << value.getNumberText();
+
+				} else {
+					output << value.getInteger();
+				}
+
+				break;
+
+			case Value::DOUBLE:
+				if (value.getNumberText()) {
+					output << value.getNumberText();
+
+				} else {
+					output << value.getDouble();
+				}
+
+				break;
+
+			case Value::OBJECT:
+				if (CachePolicy::CACHES_CONTAINERS) {
+					writeCachedContainer(output, value, level);
+
+				} else {
+					writeObject(output, value.getObject(), level);
+				}
+
+				break;
+
+			case Value::ARRAY:
+				if (CachePolicy::CACHES_CONTAINERS) {
+					writeCachedContainer(output, value, level);
+
+				} else if (value.getArrayStorage() != Value::GENERIC_ARRAY) {
+					writeTypedArray(output, value, level);
+
+				} else {
+					writeArray(output, value.getArray(), level);
+				}
+
+				break;
+
+			case Value::BOOLEAN:
+				output << (value.getBoolean() ? Literals::TRUE_STRING : Literals::FALSE_STRING);
+				break;
+
+			case Value::NULL_VALUE:
+				output << Literals::NULL_STRING;
+				break;
+
+			case Value::RAW_JSON:
+				output << value.getRawJson();
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		/**
+		 * Writes an object at a given indentation level.
+		 * @param output Output stream to write the object to.
+		 * @param object Object to write.
+		 * @param level Indentation level of the line the object starts on.
+		 */
+		static void writeObject(std::ostream &output, const Object &object,
+		                        unsigned int level) {
+			output.put(Structural::BEGIN_OBJECT);
+
+			if (!object.empty()) {
+				for (Object::const_iterator i = object.begin(); i != object.end(); ++i) {
+					if (i != object.begin()) {
+						output.put(Structural::VALUE_SEPARATOR);
+					}
+
+					IndentPolicy::writeNewLine(output, level + 1);
+					writeString(output, i->first);
+					IndentPolicy::writeNameSeparator(output);
+					writeValue(output, i->second, level + 1);
+				}
+
+				IndentPolicy::writeNewLine(output, level);
+			}
+
+			output.put(Structural::END_OBJECT);
+		}
+
+		/**
+		 * Writes an array at a given indentation level.
+		 * @param output Output stream to write the array to.
+		 * @param array Array to write.
+		 * @param level Indentation level of the line the array starts on.
+		 */
+		static void writeArray(std::ostream &output, const Array &array,
+		                       unsigned int level) {
+			output.put(Structural::BEGIN_ARRAY);
+
+			if (!array.empty()) {
+				for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+					if (i != array.begin()) {
+						output.put(Structural::VALUE_SEPARATOR);
+					}
+
+					IndentPolicy::writeNewLine(output, level + 1);
+					writeValue(output, *i, level + 1);
+				}
+
+				IndentPolicy::writeNewLine(output, level);
+			}
+
+			output.put(Structural::END_ARRAY);
+		}
+
+		/**
+		 * Writes an array using a typed storage at a given indentation level,
+		 * directly from its numbers. Produces the same output as writing the
+		 * array's generic form.
+		 * @param output Output stream to write the array to.
+		 * @param value Value containing the array.
+		 * @param level Indentation level of the line the array starts on.
+		 * @see JsonBox::Value::getArrayStorage
+		 */
+		static void writeTypedArray(std::ostream &output, const Value &value,
+		                            unsigned int level) {
+			switch (value.getArrayStorage()) {
+			case Value::INT32_ARRAY:
+				writeNumbers(output, value.getInt32Array(), level);
+				break;
+
+			case Value::INT64_ARRAY:
+				writeNumbers(output, value.getInt64Array(), level);
+				break;
+
+			case Value::FLOAT_ARRAY:
+				writeNumbers(output, value.getFloatArray(), level);
+				break;
+
+			case Value::DOUBLE_ARRAY:
+				writeNumbers(output, value.getDoubleArray(), level);
+				break;
+
+			default:
+				writeArray(output, value.getArray(), level);
+				break;
+			}
+		}
+
+		/**
+		 * Writes a string between quotation marks, escaping its characters.
+		 * The runs of characters that don't need escaping are written in a
+		 * single call.
+		 * @param output Output stream to write the string to.
+		 * @param str String to write.
+		 */
+		static void writeString(std::ostream &output, const std::string &str) {
+			const char *run = str.data();
+			const char *end = run + str.size();
+
+			output.put(Structural::BEGIN_END_STRING);
+
+			for (const char *i = run; i != end; ++i) {
+				if (EscapePolicy::isEscaped(*i)) {
+					output.write(run, i - run);
+					writeEscapedCharacter(output, *i);
+					run = i + 1;
+				}
+			}
+
+			output.write(run, end - run);
+			output.put(Structural::BEGIN_END_STRING);
+		}
+
+	private:
+		/**
+		 * Gets the address identifying the writer's configuration in the
+		 * cached serialized forms.
+		 * @return Address unique to the writer's policies.
+		 */
+		static const void *configuration() {
+			static const char IDENTIFIER = 0;
+			return &IDENTIFIER;
+		}
+
+		/**
+		 * Writes an object or an array using its cached serialized form. If
+		 * there is none for the configuration and the level, the container
+		 * is written into a new one.
+		 * @param output Output stream to write the container to.
+		 * @param value Value containing the object or the array.
+		 * @param level Indentation level of the line the container starts on.
+		 */
+		static void writeCachedContainer(std::ostream &output, const Value &value,
+		                                 unsigned int level) {
+			Value::SerializedForms::key_type key(configuration(), level);
+			Value::Extension &extension = value.getExtension();
+			Value::SerializedForms::iterator form;
+			bool cached;
+
+			{
+				std::lock_guard<std::mutex> lock(extension.mutex);
+				form = extension.serializedForms.find(key);
+				cached = (form != extension.serializedForms.end());
+			}
+
+			// The form is written without holding the lock, the container
+			// can be lazy and take it to be parsed. Only the non-const
+			// methods erase forms, so the iterator stays valid.
+			if (!cached) {
+				std::ostringstream formStream;
+				formStream.imbue(output.getloc());
+				formStream.flags(output.flags());
+				formStream.precision(output.precision());
+
+				if (value.type == Value::OBJECT) {
+					writeObject(formStream, value.getObject(), level);
+
+				} else if (value.getArrayStorage() != Value::GENERIC_ARRAY) {
+					writeTypedArray(formStream, value, level);
+
+				} else {
+					writeArray(formStream, *value.data.arrayValue, level);
+				}
+
+				std::lock_guard<std::mutex> lock(extension.mutex);
+				form = extension.serializedForms.insert(std::make_pair(key, formStream.str())).first;
+			}
+
+			output.write(form->second.data(), form->second.size());
+		}
+
+		/**
+		 * Writes the numbers of a typed array with the same layout as
+		 * writeArray(...).
+		 * @param output Output stream to write the array to.
+		 * @param numbers Numbers of the array.
+		 * @param level Indentation level of the line the array starts on.
+		 */
+		template <typename T>
+		static void writeNumbers(std::ostream &output, NumericSpan<const T> numbers,
+		                         unsigned int level) {
+			output.put(Structural::BEGIN_ARRAY);
+
+			if (!numbers.empty()) {
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					if (i != numbers.begin()) {
+						output.put(Structural::VALUE_SEPARATOR);
+					}
+
+					IndentPolicy::writeNewLine(output, level + 1);
+					writeNumber(output, *i);
+				}
+
+				IndentPolicy::writeNewLine(output, level);
+			}
+
+			output.put(Structural::END_ARRAY);
+		}
+
+		/**
+		 * Writes a typed array's number like its generic element would be.
+		 * @param output Output stream to write the number to.
+		 * @param number Number to write.
+		 */
+		static void writeNumber(std::ostream &output, int32_t number) {
+			output << number;
+		}
+
+		static void writeNumber(std::ostream &output, int64_t number) {
+			output << number;
+		}
+
+		static void writeNumber(std::ostream &output, float number) {
+			output << static_cast<double>(number);
+		}
+
+		static void writeNumber(std::ostream &output, double number) {
+			output << number;
+		}
+
+		/**
+		 * Writes the JSON escape sequence of a character.
+		 * @param output Output stream to write the escape sequence to.
+		 * @param character Character to escape.
+		 */
+		static void writeEscapedCharacter(std::ostream &output, char character) {
+			char sequence[6];
+			output.write(sequence, getEscapeSequence(character, sequence));
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,963 @@
+#include <JsonBox/CborStreamWriter.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+#include <JsonBox/BinaryStream.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	// CBOR major types, additional information and simple values.
+	namespace Cbor {
+		const uint8_t UNSIGNED_INTEGER = 0x00;
+		const uint8_t NEGATIVE_INTEGER = 0x20;
+		const uint8_t BYTE_STRING = 0x40;
+		const uint8_t TEXT_STRING = 0x60;
+		const uint8_t ARRAY = 0x80;
+		const uint8_t MAP = 0xa0;
+		const uint8_t TAG = 0xc0;
+		const uint8_t MAJOR_TYPE_MASK = 0xe0;
+
+		const uint8_t ADDITIONAL_INFORMATION_MASK = 0x1f;
+		const uint8_t ONE_BYTE_ARGUMENT = 24;
+		const uint8_t EIGHT_BYTES_ARGUMENT = 27;
+		const uint8_t INDEFINITE_LENGTH = 31;
+
+		const uint8_t FALSE_VALUE = 0xf4;
+		const uint8_t TRUE_VALUE = 0xf5;
+		const uint8_t NULL_VALUE = 0xf6;
+		const uint8_t UNDEFINED_VALUE = 0xf7;
+		const uint8_t HALF_FLOAT = 0xf9;
+		const uint8_t SINGLE_FLOAT = 0xfa;
+		const uint8_t DOUBLE_FLOAT = 0xfb;
+		const uint8_t BREAK = 0xff;
+
+		// RFC 8746 typed array tags, 0b010fsell.
+		const uint64_t FIRST_TYPED_ARRAY_TAG = 64;
+		const uint64_t LAST_TYPED_ARRAY_TAG = 87;
+		const uint64_t SINT8_ARRAY_TAG = 72;
+		const uint64_t SINT16_BIG_ENDIAN_ARRAY_TAG = 73;
+		const uint64_t SINT32_BIG_ENDIAN_ARRAY_TAG = 74;
+		const uint64_t SINT64_BIG_ENDIAN_ARRAY_TAG = 75;
+		const uint64_t FLOAT32_BIG_ENDIAN_ARRAY_TAG = 81;
+		const uint64_t FLOAT64_BIG_ENDIAN_ARRAY_TAG = 82;
+		const unsigned int TYPED_ARRAY_FLOAT = 0x10;
+		const unsigned int TYPED_ARRAY_SIGNED = 0x08;
+		const unsigned int TYPED_ARRAY_LITTLE_ENDIAN = 0x04;
+		const unsigned int TYPED_ARRAY_SIZE_MASK = 0x03;
+	}
+
+	namespace {
+		/**
+		 * Converts an IEEE 754 half precision float to a double.
+		 * @param half Bits of the half precision float.
+		 * @return Double with the same value.
+		 */
+		double halfToDouble(uint16_t half) {
+			int exponent = (half >> 10) & 0x1f;
+			int mantissa = half & 0x3ff;
+			double result;
+
+			if (exponent == 0) {
+				result = std::ldexp(static_cast<double>(mantissa), -24);
+
+			} else if (exponent != 0x1f) {
+				result = std::ldexp(static_cast<double>(mantissa + 0x400), exponent - 25);
+
+			} else if (mantissa == 0) {
+				result = std::numeric_limits<double>::infinity();
+
+			} else {
+				result = std::numeric_limits<double>::quiet_NaN();
+			}
+
+			return (half & 0x8000) ? (-result) : (result);
+		}
+
+		/**
+		 * Writes the head of an item using the shortest argument encoding.
+		 * @param sink Sink to write the head to.
+		 * @param majorType Major type of the item.
+		 * @param argument Value, length or tag number carried by the head.
+		 */
+		template <typename Sink>
+		void writeCborHead(Sink &sink, uint8_t majorType, uint64_t argument) {
+			if (argument < Cbor::ONE_BYTE_ARGUMENT) {
+				sink.put(static_cast<uint8_t>(majorType | argument));
+
+			} else if (argument <= 0xff) {
+				sink.put(majorType | Cbor::ONE_BYTE_ARGUMENT);
+				sink.put(static_cast<uint8_t>(argument));
+
+			} else if (argument <= 0xffff) {
+				sink.put(majorType | (Cbor::ONE_BYTE_ARGUMENT + 1));
+				putBigEndian(sink, argument, 2);
+
+			} else if (argument <= 0xffffffffu) {
+				sink.put(majorType | (Cbor::ONE_BYTE_ARGUMENT + 2));
+				putBigEndian(sink, argument, 4);
+
+			} else {
+				sink.put(majorType | Cbor::EIGHT_BYTES_ARGUMENT);
+				putBigEndian(sink, argument, 8);
+			}
+		}
+
+		/**
+		 * Writes an integer item.
+		 * @param sink Sink to write the integer to.
+		 * @param integer Integer to write.
+		 */
+		template <typename Sink>
+		void writeCborInteger(Sink &sink, int64_t integer) {
+			if (integer >= 0) {
+				writeCborHead(sink, Cbor::UNSIGNED_INTEGER, static_cast<uint64_t>(integer));
+
+			} else {
+				writeCborHead(sink, Cbor::NEGATIVE_INTEGER, static_cast<uint64_t>(-1 - integer));
+			}
+		}
+
+		/**
+		 * Writes a floating point item, as a single precision float if it
+		 * doesn't lose precision.
+		 * @param sink Sink to write the double to.
+		 * @param number Double to write.
+		 */
+		template <typename Sink>
+		void writeCborDouble(Sink &sink, double number) {
+			if (isExactFloat(number)) {
+				sink.put(Cbor::SINGLE_FLOAT);
+				putBigEndian(sink, floatToBits(static_cast<float>(number)), 4);
+
+			} else {
+				sink.put(Cbor::DOUBLE_FLOAT);
+				putBigEndian(sink, doubleToBits(number), 8);
+			}
+		}
+
+		/**
+		 * Writes a text string item.
+		 * @param sink Sink to write the string to.
+		 * @param str String to write.
+		 */
+		template <typename Sink>
+		void writeCborString(Sink &sink, const std::string &str) {
+			writeCborHead(sink, Cbor::TEXT_STRING, str.size());
+			sink.write(str.data(), str.size());
+		}
+
+		/**
+		 * Writes an array as an RFC 8746 typed array if all its elements are
+		 * integers or all its elements are doubles. Integers use the
+		 * narrowest signed big-endian element type holding all of them,
+		 * doubles are written as single precision floats if none of them
+		 * loses precision.
+		 * @param sink Sink to write the array to.
+		 * @param array Array to write.
+		 * @return True if the array was written, false if it is empty or not
+		 * homogeneous and nothing was written.
+		 */
+		template <typename Sink>
+		bool writeCborTypedArray(Sink &sink, const Array &array) {
+			uint64_t tag;
+			unsigned int elementSize;
+
+			if (array.empty()) {
+				return false;
+
+			} else if (array.front().isInteger()) {
+				int minimum = 0, maximum = 0;
+
+				for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+					if (!i->isInteger()) {
+						return false;
+					}
+
+					minimum = std::min(minimum, i->getInteger());
+					maximum = std::max(maximum, i->getInteger());
+				}
+
+				if (minimum >= -0x80 && maximum < 0x80) {
+					tag = Cbor::SINT8_ARRAY_TAG;
+					elementSize = 1;
+
+				} else if (minimum >= -0x8000 && maximum < 0x8000) {
+					tag = Cbor::SINT16_BIG_ENDIAN_ARRAY_TAG;
+					elementSize = 2;
+
+				} else {
+					tag = Cbor::SINT32_BIG_ENDIAN_ARRAY_TAG;
+					elementSize = 4;
+				}
+
+			} else if (array.front().isDouble()) {
+				bool exactFloats = true;
+
+				for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+					if (!i->isDouble()) {
+						return false;
+					}
+
+					exactFloats = exactFloats && isExactFloat(i->getDouble());
+				}
+
+				tag = (exactFloats) ? (Cbor::FLOAT32_BIG_ENDIAN_ARRAY_TAG) : (Cbor::FLOAT64_BIG_ENDIAN_ARRAY_TAG);
+				elementSize = (exactFloats) ? (4) : (8);
+
+			} else {
+				return false;
+			}
+
+			writeCborHead(sink, Cbor::TAG, tag);
+			writeCborHead(sink, Cbor::BYTE_STRING, static_cast<uint64_t>(array.size()) * elementSize);
+
+			for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+				if (i->isInteger()) {
+					putBigEndian(sink, static_cast<uint64_t>(static_cast<int64_t>(i->getInteger())), elementSize);
+
+				} else if (elementSize == 4) {
+					putBigEndian(sink, floatToBits(static_cast<float>(i->getDouble())), 4);
+
+				} else {
+					putBigEndian(sink, doubleToBits(i->getDouble()), 8);
+				}
+			}
+
+			return true;
+		}
+
+		/**
+		 * Writes a number of an array using a typed storage.
+		 * @param sink Sink to write the number to.
+		 * @param number Number to write.
+		 */
+		template <typename Sink>
+		void writeCborNumber(Sink &sink, int32_t number) {
+			writeCborInteger(sink, number);
+		}
+
+		template <typename Sink>
+		void writeCborNumber(Sink &sink, int64_t number) {
+			writeCborInteger(sink, number);
+		}
+
+		template <typename Sink>
+		void writeCborNumber(Sink &sink, float number) {
+			writeCborDouble(sink, number);
+		}
+
+		template <typename Sink>
+		void writeCborNumber(Sink &sink, double number) {
+			writeCborDouble(sink, number);
+		}
+
+		/**
+		 * Gets the range of integers of an array using a typed storage.
+		 * @param numbers Numbers of the array.
+		 * @param minimum Receives the smallest number, 0 if there are none.
+		 * @param maximum Receives the largest number, 0 if there are none.
+		 */
+		template <typename T>
+		void getCborIntegerRange(NumericSpan<const T> numbers, int64_t &minimum,
+		                         int64_t &maximum) {
+			minimum = maximum = 0;
+
+			for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+				minimum = std::min<int64_t>(minimum, *i);
+				maximum = std::max<int64_t>(maximum, *i);
+			}
+		}
+
+		/**
+		 * Writes the numbers of an array using a typed storage, as a typed
+		 * array if asked to and if it isn't empty or as a regular array
+		 * otherwise. Integers use the narrowest signed big-endian element
+		 * type holding all of them, floats are written as single precision
+		 * floats and so are doubles if none of them loses precision.
+		 * @param sink Sink to write the array to.
+		 * @param numbers Numbers of the array.
+		 * @param typedArrays Specifies if the array is written as a typed
+		 * array.
+		 */
+		template <typename Sink, typename T>
+		void writeCborNumbers(Sink &sink, NumericSpan<const T> numbers,
+		                      bool typedArrays) {
+			if (!typedArrays || numbers.empty()) {
+				writeCborHead(sink, Cbor::ARRAY, numbers.size());
+
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					writeCborNumber(sink, *i);
+				}
+
+			} else {
+				uint64_t tag;
+				unsigned int elementSize;
+				bool isFloat = !std::numeric_limits<T>::is_integer;
+				int64_t minimum = 0, maximum = 0;
+
+				if (!isFloat) {
+					getCborIntegerRange(numbers, minimum, maximum);
+				}
+
+				if (isFloat) {
+					bool exactFloats = true;
+
+					for (const T *i = numbers.begin(); exactFloats && i != numbers.end(); ++i) {
+						exactFloats = isExactFloat(*i);
+					}
+
+					tag = (exactFloats) ? (Cbor::FLOAT32_BIG_ENDIAN_ARRAY_TAG) : (Cbor::FLOAT64_BIG_ENDIAN_ARRAY_TAG);
+					elementSize = (exactFloats) ? (4) : (8);
+
+				} else if (minimum >= -0x80 && maximum < 0x80) {
+					tag = Cbor::SINT8_ARRAY_TAG;
+					elementSize = 1;
+
+				} else if (minimum >= -0x8000 && maximum < 0x8000) {
+					tag = Cbor::SINT16_BIG_ENDIAN_ARRAY_TAG;
+					elementSize = 2;
+
+				} else if (minimum >= INT32_MIN && maximum <= INT32_MAX) {
+					tag = Cbor::SINT32_BIG_ENDIAN_ARRAY_TAG;
+					elementSize = 4;
+
+				} else {
+					tag = Cbor::SINT64_BIG_ENDIAN_ARRAY_TAG;
+					elementSize = 8;
+				}
+
+				writeCborHead(sink, Cbor::TAG, tag);
+				writeCborHead(sink, Cbor::BYTE_STRING, static_cast<uint64_t>(numbers.size()) * elementSize);
+
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					if (!isFloat) {
+						putBigEndian(sink, static_cast<uint64_t>(static_cast<int64_t>(*i)), elementSize);
+
+					} else if (elementSize == 4) {
+						putBigEndian(sink, floatToBits(static_cast<float>(*i)), 4);
+
+					} else {
+						putBigEndian(sink, doubleToBits(static_cast<double>(*i)), 8);
+					}
+				}
+			}
+		}
+
+		/**
+		 * Writes a value and all its contents.
+		 * @param sink Sink to write the value to.
+		 * @param value Value to write.
+		 * @param typedArrays Specifies if arrays of numbers are written as
+		 * typed arrays.
+		 */
+		template <typename Sink>
+		void writeCborValue(Sink &sink, const Value &value, bool typedArrays) {
+			switch (value.getType()) {
+			case Value::STRING:
+				writeCborString(sink, value.getString());
+				break;
+
+			case Value::INTEGER:
+				writeCborInteger(sink, value.getInteger());
+				break;
+
+			case Value::DOUBLE:
+				writeCborDouble(sink, value.getDouble());
+				break;
+
+			case Value::OBJECT: {
+					const Object &object = value.getObject();
+					writeCborHead(sink, Cbor::MAP, object.size());
+
+					for (Object::const_iterator i = object.begin(); i != object.end(); ++i) {
+						writeCborString(sink, i->first);
+						writeCborValue(sink, i->second, typedArrays);
+					}
+				}
+				break;
+
+			case Value::ARRAY:
+				switch (value.getArrayStorage()) {
+				case Value::INT32_ARRAY:
+					writeCborNumbers(sink, value.getInt32Array(), typedArrays);
+					break;
+
+				case Value::INT64_ARRAY:
+					writeCborNumbers(sink, value.getInt64Array(), typedArrays);
+					break;
+
+				case Value::FLOAT_ARRAY:
+					writeCborNumbers(sink, value.getFloatArray(), typedArrays);
+					break;
+
+				case Value::DOUBLE_ARRAY:
+					writeCborNumbers(sink, value.getDoubleArray(), typedArrays);
+					break;
+
+				default: {
+					const Array &array = value.getArray();
+
+					if (!typedArrays || !writeCborTypedArray(sink, array)) {
+						writeCborHead(sink, Cbor::ARRAY, array.size());
+
+						for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+							writeCborValue(sink, *i, typedArrays);
+						}
+					}
+				}
+					break;
+				}
+
+				break;
+
+			case Value::BOOLEAN:
+				sink.put(value.getBoolean() ? Cbor::TRUE_VALUE : Cbor::FALSE_VALUE);
+				break;
+
+			case Value::RAW_JSON: {
+					Value parsed;
+					parsed.loadFromString(value.getRawJson());
+					writeCborValue(sink, parsed, typedArrays);
+				}
+				break;
+
+			default:
+				sink.put(Cbor::NULL_VALUE);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * Reads CBOR items. Declared as a friend of Value so the strings, arrays
+	 * and objects are filled in place.
+	 */
+	class CborReader {
+	public:
+		/**
+		 * Reads an item and all its contents. Throws a JsonParsingError if
+		 * its arrays, maps and tags are nested deeper than
+		 * BINARY_MAXIMUM_DEPTH.
+		 * @param source Source to read the item from.
+		 * @param result Value replaced by the item read.
+		 * @param depth Number of arrays, maps and tags containing the item.
+		 */
+		template <typename Source>
+		static void read(Source &source, Value &result, unsigned int depth = 0) {
+			readItem(source, source.get(), result, depth);
+		}
+
+	private:
+		/**
+		 * Reads an item whose initial byte was already read.
+		 * @param source Source to read the rest of the item from.
+		 * @param initialByte Initial byte of the item.
+		 * @param result Value replaced by the item read.
+		 * @param depth Number of arrays, maps and tags containing the item.
+		 */
+		template <typename Source>
+		static void readItem(Source &source, uint8_t initialByte, Value &result,
+		                     unsigned int depth) {
+			switch (initialByte & Cbor::MAJOR_TYPE_MASK) {
+			case Cbor::UNSIGNED_INTEGER:
+				setUnsigned(readArgument(source, initialByte), result);
+				break;
+
+			case Cbor::NEGATIVE_INTEGER:
+				setNegative(readArgument(source, initialByte), result);
+				break;
+
+			case Cbor::BYTE_STRING:
+			case Cbor::TEXT_STRING:
+				result.setString(std::string());
+				readStringBytes(source, initialByte, result.data.stringValue->text);
+				break;
+
+			case Cbor::ARRAY:
+				readArray(source, initialByte, result, depth);
+				break;
+
+			case Cbor::MAP:
+				readMap(source, initialByte, result, depth);
+				break;
+
+			case Cbor::TAG:
+				readTagged(source, readArgument(source, initialByte), result, depth);
+				break;
+
+			default:
+				readSimple(source, initialByte, result);
+				break;
+			}
+		}
+
+		/**
+		 * Reads the argument of an item's head. Throws a JsonParsingError if
+		 * the head has no argument.
+		 * @param source Source to read the argument from.
+		 * @param initialByte Initial byte of the item.
+		 * @return Argument of the head.
+		 */
+		template <typename Source>
+		static uint64_t readArgument(Source &source, uint8_t initialByte) {
+			uint8_t additionalInformation = initialByte & Cbor::ADDITIONAL_INFORMATION_MASK;
+
+			if (additionalInformation < Cbor::ONE_BYTE_ARGUMENT) {
+				return additionalInformation;
+
+			} else if (additionalInformation <= Cbor::EIGHT_BYTES_ARGUMENT) {
+				return getBigEndian(source, 1u << (additionalInformation - Cbor::ONE_BYTE_ARGUMENT));
+
+			} else {
+				throw JsonParsingError("Invalid CBOR item head found.");
+			}
+		}
+
+		/**
+		 * Checks if an item's head announces an indefinite length.
+		 * @param initialByte Initial byte of the item.
+		 * @return True if the item is an indefinite length string, array or
+		 * map.
+		 */
+		static bool isIndefinite(uint8_t initialByte) {
+			return (initialByte & Cbor::ADDITIONAL_INFORMATION_MASK) == Cbor::INDEFINITE_LENGTH;
+		}
+
+		/**
+		 * Reads the bytes of a byte or text string, joining the chunks of
+		 * indefinite length strings.
+		 * @param source Source to read the bytes from.
+		 * @param initialByte Initial byte of the string.
+		 * @param result String replaced by the bytes read.
+		 */
+		template <typename Source>
+		static void readStringBytes(Source &source, uint8_t initialByte,
+		                            std::string &result) {
+			if (isIndefinite(initialByte)) {
+				std::string chunk;
+				uint8_t chunkInitialByte;
+				result.clear();
+
+				while ((chunkInitialByte = source.get()) != Cbor::BREAK) {
+					if ((chunkInitialByte & Cbor::MAJOR_TYPE_MASK) != (initialByte & Cbor::MAJOR_TYPE_MASK) ||
+					    isIndefinite(chunkInitialByte)) {
+						throw JsonParsingError("Invalid CBOR string chunk found.");
+					}
+
+					source.read(chunk, static_cast<size_t>(readArgument(source, chunkInitialByte)));
+					result += chunk;
+				}
+
+			} else {
+				source.read(result, static_cast<size_t>(readArgument(source, initialByte)));
+			}
+		}
+
+		/**
+		 * Reads the elements of an array.
+		 * @param source Source to read the elements from.
+		 * @param initialByte Initial byte of the array.
+		 * @param result Value replaced by the array.
+		 * @param depth Number of arrays, maps and tags containing the array.
+		 */
+		template <typename Source>
+		static void readArray(Source &source, uint8_t initialByte, Value &result,
+		                      unsigned int depth) {
+			requireDepth(depth);
+			result.setArray(Array());
+			Array &array = *result.data.arrayValue;
+
+			if (isIndefinite(initialByte)) {
+				uint8_t elementInitialByte;
+
+				while ((elementInitialByte = source.get()) != Cbor::BREAK) {
+					array.push_back(Value());
+					readItem(source, elementInitialByte, array.back(), depth + 1);
+				}
+
+			} else {
+				uint64_t count = readArgument(source, initialByte);
+				source.requireElements(count);
+				array.resize(static_cast<size_t>(count));
+
+				for (Array::iterator i = array.begin(); i != array.end(); ++i) {
+					read(source, *i, depth + 1);
+				}
+			}
+		}
+
+		/**
+		 * Reads the members of a map.
+		 * @param source Source to read the members from.
+		 * @param initialByte Initial byte of the map.
+		 * @param result Value replaced by the object.
+		 * @param depth Number of arrays, maps and tags containing the map.
+		 */
+		template <typename Source>
+		static void readMap(Source &source, uint8_t initialByte, Value &result,
+		                    unsigned int depth) {
+			requireDepth(depth);
+			result.setObject(Object());
+			Object &object = *result.data.objectValue;
+
+			if (isIndefinite(initialByte)) {
+				uint8_t keyInitialByte;
+
+				while ((keyInitialByte = source.get()) != Cbor::BREAK) {
+					readMember(source, keyInitialByte, object, depth + 1);
+				}
+
+			} else {
+				uint64_t count = readArgument(source, initialByte);
+				source.requireElements(count);
+
+				for (uint64_t i = 0; i < count; ++i) {
+					readMember(source, source.get(), object, depth + 1);
+				}
+			}
+		}
+
+		/**
+		 * Reads a map member. Keys that are not strings are converted to
+		 * strings.
+		 * @param source Source to read the member from.
+		 * @param keyInitialByte Initial byte of the member's key.
+		 * @param object Object the member is added to.
+		 * @param depth Number of arrays, maps and tags containing the member.
+		 */
+		template <typename Source>
+		static void readMember(Source &source, uint8_t keyInitialByte,
+		                       Object &object, unsigned int depth) {
+			Value key;
+			readItem(source, keyInitialByte, key, depth);
+
+			if (key.isString()) {
+				read(source, object[key.getString()], depth);
+
+			} else if (key.isStringable()) {
+				read(source, object[key.getToString()], depth);
+
+			} else {
+				throw JsonParsingError("Invalid CBOR map key found.");
+			}
+		}
+
+		/**
+		 * Reads a tagged item. Typed arrays are decoded into arrays of
+		 * numbers, the other tags are ignored and the tagged item is read
+		 * as is.
+		 * @param source Source to read the tagged item from.
+		 * @param tag Tag number.
+		 * @param result Value replaced by the item read.
+		 * @param depth Number of arrays, maps and tags containing the tag.
+		 */
+		template <typename Source>
+		static void readTagged(Source &source, uint64_t tag, Value &result,
+		                       unsigned int depth) {
+			requireDepth(depth);
+
+			uint8_t initialByte = source.get();
+
+			if (tag >= Cbor::FIRST_TYPED_ARRAY_TAG && tag <= Cbor::LAST_TYPED_ARRAY_TAG) {
+				std::string bytes;
+
+				if ((initialByte & Cbor::MAJOR_TYPE_MASK) != Cbor::BYTE_STRING) {
+					throw JsonParsingError("Invalid CBOR typed array found.");
+				}
+
+				readStringBytes(source, initialByte, bytes);
+				readTypedArray(static_cast<unsigned int>(tag - Cbor::FIRST_TYPED_ARRAY_TAG), bytes, result);
+
+			} else {
+				readItem(source, initialByte, result, depth + 1);
+			}
+		}
+
+		/**
+		 * Decodes the elements of a typed array into an array value using
+		 * the matching typed storage. Integers use a 32 bit storage if they
+		 * all fit in it, unsigned 64 bit integers too large for a signed
+		 * storage give a generic array of doubles.
+		 * @param format Low bits of the typed array's tag, giving the type,
+		 * the byte order and the size of the elements.
+		 * @param bytes Content of the typed array's byte string.
+		 * @param result Value replaced by the array.
+		 * @see JsonBox::Value::getArrayStorage
+		 */
+		static void readTypedArray(unsigned int format, const std::string &bytes,
+		                           Value &result) {
+			bool isFloat = (format & Cbor::TYPED_ARRAY_FLOAT) != 0;
+			bool isSigned = (format & Cbor::TYPED_ARRAY_SIGNED) != 0;
+			bool isLittleEndian = (format & Cbor::TYPED_ARRAY_LITTLE_ENDIAN) != 0;
+			unsigned int elementSize = (isFloat ? 2u : 1u) << (format & Cbor::TYPED_ARRAY_SIZE_MASK);
+
+			if (elementSize > 8) {
+				throw JsonParsingError("Unsupported CBOR typed array found.");
+
+			} else if (bytes.size() % elementSize != 0) {
+				throw JsonParsingError("Invalid CBOR typed array found.");
+			}
+
+			size_t count = bytes.size() / elementSize;
+			std::vector<double> numbers;
+			std::vector<int64_t> integers;
+			bool fitsInt32 = true, fitsInt64 = true;
+			const unsigned char *element = reinterpret_cast<const unsigned char *>(bytes.data());
+
+			if (isFloat) {
+				numbers.reserve(count);
+
+			} else {
+				integers.reserve(count);
+			}
+
+			for (size_t i = 0; i < count; ++i, element += elementSize) {
+				uint64_t bits = 0;
+
+				for (unsigned int j = 0; j < elementSize; ++j) {
+					if (isLittleEndian) {
+						bits |= static_cast<uint64_t>(element[j]) << (8 * j);
+
+					} else {
+						bits = (bits << 8) | element[j];
+					}
+				}
+
+				if (isFloat) {
+					if (elementSize == 2) {
+						numbers.push_back(halfToDouble(static_cast<uint16_t>(bits)));
+
+					} else if (elementSize == 4) {
+						numbers.push_back(bitsToFloat(static_cast<uint32_t>(bits)));
+
+					} else {
+						numbers.push_back(bitsToDouble(bits));
+					}
+
+				} else {
+					int64_t integer;
+
+					if (isSigned) {
+						unsigned int unusedBits = 64 - 8 * elementSize;
+						integer = static_cast<int64_t>(bits << unusedBits) >> unusedBits;
+
+					} else {
+						fitsInt64 = fitsInt64 && bits <= static_cast<uint64_t>(INT64_MAX);
+						integer = static_cast<int64_t>(bits);
+					}
+
+					fitsInt32 = fitsInt32 && integer >= INT32_MIN && integer <= INT32_MAX;
+					integers.push_back(integer);
+				}
+			}
+
+			if (isFloat && elementSize <= 4) {
+				// Half and single precision floats are exact as floats.
+				result.setTypedArray(std::vector<float>(numbers.begin(), numbers.end()));
+
+			} else if (isFloat) {
+				result.setTypedArray(std::vector<double>());
+				result.data.doubleArrayValue->swap(numbers);
+
+			} else if (fitsInt32) {
+				result.setTypedArray(std::vector<int32_t>(integers.begin(), integers.end()));
+
+			} else if (fitsInt64) {
+				result.setTypedArray(std::vector<int64_t>());
+				result.data.int64ArrayValue->swap(integers);
+
+			} else {
+				result.setArray(Array());
+				Array &array = *result.data.arrayValue;
+				array.resize(count);
+
+				for (size_t i = 0; i < count; ++i) {
+					setUnsigned(static_cast<uint64_t>(integers[i]), array[i]);
+				}
+			}
+		}
+
+		/**
+		 * Reads a simple value or a floating point number.
+		 * @param source Source to read the number from.
+		 * @param initialByte Initial byte of the item.
+		 * @param result Value replaced by the item read.
+		 */
+		template <typename Source>
+		static void readSimple(Source &source, uint8_t initialByte, Value &result) {
+			switch (initialByte) {
+			case Cbor::FALSE_VALUE:
+				result.setBoolean(false);
+				break;
+
+			case Cbor::TRUE_VALUE:
+				result.setBoolean(true);
+				break;
+
+			case Cbor::NULL_VALUE:
+			case Cbor::UNDEFINED_VALUE:
+				result.setNull();
+				break;
+
+			case Cbor::HALF_FLOAT:
+				result.setDouble(halfToDouble(static_cast<uint16_t>(getBigEndian(source, 2))));
+				break;
+
+			case Cbor::SINGLE_FLOAT:
+				result.setDouble(bitsToFloat(static_cast<uint32_t>(getBigEndian(source, 4))));
+				break;
+
+			case Cbor::DOUBLE_FLOAT:
+				result.setDouble(bitsToDouble(getBigEndian(source, 8)));
+				break;
+
+			default:
+				throw JsonParsingError("Unsupported CBOR simple value found.");
+			}
+		}
+
+		/**
+		 * Sets a value to an unsigned integer, as a double if it doesn't fit
+		 * in an int.
+		 * @param integer Integer to set.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setUnsigned(uint64_t integer, Value &result) {
+			if (integer <= static_cast<uint64_t>(INT_MAX)) {
+				result.setInteger(static_cast<int>(integer));
+
+			} else {
+				result.setDouble(static_cast<double>(integer));
+			}
+		}
+
+		/**
+		 * Sets a value to a signed integer, as a double if it doesn't fit in
+		 * an int.
+		 * @param integer Integer to set.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setSigned(int64_t integer, Value &result) {
+			if (integer >= INT_MIN && integer <= INT_MAX) {
+				result.setInteger(static_cast<int>(integer));
+
+			} else {
+				result.setDouble(static_cast<double>(integer));
+			}
+		}
+
+		/**
+		 * Sets a value to the negative integer -1 - argument, as a double if
+		 * it doesn't fit in an int.
+		 * @param argument Argument of the negative integer item.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setNegative(uint64_t argument, Value &result) {
+			if (argument <= static_cast<uint64_t>(INT_MAX)) {
+				result.setInteger(-1 - static_cast<int>(argument));
+
+			} else {
+				result.setDouble(-1.0 - static_cast<double>(argument));
+			}
+		}
+	};
+
+	CborStreamWriter::CborStreamWriter(std::ostream &newOutput,
+	                                   bool newTypedArrays) :
+		output(newOutput), typedArrays(newTypedArrays), openContainerCount(0) {
+	}
+
+	void CborStreamWriter::writeNull() {
+		output.put(static_cast<char>(Cbor::NULL_VALUE));
+	}
+
+	void CborStreamWriter::writeBoolean(bool boolean) {
+		output.put(static_cast<char>(boolean ? Cbor::TRUE_VALUE : Cbor::FALSE_VALUE));
+	}
+
+	void CborStreamWriter::writeInteger(int integer) {
+		StreamSink sink(output);
+		writeCborInteger(sink, integer);
+	}
+
+	void CborStreamWriter::writeDouble(double number) {
+		StreamSink sink(output);
+		writeCborDouble(sink, number);
+	}
+
+	void CborStreamWriter::writeString(const std::string &str) {
+		StreamSink sink(output);
+		writeCborString(sink, str);
+	}
+
+	void CborStreamWriter::writeValue(const Value &value) {
+		StreamSink sink(output);
+		writeCborValue(sink, value, typedArrays);
+	}
+
+	void CborStreamWriter::beginArray() {
+		output.put(static_cast<char>(Cbor::ARRAY | Cbor::INDEFINITE_LENGTH));
+		++openContainerCount;
+	}
+
+	void CborStreamWriter::beginArray(size_t size) {
+		StreamSink sink(output);
+		writeCborHead(sink, Cbor::ARRAY, size);
+	}
+
+	void CborStreamWriter::beginMap() {
+		output.put(static_cast<char>(Cbor::MAP | Cbor::INDEFINITE_LENGTH));
+		++openContainerCount;
+	}
+
+	void CborStreamWriter::beginMap(size_t size) {
+		StreamSink sink(output);
+		writeCborHead(sink, Cbor::MAP, size);
+	}
+
+	void CborStreamWriter::end() {
+		if (openContainerCount == 0) {
+			throw JsonWritingError("No CBOR array or map of unknown size to end.");
+		}
+
+		output.put(static_cast<char>(Cbor::BREAK));
+		--openContainerCount;
+	}
+
+	unsigned int CborStreamWriter::getOpenContainerCount() const {
+		return openContainerCount;
+	}
+
+	void Value::loadFromCbor(std::istream &input, bool typedArrays) {
+		StreamSource source(input);
+		CborReader::read(source, *this);
+
+		if (!typedArrays) {
+			convertTypedArrays();
+		}
+	}
+
+	void Value::loadFromCbor(const char *data, size_t size, bool typedArrays) {
+		MemorySource source(data, size);
+		CborReader::read(source, *this);
+
+		if (!typedArrays) {
+			convertTypedArrays();
+		}
+	}
+
+	void Value::writeCbor(std::ostream &output, bool typedArrays) const {
+		StreamSink sink(output);
+		writeCborValue(sink, *this, typedArrays);
+	}
+
+	void Value::writeCbor(std::string &buffer, bool typedArrays) const {
+		StringSink sink(buffer);
+		writeCborValue(sink, *this, typedArrays);
+	}
+}
@@ -0,0 +1,458 @@
+#include <JsonBox/CompressedStream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+
+#ifdef JSONBOX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace JsonBox {
+	/// Number of bytes compressed or decompressed at once.
+	static const size_t BLOCK_SIZE = 128 * 1024;
+
+	/// Number of decompressed characters kept to be put back.
+	static const size_t PUTBACK_SIZE = 16;
+
+	/**
+	 * Decompresses blocks of data in one of the supported formats.
+	 */
+	class DecompressingStreambuf::Decoder {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * format isn't supported.
+		 * @param newFormat Compression format to decompress.
+		 */
+		explicit Decoder(Compression::Format newFormat) : format(newFormat),
+			complete(false) {
+			if (format == Compression::NONE || !Compression::isSupported(format)) {
+				throw std::invalid_argument("Unsupported compression format.");
+			}
+
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				std::memset(&zlibStream, 0, sizeof(zlibStream));
+
+				// Adding 32 to the window bits accepts gzip and zlib headers.
+				if (inflateInit2(&zlibStream, 15 + 32) != Z_OK) {
+					throw std::bad_alloc();
+				}
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				zstdStream = ZSTD_createDStream();
+
+				if (!zstdStream) {
+					throw std::bad_alloc();
+				}
+			}
+#endif
+		}
+
+		/**
+		 * Destructor.
+		 */
+		~Decoder() {
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				inflateEnd(&zlibStream);
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				ZSTD_freeDStream(zstdStream);
+			}
+#endif
+		}
+
+		/**
+		 * Decompresses as much of the compressed data as fits in the output.
+		 * @param next Next compressed byte, moved past the bytes used.
+		 * @param end End of the compressed bytes, must not be equal to next.
+		 * @param outputNext Where to write the decompressed bytes, moved past
+		 * the bytes written.
+		 * @param outputEnd End of the room for the decompressed bytes.
+		 */
+		void decode(const char *&next, const char *end, char *&outputNext,
+		            char *outputEnd) {
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				if (complete) {
+					// Another gzip member follows the one that ended.
+					inflateReset(&zlibStream);
+					complete = false;
+				}
+
+				zlibStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(next));
+				zlibStream.avail_in = static_cast<uInt>(end - next);
+				zlibStream.next_out = reinterpret_cast<Bytef *>(outputNext);
+				zlibStream.avail_out = static_cast<uInt>(outputEnd - outputNext);
+				int status = inflate(&zlibStream, Z_NO_FLUSH);
+				next = reinterpret_cast<const char *>(zlibStream.next_in);
+				outputNext = reinterpret_cast<char *>(zlibStream.next_out);
+
+				if (status == Z_STREAM_END) {
+					complete = true;
+
+				} else if (status != Z_OK && status != Z_BUF_ERROR) {
+					throw JsonParsingError("Invalid gzip data found.");
+				}
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				ZSTD_inBuffer in = {next, static_cast<size_t>(end - next), 0};
+				ZSTD_outBuffer out = {outputNext, static_cast<size_t>(outputEnd - outputNext), 0};
+				size_t status = ZSTD_decompressStream(zstdStream, &out, &in);
+
+				if (ZSTD_isError(status)) {
+					throw JsonParsingError("Invalid zstd data found.");
+				}
+
+				next += in.pos;
+				outputNext += out.pos;
+				complete = (status == 0);
+			}
+#endif
+		}
+
+		/**
+		 * Checks if the data decompressed so far ends a gzip member or a
+		 * zstd frame, so the compressed data can end there.
+		 * @return True if the compressed stream is complete.
+		 */
+		bool isComplete() const {
+			return complete;
+		}
+
+	private:
+		/// Compression format to decompress.
+		Compression::Format format;
+
+		/// Specifies if the compressed stream is complete.
+		bool complete;
+
+#ifdef JSONBOX_HAVE_ZLIB
+		/// State of the gzip decompression.
+		z_stream zlibStream;
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+		/// State of the zstd decompression.
+		ZSTD_DStream *zstdStream;
+#endif
+	};
+
+	/**
+	 * Compresses blocks of data in one of the supported formats.
+	 */
+	class CompressingStreambuf::Encoder {
+	public:
+		/**
+		 * Parameterized constructor. Throws an std::invalid_argument if the
+		 * format isn't supported.
+		 * @param newFormat Compression format to compress to.
+		 */
+		explicit Encoder(Compression::Format newFormat) : format(newFormat) {
+			if (format == Compression::NONE || !Compression::isSupported(format)) {
+				throw std::invalid_argument("Unsupported compression format.");
+			}
+
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				std::memset(&zlibStream, 0, sizeof(zlibStream));
+
+				// Adding 16 to the window bits writes a gzip header.
+				if (deflateInit2(&zlibStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+				                 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+					throw std::bad_alloc();
+				}
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				zstdStream = ZSTD_createCCtx();
+
+				if (!zstdStream) {
+					throw std::bad_alloc();
+				}
+			}
+#endif
+		}
+
+		/**
+		 * Destructor.
+		 */
+		~Encoder() {
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				deflateEnd(&zlibStream);
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				ZSTD_freeCCtx(zstdStream);
+			}
+#endif
+		}
+
+		/**
+		 * Compresses as much data as fits in the output.
+		 * @param next Next byte to compress, moved past the bytes used.
+		 * @param end End of the bytes to compress.
+		 * @param outputNext Where to write the compressed bytes, moved past
+		 * the bytes written.
+		 * @param outputEnd End of the room for the compressed bytes.
+		 * @param mode Specifies if the compressor is also flushed or if the
+		 * compressed stream is ended.
+		 * @return True if all the bytes were compressed and, depending on
+		 * the mode, flushed or ended, false if more room is needed.
+		 */
+		bool encode(const char *&next, const char *end, char *&outputNext,
+		            char *outputEnd, FlushMode mode) {
+			bool done = true;
+
+#ifdef JSONBOX_HAVE_ZLIB
+			if (format == Compression::GZIP) {
+				zlibStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(next));
+				zlibStream.avail_in = static_cast<uInt>(end - next);
+				zlibStream.next_out = reinterpret_cast<Bytef *>(outputNext);
+				zlibStream.avail_out = static_cast<uInt>(outputEnd - outputNext);
+				int status = deflate(&zlibStream, (mode == FINISH) ? (Z_FINISH) : ((mode == SYNC_FLUSH) ? (Z_SYNC_FLUSH) : (Z_NO_FLUSH)));
+				next = reinterpret_cast<const char *>(zlibStream.next_in);
+				outputNext = reinterpret_cast<char *>(zlibStream.next_out);
+
+				if (status == Z_STREAM_ERROR) {
+					throw JsonWritingError("Failed to compress the output.");
+				}
+
+				done = (mode == FINISH) ? (status == Z_STREAM_END) : (next == end && zlibStream.avail_out != 0);
+			}
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+			if (format == Compression::ZSTD) {
+				ZSTD_inBuffer in = {next, static_cast<size_t>(end - next), 0};
+				ZSTD_outBuffer out = {outputNext, static_cast<size_t>(outputEnd - outputNext), 0};
+				size_t remaining = ZSTD_compressStream2(zstdStream, &out, &in, (mode == FINISH) ? (ZSTD_e_end) : ((mode == SYNC_FLUSH) ? (ZSTD_e_flush) : (ZSTD_e_continue)));
+
+				if (ZSTD_isError(remaining)) {
+					throw JsonWritingError("Failed to compress the output.");
+				}
+
+				next += in.pos;
+				outputNext += out.pos;
+				done = (mode == NO_FLUSH) ? (in.pos == in.size) : (remaining == 0);
+			}
+#endif
+
+			return done;
+		}
+
+	private:
+		/// Compression format to compress to.
+		Compression::Format format;
+
+#ifdef JSONBOX_HAVE_ZLIB
+		/// State of the gzip compression.
+		z_stream zlibStream;
+#endif
+
+#ifdef JSONBOX_HAVE_ZSTD
+		/// State of the zstd compression.
+		ZSTD_CCtx *zstdStream;
+#endif
+	};
+
+	Compression::Format Compression::getFormat(const std::string &filePath) {
+		Format result = NONE;
+
+		if (filePath.size() >= 3 && filePath.compare(filePath.size() - 3, 3, ".gz") == 0) {
+			result = GZIP;
+
+		} else if (filePath.size() >= 4 && filePath.compare(filePath.size() - 4, 4, ".zst") == 0) {
+			result = ZSTD;
+		}
+
+		return result;
+	}
+
+	bool Compression::isSupported(Format format) {
+		switch (format) {
+		case NONE:
+			return true;
+
+		case GZIP:
+#ifdef JSONBOX_HAVE_ZLIB
+			return true;
+#else
+			return false;
+#endif
+
+		case ZSTD:
+#ifdef JSONBOX_HAVE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+
+		default:
+			return false;
+		}
+	}
+
+	DecompressingStreambuf::DecompressingStreambuf(std::streambuf *newSource,
+	                                               Compression::Format format) :
+		source(newSource), decoder(new Decoder(format)), input(BLOCK_SIZE),
+		inputNext(NULL), inputEnd(NULL), output(PUTBACK_SIZE + BLOCK_SIZE) {
+	}
+
+	DecompressingStreambuf::~DecompressingStreambuf() {
+		delete decoder;
+	}
+
+	DecompressingStreambuf::int_type DecompressingStreambuf::underflow() {
+		if (gptr() == egptr()) {
+			// The last characters are moved in front of the block so they
+			// can still be put back.
+			size_t putbackSize = std::min<size_t>(gptr() - eback(), PUTBACK_SIZE);
+			char *begin = &output[PUTBACK_SIZE];
+			char *next = begin;
+			bool sourceEnded = false;
+
+			if (putbackSize > 0) {
+				std::memmove(begin - putbackSize, gptr() - putbackSize, putbackSize);
+			}
+
+			while (next == begin && !sourceEnded) {
+				if (inputNext == inputEnd) {
+					std::streamsize count = source->sgetn(&input[0], static_cast<std::streamsize>(input.size()));
+					inputNext = &input[0];
+					inputEnd = inputNext + std::max<std::streamsize>(count, 0);
+					sourceEnded = (inputNext == inputEnd);
+				}
+
+				if (inputNext != inputEnd) {
+					decoder->decode(inputNext, inputEnd, next, &output[0] + output.size());
+
+				} else if (!decoder->isComplete()) {
+					throw JsonParsingError("Compressed input ends incorrectly.");
+				}
+			}
+
+			setg(begin - putbackSize, begin, next);
+		}
+
+		return (gptr() == egptr()) ? (traits_type::eof()) : (traits_type::to_int_type(*gptr()));
+	}
+
+	CompressingStreambuf::CompressingStreambuf(std::streambuf *newDestination,
+	                                           Compression::Format format) :
+		destination(newDestination), encoder(new Encoder(format)),
+		input(BLOCK_SIZE), output(BLOCK_SIZE) {
+		setp(&input[0], &input[0] + input.size());
+	}
+
+	CompressingStreambuf::~CompressingStreambuf() {
+		try {
+			finish();
+
+		} catch (...) {
+		}
+
+		delete encoder;
+	}
+
+	void CompressingStreambuf::finish() {
+		if (encoder) {
+			compressBuffer(FINISH);
+			delete encoder;
+			encoder = NULL;
+			setp(NULL, NULL);
+
+			if (destination->pubsync() == -1) {
+				throw JsonWritingError("Failed to write the compressed output.");
+			}
+		}
+	}
+
+	CompressingStreambuf::int_type CompressingStreambuf::overflow(int_type ch) {
+		int_type result = traits_type::eof();
+
+		if (encoder) {
+			compressBuffer(NO_FLUSH);
+
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+
+			result = traits_type::not_eof(ch);
+		}
+
+		return result;
+	}
+
+	int CompressingStreambuf::sync() {
+		int result = 0;
+
+		if (encoder) {
+			compressBuffer(SYNC_FLUSH);
+			result = destination->pubsync();
+		}
+
+		return result;
+	}
+
+	void CompressingStreambuf::compressBuffer(FlushMode mode) {
+		const char *next = pbase();
+		const char *end = pptr();
+		bool done = false;
+
+		while (!done) {
+			char *outputNext = &output[0];
+			done = encoder->encode(next, end, outputNext, &output[0] + output.size(), mode);
+			std::streamsize size = outputNext - &output[0];
+
+			if (size > 0 && destination->sputn(&output[0], size) != size) {
+				throw JsonWritingError("Failed to write the compressed output.");
+			}
+		}
+
+		setp(&input[0], &input[0] + input.size());
+	}
+
+	DecompressingInputStream::DecompressingInputStream(std::istream &source,
+	                                                   Compression::Format format) :
+		std::istream(NULL), buffer(source.rdbuf(), format) {
+		rdbuf(&buffer);
+		exceptions(std::ios::badbit);
+	}
+
+	CompressingOutputStream::CompressingOutputStream(std::ostream &destination,
+	                                                 Compression::Format format) :
+		std::ostream(NULL), buffer(destination.rdbuf(), format) {
+		rdbuf(&buffer);
+		exceptions(std::ios::badbit);
+	}
+
+	void CompressingOutputStream::finish() {
+		buffer.finish();
+	}
+}
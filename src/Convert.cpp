@@ -1,112 +1,278 @@
 #include <JsonBox/Convert.h>
 
-#include <sstream>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define         MASKBITS                0x3F //00111111
 #define         MASK1BYTE               0x80 //10000000
 #define         MASK2BYTES              0xC0 //11000000
 #define         MASK3BYTES              0xE0 //11100000
 #define         MASK4BYTES              0xF0 //11110000
-#define         MASK5BYTES              0xF8 //11111000
-#define         MASK6BYTES              0xFC //11111100
 
 namespace JsonBox {
-	std::string Convert::encodeToUTF8(const String32& utf32String) {
-		std::stringstream result;
+	namespace {
+		/**
+		 * Finds the end of a run of ASCII characters, checking 16 bytes at a
+		 * time with SSE2 when it is available, 8 bytes at a time otherwise.
+		 * @param bytes Bytes to scan.
+		 * @param position Position of the first byte to check.
+		 * @param size Number of bytes.
+		 * @return Position of the first byte that isn't ASCII, or size.
+		 */
+		size_t skipASCII(const unsigned char *bytes, size_t position, size_t size) {
+#ifdef __SSE2__
+			while (position + 16 <= size &&
+			       _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + position))) == 0) {
+				position += 16;
+			}
+#else
+			uint64_t block;
+
+			while (position + 8 <= size) {
+				std::memcpy(&block, bytes + position, 8);
+
+				if (block & 0x8080808080808080ULL) {
+					break;
+				}
 
-		for(String32::const_iterator i = utf32String.begin() ; i < utf32String.end(); ++i) {
-			// 0xxxxxxx
-			if(*i < 0x80) {
-				result << static_cast<char>(*i);
+				position += 8;
 			}
-			// 110xxxxx 10xxxxxx
-			else if(*i < 0x800) {
-				result << static_cast<char>(MASK2BYTES | (*i >> 6));
-				result << static_cast<char>(MASK1BYTE | (*i & MASKBITS));
+#endif
+
+			while (position < size && bytes[position] < MASK1BYTE) {
+				++position;
 			}
-			// 1110xxxx 10xxxxxx 10xxxxxx
-			else if(*i < 0x10000) {
-				result << static_cast<char>(MASK3BYTES | (*i >> 12));
-				result << static_cast<char>(MASK1BYTE | (*i >> 6 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i & MASKBITS));
+
+			return position;
+		}
+
+		/**
+		 * Decodes a UTF-8 sequence that doesn't start with an ASCII
+		 * character. The ranges of its continuation bytes are the ones of
+		 * the well-formed sequences in the Unicode standard, which excludes
+		 * overlong sequences, surrogates and code points above U+10FFFF.
+		 * @param bytes Pointer to the first byte of the sequence.
+		 * @param available Number of bytes available from the first one.
+		 * @param codePoint Receives the decoded code point, or -1 if the
+		 * sequence is invalid or truncated.
+		 * @return Number of bytes of the sequence. For an invalid sequence,
+		 * number of bytes of its longest valid prefix, at least 1, so it can
+		 * be replaced by a single U+FFFD.
+		 */
+		size_t decodeSequence(const unsigned char *bytes, size_t available,
+		                      int32_t &codePoint) {
+			size_t length;
+			unsigned char lowest = 0x80, highest = 0xBF;
+
+			if (bytes[0] >= 0xC2 && bytes[0] < MASK3BYTES) {
+				// 110xxxxx 10xxxxxx
+				length = 2;
+				codePoint = bytes[0] & 0x1F;
+
+			} else if (bytes[0] >= MASK3BYTES && bytes[0] < MASK4BYTES) {
+				// 1110xxxx 10xxxxxx 10xxxxxx
+				length = 3;
+				codePoint = bytes[0] & 0x0F;
+
+				if (bytes[0] == 0xE0) {
+					lowest = 0xA0;
+
+				} else if (bytes[0] == 0xED) {
+					highest = 0x9F;
+				}
+
+			} else if (bytes[0] >= MASK4BYTES && bytes[0] <= 0xF4) {
+				// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+				length = 4;
+				codePoint = bytes[0] & 0x07;
+
+				if (bytes[0] == 0xF0) {
+					lowest = 0x90;
+
+				} else if (bytes[0] == 0xF4) {
+					highest = 0x8F;
+				}
+
+			} else {
+				codePoint = -1;
+				return 1;
 			}
-			// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-			else if(*i < 0x200000) {
-				result << static_cast<char>(MASK4BYTES | (*i >> 18));
-				result << static_cast<char>(MASK1BYTE | (*i >> 12 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i >> 6 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i & MASKBITS));
+
+			// Only the second byte has a restricted range.
+			for (size_t i = 1; i < length; ++i) {
+				if (i >= available || bytes[i] < lowest || bytes[i] > highest) {
+					codePoint = -1;
+					return i;
+				}
+
+				codePoint = (codePoint << 6) | (bytes[i] & MASKBITS);
+				lowest = 0x80;
+				highest = 0xBF;
 			}
-			// 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-			else if(*i < 0x4000000) {
-				result << static_cast<char>(MASK5BYTES | (*i >> 24));
-				result << static_cast<char>(MASK1BYTE | (*i >> 18 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i >> 12 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i >> 6 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i & MASKBITS));
+
+			return length;
+		}
+
+		/**
+		 * Checks if a code point can be encoded.
+		 * @param codePoint Code point to check.
+		 * @return True if the code point is in the Unicode range and isn't a
+		 * surrogate.
+		 */
+		bool isScalarValue(int32_t codePoint) {
+			return codePoint >= 0 && codePoint <= 0x10FFFF &&
+			       (codePoint < 0xD800 || codePoint > 0xDFFF);
+		}
+	}
+
+	const int32_t Convert::REPLACEMENT_CHARACTER;
+
+	size_t Convert::validateUTF8(const char *utf8, size_t size) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(utf8);
+		size_t position = skipASCII(bytes, 0, size);
+		int32_t codePoint;
+
+		while (position < size) {
+			size_t length = decodeSequence(bytes + position, size - position, codePoint);
+
+			if (codePoint < 0) {
+				return position;
 			}
-			// 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-			else if(*i < 0x8000000) {
-				result << static_cast<char>(MASK6BYTES | (*i >> 30));
-				result << static_cast<char>(MASK1BYTE | (*i >> 18 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i >> 12 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i >> 6 & MASKBITS));
-				result << static_cast<char>(MASK1BYTE | (*i & MASKBITS));
+
+			position = skipASCII(bytes, position + length, size);
+		}
+
+		return size;
+	}
+
+	bool Convert::isValidUTF8(const std::string &utf8String) {
+		return validateUTF8(utf8String.data(), utf8String.size()) == utf8String.size();
+	}
+
+	void Convert::appendUTF8(int32_t codePoint, std::string &utf8String) {
+		if (!isScalarValue(codePoint)) {
+			codePoint = REPLACEMENT_CHARACTER;
+		}
+
+		// 0xxxxxxx
+		if (codePoint < 0x80) {
+			utf8String.push_back(static_cast<char>(codePoint));
+		}
+		// 110xxxxx 10xxxxxx
+		else if (codePoint < 0x800) {
+			char sequence[2] = {
+				static_cast<char>(MASK2BYTES | (codePoint >> 6)),
+				static_cast<char>(MASK1BYTE | (codePoint & MASKBITS))
+			};
+			utf8String.append(sequence, 2);
+		}
+		// 1110xxxx 10xxxxxx 10xxxxxx
+		else if (codePoint < 0x10000) {
+			char sequence[3] = {
+				static_cast<char>(MASK3BYTES | (codePoint >> 12)),
+				static_cast<char>(MASK1BYTE | (codePoint >> 6 & MASKBITS)),
+				static_cast<char>(MASK1BYTE | (codePoint & MASKBITS))
+			};
+			utf8String.append(sequence, 3);
+		}
+		// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+		else {
+			char sequence[4] = {
+				static_cast<char>(MASK4BYTES | (codePoint >> 18)),
+				static_cast<char>(MASK1BYTE | (codePoint >> 12 & MASKBITS)),
+				static_cast<char>(MASK1BYTE | (codePoint >> 6 & MASKBITS)),
+				static_cast<char>(MASK1BYTE | (codePoint & MASKBITS))
+			};
+			utf8String.append(sequence, 4);
+		}
+	}
+
+	std::string Convert::encodeToUTF8(const String32& utf32String) {
+		std::string result;
+		result.reserve(utf32String.size());
+
+		for (String32::const_iterator i = utf32String.begin() ; i != utf32String.end(); ++i) {
+			appendUTF8(*i, result);
+		}
+
+		return result;
+	}
+
+	std::string Convert::encodeToUTF8(const String16& utf16String) {
+		std::string result;
+		result.reserve(utf16String.size());
+
+		for (String16::const_iterator i = utf16String.begin() ; i != utf16String.end(); ++i) {
+			int32_t codeUnit = *i;
+
+			if (codeUnit >= 0xD800 && codeUnit <= 0xDBFF && i + 1 != utf16String.end() &&
+			    *(i + 1) >= 0xDC00 && *(i + 1) <= 0xDFFF) {
+				// We combine the surrogate pair.
+				++i;
+				appendUTF8(0x10000 + ((codeUnit - 0xD800) << 10) + (*i - 0xDC00), result);
+
+			} else {
+				// The unpaired surrogates are replaced.
+				appendUTF8(codeUnit, result);
 			}
 		}
 
-		return result.str();
+		return result;
 	}
 
 	String32 Convert::decodeUTF8(const std::string& utf8String) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(utf8String.data());
+		size_t position = 0, size = utf8String.size();
 		String32 result;
+		int32_t codePoint;
 
-		String32::value_type tmpUnicodeChar;
+		result.reserve(size);
 
-		for(std::string::const_iterator i = utf8String.begin() ; i < utf8String.end();) {
+		while (position < size) {
+			size_t asciiEnd = skipASCII(bytes, position, size);
+			result.insert(result.end(), bytes + position, bytes + asciiEnd);
+			position = asciiEnd;
 
-			// 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-			if((*i & MASK6BYTES) == MASK6BYTES) {
-				tmpUnicodeChar = ((*i & 0x01) << 30) | ((*(i + 1) & MASKBITS) << 24)
-				                 | ((*(i + 2) & MASKBITS) << 18) | ((*(i + 3)
-				                         & MASKBITS) << 12)
-				                 | ((*(i + 4) & MASKBITS) << 6) | (*(i + 5) & MASKBITS);
-				i += 6;
-			}
-			// 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-			else if((*i & MASK5BYTES) == MASK5BYTES) {
-				tmpUnicodeChar = ((*i & 0x03) << 24) | ((*(i + 1)
-				                                        & MASKBITS) << 18)
-				                 | ((*(i + 2) & MASKBITS) << 12) | ((*(i + 3)
-				                         & MASKBITS) << 6)
-				                 | (*(i + 4) & MASKBITS);
-				i += 5;
-			}
-			// 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-			else if((*i & MASK4BYTES) == MASK4BYTES) {
-				tmpUnicodeChar = ((*i & 0x07) << 18) | ((*(i + 1)
-				                                        & MASKBITS) << 12)
-				                 | ((*(i + 2) & MASKBITS) << 6) | (*(i + 3) & MASKBITS);
-				i += 4;
-			}
-			// 1110xxxx 10xxxxxx 10xxxxxx
-			else if((*i & MASK3BYTES) == MASK3BYTES) {
-				tmpUnicodeChar = ((*i & 0x0F) << 12) | ((*(i + 1) & MASKBITS) << 6)
-				                 | (*(i + 2) & MASKBITS);
-				i += 3;
-			}
-			// 110xxxxx 10xxxxxx
-			else if((*i & MASK2BYTES) == MASK2BYTES) {
-				tmpUnicodeChar = ((*i & 0x1F) << 6) | (*(i + 1) & MASKBITS);
-				i += 2;
-			}
-			// 0xxxxxxx
-			else { // if(*i < MASK1BYTE)
-				tmpUnicodeChar = *i;
-				i += 1;
+			if (position < size) {
+				position += decodeSequence(bytes + position, size - position, codePoint);
+				result.push_back((codePoint < 0) ? (REPLACEMENT_CHARACTER) : (codePoint));
 			}
+		}
 
-			result.push_back(tmpUnicodeChar);
+		return result;
+	}
+
+	String16 Convert::decodeUTF8ToUTF16(const std::string& utf8String) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(utf8String.data());
+		size_t position = 0, size = utf8String.size();
+		String16 result;
+		int32_t codePoint;
+
+		result.reserve(size);
+
+		while (position < size) {
+			size_t asciiEnd = skipASCII(bytes, position, size);
+			result.insert(result.end(), bytes + position, bytes + asciiEnd);
+			position = asciiEnd;
+
+			if (position < size) {
+				position += decodeSequence(bytes + position, size - position, codePoint);
+
+				if (codePoint < 0) {
+					result.push_back(static_cast<uint16_t>(REPLACEMENT_CHARACTER));
+
+				} else if (codePoint < 0x10000) {
+					result.push_back(static_cast<uint16_t>(codePoint));
+
+				} else {
+					codePoint -= 0x10000;
+					result.push_back(static_cast<uint16_t>(0xD800 | (codePoint >> 10)));
+					result.push_back(static_cast<uint16_t>(0xDC00 | (codePoint & 0x3FF)));
+				}
+			}
 		}
 
 		return result;
@@ -1,7 +1,6 @@
 #include <JsonBox/Escaper.h>
 
 #include <JsonBox/Grammar.h>
-#include <JsonBox/Value.h>
 
 namespace JsonBox {
 	Escaper::Escaper() : afterBackSlash(false), inString(false) {
@@ -18,35 +17,13 @@ namespace JsonBox {
 			// we change that only if we're not after an escape back slash.
 			inString = !inString || (afterBackSlash);
 
-		} else if (inString && !afterBackSlash) {
+		} else if (inString && !afterBackSlash && isCharacterClass(tmpChar, CharacterClass::ESCAPED)) {
 			// If we are in a string definition and we're not after a backslash
-			// escape.
-			if (tmpChar == Strings::Std::REVERSE_SOLIDUS) {
-				destination.sputn(Strings::Json::REVERSE_SOLIDUS.c_str(), Strings::Json::REVERSE_SOLIDUS.size());
-				notEscaped = false;
-
-			} else if (tmpChar == Strings::Std::BACKSPACE) {
-				destination.sputn(Strings::Json::BACKSPACE.c_str(), Strings::Json::BACKSPACE.size());
-				notEscaped = false;
-
-			} else if (tmpChar == Strings::Std::FORM_FEED) {
-				destination.sputn(Strings::Json::FORM_FEED.c_str(), Strings::Json::FORM_FEED.size());
-				notEscaped = false;
-
-			} else if (tmpChar == Strings::Std::LINE_FEED) {
-				destination.sputn(Strings::Json::LINE_FEED.c_str(), Strings::Json::LINE_FEED.size());
-				notEscaped = false;
-
-			} else if (tmpChar == Strings::Std::TAB) {
-				destination.sputn(Strings::Json::TAB.c_str(), Strings::Json::TAB.size());
-				notEscaped = false;
-
-			} else if (tmpChar >= '\0' && tmpChar <= '\x1f') {
-				std::string tmp(Value::escapeToUnicode(tmpChar));
-				destination.sputn(tmp.c_str(), tmp.size());
-				notEscaped = false;
-			}
-
+			// escape, the reverse solidus and the control characters are
+			// escaped.
+			char sequence[6];
+			destination.sputn(sequence, getEscapeSequence(tmpChar, sequence));
+			notEscaped = false;
 		}
 
 		// We determine if we start a backslash escape or not.
@@ -0,0 +1,539 @@
+#include <JsonBox/JsonIndex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+#include <JsonBox/BinaryStream.h>
+#include <JsonBox/Grammar.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+
+namespace JsonBox {
+	/*
+	 * Index layout, all numbers in big-endian byte order:
+	 *
+	 * header:  magic (8 bytes), version (u32), reserved (u32), number of
+	 *          entries (u64), size of the indexed JSON file (u64)
+	 * entries: offset of the JSON Pointer in the index (u64), offset of the
+	 *          value in the JSON file (u64), size of the value (u64), size of
+	 *          the JSON Pointer (u32) and reserved (u32), sorted by JSON
+	 *          Pointer
+	 * strings: the JSON Pointers' bytes
+	 */
+	namespace IndexFormat {
+		const char MAGIC[] = {'J', 'B', 'O', 'F', 'F', 'I', 'D', 'X'};
+		const size_t MAGIC_SIZE = sizeof(MAGIC);
+		const uint32_t VERSION = 1;
+		const uint64_t HEADER_SIZE = 32;
+		const size_t ENTRY_COUNT_POSITION = 16;
+		const size_t JSON_SIZE_POSITION = 24;
+
+		const uint64_t ENTRY_SIZE = 32;
+		const unsigned int POINTER_OFFSET_POSITION = 0;
+		const unsigned int VALUE_OFFSET_POSITION = 8;
+		const unsigned int VALUE_SIZE_POSITION = 16;
+		const unsigned int POINTER_SIZE_POSITION = 24;
+	}
+
+	namespace {
+		/**
+		 * Read-only streambuf over a block of memory, used to parse values
+		 * directly from the mapped JSON file.
+		 */
+		class MemoryStreambuf : public std::streambuf {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param data Pointer to the first character of the block.
+			 * @param size Number of characters in the block.
+			 */
+			MemoryStreambuf(const char *data, size_t size) {
+				char *begin = const_cast<char *>(data);
+				setg(begin, begin, begin + size);
+			}
+		};
+
+		/**
+		 * Scans the structure of a JSON document and collects the byte
+		 * ranges of its values down to a given depth.
+		 */
+		class IndexBuilder {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param newData Pointer to the first byte of the JSON.
+			 * @param newSize Number of bytes of the JSON.
+			 * @param newMaximumDepth Depth of the deepest values collected.
+			 */
+			IndexBuilder(const char *newData, size_t newSize,
+			             unsigned int newMaximumDepth) : data(newData),
+				current(newData), end(newData + newSize),
+				maximumDepth(newMaximumDepth), pointers(), entries() {
+			}
+
+			/**
+			 * Scans the whole document.
+			 */
+			void scan() {
+				std::string pointer;
+
+				// We skip the UTF-8 byte order mark if there is one.
+				if (end - current >= 3 && std::memcmp(current, "\xef\xbb\xbf", 3) == 0) {
+					current += 3;
+				}
+
+				scanValue(0, pointer);
+				skipWhitespace();
+
+				if (current != end) {
+					throw JsonParsingError("Invalid characters found after the JSON value.");
+				}
+			}
+
+			/**
+			 * Writes the index of the collected values.
+			 * @param output Output stream to write the index to.
+			 */
+			void write(std::ostream &output) {
+				std::vector<size_t> order(entries.size());
+				StreamSink sink(output);
+				uint64_t pointerOffset = IndexFormat::HEADER_SIZE + entries.size() * IndexFormat::ENTRY_SIZE;
+
+				for (size_t i = 0; i < order.size(); ++i) {
+					order[i] = i;
+				}
+
+				std::sort(order.begin(), order.end(), PointerLess(*this));
+
+				sink.write(IndexFormat::MAGIC, IndexFormat::MAGIC_SIZE);
+				putBigEndian(sink, IndexFormat::VERSION, 4);
+				putBigEndian(sink, 0, 4);
+				putBigEndian(sink, entries.size(), 8);
+				putBigEndian(sink, static_cast<uint64_t>(end - data), 8);
+
+				for (std::vector<size_t>::const_iterator i = order.begin(); i != order.end(); ++i) {
+					const Entry &entry = entries[*i];
+					putBigEndian(sink, pointerOffset + entry.pointerOffset, 8);
+					putBigEndian(sink, entry.valueOffset, 8);
+					putBigEndian(sink, entry.valueSize, 8);
+					putBigEndian(sink, entry.pointerSize, 4);
+					putBigEndian(sink, 0, 4);
+				}
+
+				sink.write(pointers.data(), pointers.size());
+			}
+
+		private:
+			/**
+			 * Collected value.
+			 */
+			struct Entry {
+				/// Offset of the value's JSON Pointer in the pointers.
+				uint64_t pointerOffset;
+
+				/// Size of the value's JSON Pointer.
+				uint32_t pointerSize;
+
+				/// Offset of the value in the JSON.
+				uint64_t valueOffset;
+
+				/// Size of the value in the JSON.
+				uint64_t valueSize;
+			};
+
+			/**
+			 * Compares the JSON Pointers of two entries.
+			 */
+			class PointerLess {
+			public:
+				explicit PointerLess(const IndexBuilder &newBuilder) : builder(newBuilder) {
+				}
+
+				bool operator()(size_t lhs, size_t rhs) const {
+					const Entry &left = builder.entries[lhs];
+					const Entry &right = builder.entries[rhs];
+					return builder.pointers.compare(left.pointerOffset, left.pointerSize,
+					                                builder.pointers, right.pointerOffset, right.pointerSize) < 0;
+				}
+
+			private:
+				const IndexBuilder &builder;
+			};
+
+			/**
+			 * Scans a value, collecting it and its contents down to the
+			 * maximum depth.
+			 * @param depth Depth of the value.
+			 * @param pointer JSON Pointer of the value, used to build the
+			 * JSON Pointers of its contents and restored afterwards.
+			 */
+			void scanValue(unsigned int depth, std::string &pointer) {
+				skipWhitespace();
+				const char *begin = current;
+
+				if (depth < maximumDepth && current != end &&
+				    (*current == Structural::BEGIN_OBJECT || *current == Structural::BEGIN_ARRAY)) {
+					bool isObject = (*current == Structural::BEGIN_OBJECT);
+					char endCharacter = (isObject) ? (Structural::END_OBJECT) : (Structural::END_ARRAY);
+					size_t pointerSize = pointer.size();
+					size_t index = 0;
+
+					++current;
+					skipWhitespace();
+
+					if (current != end && *current == endCharacter) {
+						++current;
+
+					} else {
+						bool reading = true;
+
+						while (reading) {
+							pointer.push_back('/');
+
+							if (isObject) {
+								appendName(pointer);
+								skipWhitespace();
+								expect(Structural::NAME_SEPARATOR);
+
+							} else {
+								std::ostringstream indexString;
+								indexString << index++;
+								pointer.append(indexString.str());
+							}
+
+							scanValue(depth + 1, pointer);
+							pointer.resize(pointerSize);
+							skipWhitespace();
+
+							if (current != end && *current == Structural::VALUE_SEPARATOR) {
+								++current;
+								skipWhitespace();
+
+							} else {
+								expect(endCharacter);
+								reading = false;
+							}
+						}
+					}
+
+				} else {
+					skipValue();
+				}
+
+				Entry entry;
+				entry.pointerOffset = pointers.size();
+				entry.pointerSize = static_cast<uint32_t>(pointer.size());
+				entry.valueOffset = static_cast<uint64_t>(begin - data);
+				entry.valueSize = static_cast<uint64_t>(current - begin);
+				pointers.append(pointer);
+				entries.push_back(entry);
+			}
+
+			/**
+			 * Skips a value and all its contents without looking at them.
+			 */
+			void skipValue() {
+				if (current == end) {
+					throw JsonParsingError("JSON ends where a value was expected.");
+
+				} else if (*current == Structural::BEGIN_END_STRING) {
+					skipString();
+
+				} else if (*current == Structural::BEGIN_OBJECT || *current == Structural::BEGIN_ARRAY) {
+					size_t level = 0;
+
+					do {
+						if (current == end) {
+							throw JsonParsingError("JSON ends in the middle of an array or an object.");
+
+						} else if (*current == Structural::BEGIN_END_STRING) {
+							skipString();
+
+						} else {
+							if (*current == Structural::BEGIN_OBJECT || *current == Structural::BEGIN_ARRAY) {
+								++level;
+
+							} else if (*current == Structural::END_OBJECT || *current == Structural::END_ARRAY) {
+								--level;
+							}
+
+							++current;
+						}
+					} while (level > 0);
+
+				} else {
+					const char *begin = current;
+
+					while (current != end && !isDelimiter(*current)) {
+						++current;
+					}
+
+					if (current == begin) {
+						throw JsonParsingError("Invalid characters found where a value was expected.");
+					}
+				}
+			}
+
+			/**
+			 * Skips a string, from its opening to its closing quotation mark.
+			 */
+			void skipString() {
+				++current;
+
+				while (current != end && *current != Structural::BEGIN_END_STRING) {
+					current += (*current == Strings::Json::Escape::BEGIN_ESCAPE) ? (2) : (1);
+				}
+
+				if (current >= end) {
+					throw JsonParsingError("JSON ends in the middle of a string.");
+				}
+
+				++current;
+			}
+
+			/**
+			 * Reads an object member's name and appends it to a JSON Pointer,
+			 * escaping the '~' and '/' characters.
+			 * @param pointer JSON Pointer to append the name to.
+			 */
+			void appendName(std::string &pointer) {
+				if (current == end || *current != Structural::BEGIN_END_STRING) {
+					throw JsonParsingError("Invalid object member name found.");
+				}
+
+				const char *begin = current;
+				skipString();
+				std::string name(begin + 1, current - 1);
+
+				if (name.find(Strings::Json::Escape::BEGIN_ESCAPE) != std::string::npos) {
+					// Names with escape sequences are rare, the parser takes
+					// care of them.
+					Value unescaped;
+					unescaped.loadFromString(std::string(begin, current));
+					name = unescaped.getString();
+				}
+
+				for (std::string::const_iterator i = name.begin(); i != name.end(); ++i) {
+					if (*i == '~') {
+						pointer.append("~0");
+
+					} else if (*i == '/') {
+						pointer.append("~1");
+
+					} else {
+						pointer.push_back(*i);
+					}
+				}
+			}
+
+			/**
+			 * Skips a structural character, throws a JsonParsingError if it
+			 * isn't the next one.
+			 * @param character Structural character expected.
+			 */
+			void expect(char character) {
+				if (current == end || *current != character) {
+					throw JsonParsingError("Invalid JSON structure found.");
+				}
+
+				++current;
+			}
+
+			/**
+			 * Skips the whitespace at the current position.
+			 */
+			void skipWhitespace() {
+				while (current != end && isCharacterClass(*current, CharacterClass::WHITESPACE)) {
+					++current;
+				}
+			}
+
+			/**
+			 * Checks if a character ends a number or a literal.
+			 * @param character Character to check.
+			 * @return True for whitespace and structural characters.
+			 */
+			static bool isDelimiter(char character) {
+				return character == Whitespace::SPACE ||
+				       character == Whitespace::HORIZONTAL_TAB ||
+				       character == Whitespace::NEW_LINE ||
+				       character == Whitespace::CARRIAGE_RETURN ||
+				       character == Structural::VALUE_SEPARATOR ||
+				       character == Structural::END_ARRAY ||
+				       character == Structural::END_OBJECT ||
+				       character == Structural::NAME_SEPARATOR;
+			}
+
+			/// Pointer to the first byte of the JSON.
+			const char *data;
+
+			/// Pointer to the next byte to scan.
+			const char *current;
+
+			/// Pointer past the last byte of the JSON.
+			const char *end;
+
+			/// Depth of the deepest values collected.
+			unsigned int maximumDepth;
+
+			/// JSON Pointers of the collected values, one after the other.
+			std::string pointers;
+
+			/// Collected values, in the order their scan ended.
+			std::vector<Entry> entries;
+		};
+	}
+
+	void JsonIndex::build(const std::string &jsonFilePath,
+	                      const std::string &indexFilePath,
+	                      unsigned int maximumDepth) {
+		MappedFile json(jsonFilePath);
+		IndexBuilder builder(json.getData(), json.getSize(), maximumDepth);
+		builder.scan();
+
+		std::ofstream file;
+		file.open(indexFilePath.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+
+		if (file.is_open()) {
+			builder.write(file);
+			file.close();
+
+			if (file.fail()) {
+				throw JsonWritingError(std::string("Failed to write the following index file: ").append(indexFilePath));
+			}
+
+		} else {
+			throw JsonWritingError(std::string("Failed to open the following file to write the index to: ").append(indexFilePath));
+		}
+	}
+
+	JsonIndex::JsonIndex(const std::string &jsonFilePath,
+	                     const std::string &indexFilePath) :
+		jsonFile(jsonFilePath), indexFile(indexFilePath), entryCount(0) {
+		const char *header = indexFile.getData();
+
+		if (indexFile.getSize() < IndexFormat::HEADER_SIZE ||
+		    std::memcmp(header, IndexFormat::MAGIC, IndexFormat::MAGIC_SIZE) != 0 ||
+		    readBigEndian(header + IndexFormat::MAGIC_SIZE, 4) != IndexFormat::VERSION) {
+			throw JsonParsingError(std::string("Invalid index file: ").append(indexFilePath));
+		}
+
+		entryCount = readBigEndian(header + IndexFormat::ENTRY_COUNT_POSITION, 8);
+
+		if (entryCount > (indexFile.getSize() - IndexFormat::HEADER_SIZE) / IndexFormat::ENTRY_SIZE) {
+			throw JsonParsingError(std::string("Invalid index file: ").append(indexFilePath));
+
+		} else if (readBigEndian(header + IndexFormat::JSON_SIZE_POSITION, 8) != jsonFile.getSize()) {
+			throw JsonParsingError(std::string("The following index file wasn't built from the JSON file: ").append(indexFilePath));
+		}
+	}
+
+	size_t JsonIndex::getSize() const {
+		return static_cast<size_t>(entryCount);
+	}
+
+	std::string JsonIndex::getPointer(size_t index) const {
+		std::string result;
+
+		if (index < entryCount) {
+			const char *entry = getBytes(IndexFormat::HEADER_SIZE + index * IndexFormat::ENTRY_SIZE, IndexFormat::ENTRY_SIZE);
+			uint64_t pointerSize = readBigEndian(entry + IndexFormat::POINTER_SIZE_POSITION, 4);
+			result.assign(getBytes(readBigEndian(entry + IndexFormat::POINTER_OFFSET_POSITION, 8), pointerSize), static_cast<size_t>(pointerSize));
+		}
+
+		return result;
+	}
+
+	bool JsonIndex::contains(const std::string &pointer) const {
+		return find(pointer) != 0;
+	}
+
+	bool JsonIndex::getRange(const std::string &pointer, uint64_t &offset,
+	                         uint64_t &size) const {
+		uint64_t position = find(pointer);
+
+		if (position != 0) {
+			const char *entry = getBytes(position, IndexFormat::ENTRY_SIZE);
+			uint64_t valueOffset = readBigEndian(entry + IndexFormat::VALUE_OFFSET_POSITION, 8);
+			uint64_t valueSize = readBigEndian(entry + IndexFormat::VALUE_SIZE_POSITION, 8);
+
+			if (valueOffset > jsonFile.getSize() || valueSize > jsonFile.getSize() - valueOffset) {
+				throw JsonParsingError("Invalid index entry found.");
+			}
+
+			offset = valueOffset;
+			size = valueSize;
+		}
+
+		return position != 0;
+	}
+
+	bool JsonIndex::load(const std::string &pointer, Value &result) const {
+		uint64_t offset, size;
+		bool found = getRange(pointer, offset, size);
+
+		if (found) {
+			const char *value = jsonFile.getData() + offset;
+
+			if (size > 0 && (*value == Structural::BEGIN_OBJECT || *value == Structural::BEGIN_ARRAY || *value == Structural::BEGIN_END_STRING)) {
+				// Arrays, objects and strings are parsed in place.
+				MemoryStreambuf buffer(value, static_cast<size_t>(size));
+				std::istream input(&buffer);
+				result.loadFromStream(input);
+
+			} else {
+				// The parser only reads numbers and literals inside arrays.
+				Value wrapper;
+				std::string text(1, Structural::BEGIN_ARRAY);
+				text.append(value, static_cast<size_t>(size));
+				text.push_back(Structural::END_ARRAY);
+				wrapper.loadFromString(text);
+				result = wrapper[static_cast<size_t>(0)];
+			}
+		}
+
+		return found;
+	}
+
+	uint64_t JsonIndex::find(const std::string &pointer) const {
+		uint64_t first = 0, last = entryCount;
+
+		while (first < last) {
+			uint64_t middle = first + (last - first) / 2;
+			uint64_t position = IndexFormat::HEADER_SIZE + middle * IndexFormat::ENTRY_SIZE;
+			const char *entry = getBytes(position, IndexFormat::ENTRY_SIZE);
+			uint64_t pointerSize = readBigEndian(entry + IndexFormat::POINTER_SIZE_POSITION, 4);
+			const char *entryPointer = getBytes(readBigEndian(entry + IndexFormat::POINTER_OFFSET_POSITION, 8), pointerSize);
+			int comparison = std::memcmp(entryPointer, pointer.data(), std::min<uint64_t>(pointerSize, pointer.size()));
+
+			if (comparison == 0) {
+				comparison = (pointerSize < pointer.size()) ? (-1) : ((pointerSize > pointer.size()) ? (1) : (0));
+			}
+
+			if (comparison < 0) {
+				first = middle + 1;
+
+			} else if (comparison > 0) {
+				last = middle;
+
+			} else {
+				return position;
+			}
+		}
+
+		return 0;
+	}
+
+	const char *JsonIndex::getBytes(uint64_t position, uint64_t length) const {
+		if (position > indexFile.getSize() || length > indexFile.getSize() - position) {
+			throw JsonParsingError("Invalid index entry found.");
+		}
+
+		return indexFile.getData() + position;
+	}
+}
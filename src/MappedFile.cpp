@@ -0,0 +1,81 @@
+#include <JsonBox/MappedFile.h>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSONBOX_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace JsonBox {
+	MappedFile::MappedFile(const std::string &filePath) : data(NULL), size(0),
+		mapped(false), buffer() {
+#ifdef JSONBOX_HAVE_MMAP
+		int descriptor = open(filePath.c_str(), O_RDONLY);
+
+		if (descriptor != -1) {
+			struct stat status;
+			bool empty = false;
+
+			if (fstat(descriptor, &status) == 0) {
+				empty = (status.st_size == 0);
+
+				if (!empty) {
+					void *address = mmap(NULL, static_cast<size_t>(status.st_size),
+					                     PROT_READ, MAP_SHARED, descriptor, 0);
+
+					if (address != MAP_FAILED) {
+						data = static_cast<const char *>(address);
+						size = static_cast<size_t>(status.st_size);
+						mapped = true;
+					}
+				}
+			}
+
+			close(descriptor);
+
+			if (mapped || empty) {
+				return;
+			}
+		}
+
+#endif
+		// The file couldn't be mapped, we read it instead.
+		std::ifstream file(filePath.c_str(), std::ios::binary | std::ios::in);
+
+		if (!file.is_open()) {
+			throw std::invalid_argument(std::string("Failed to open the following file: ").append(filePath));
+		}
+
+		buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		data = (buffer.empty()) ? (NULL) : (&buffer[0]);
+		size = buffer.size();
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef JSONBOX_HAVE_MMAP
+
+		if (mapped) {
+			munmap(const_cast<char *>(data), size);
+		}
+
+#endif
+	}
+
+	const char *MappedFile::getData() const {
+		return data;
+	}
+
+	size_t MappedFile::getSize() const {
+		return size;
+	}
+
+	bool MappedFile::isMapped() const {
+		return mapped;
+	}
+}
@@ -0,0 +1,522 @@
+#include <JsonBox/Value.h>
+
+#include <climits>
+
+#include <JsonBox/BinaryStream.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+
+namespace JsonBox {
+	// MessagePack format bytes.
+	namespace MsgPack {
+		const uint8_t POSITIVE_FIXINT_MAX = 0x7f;
+		const uint8_t FIXMAP = 0x80;
+		const uint8_t FIXARRAY = 0x90;
+		const uint8_t FIXSTR = 0xa0;
+		const uint8_t NIL = 0xc0;
+		const uint8_t NEVER_USED = 0xc1;
+		const uint8_t FALSE_VALUE = 0xc2;
+		const uint8_t TRUE_VALUE = 0xc3;
+		const uint8_t BIN8 = 0xc4;
+		const uint8_t BIN16 = 0xc5;
+		const uint8_t BIN32 = 0xc6;
+		const uint8_t EXT8 = 0xc7;
+		const uint8_t EXT16 = 0xc8;
+		const uint8_t EXT32 = 0xc9;
+		const uint8_t FLOAT32 = 0xca;
+		const uint8_t FLOAT64 = 0xcb;
+		const uint8_t UINT8 = 0xcc;
+		const uint8_t UINT16 = 0xcd;
+		const uint8_t UINT32 = 0xce;
+		const uint8_t UINT64 = 0xcf;
+		const uint8_t INT8 = 0xd0;
+		const uint8_t INT16 = 0xd1;
+		const uint8_t INT32 = 0xd2;
+		const uint8_t INT64 = 0xd3;
+		const uint8_t FIXEXT1 = 0xd4;
+		const uint8_t FIXEXT16 = 0xd8;
+		const uint8_t STR8 = 0xd9;
+		const uint8_t STR16 = 0xda;
+		const uint8_t STR32 = 0xdb;
+		const uint8_t ARRAY16 = 0xdc;
+		const uint8_t ARRAY32 = 0xdd;
+		const uint8_t MAP16 = 0xde;
+		const uint8_t MAP32 = 0xdf;
+		const uint8_t NEGATIVE_FIXINT = 0xe0;
+
+		const uint32_t FIXSTR_MAX_SIZE = 31;
+		const uint32_t FIXCONTAINER_MAX_SIZE = 15;
+	}
+
+	namespace {
+		/**
+		 * Writes the header of a string or a container.
+		 * @param sink Sink to write the header to.
+		 * @param size Number of bytes or elements announced by the header.
+		 * @param fixFormat Format byte of the fixed size variant.
+		 * @param fixMaxSize Largest size the fixed size variant can hold.
+		 * @param format8 Format byte of the 8 bit size variant, 0 if there is
+		 * none.
+		 * @param format16 Format byte of the 16 bit size variant.
+		 * @param format32 Format byte of the 32 bit size variant.
+		 */
+		template <typename Sink>
+		void writeMsgPackHeader(Sink &sink, size_t size, uint8_t fixFormat,
+		                        uint32_t fixMaxSize, uint8_t format8,
+		                        uint8_t format16, uint8_t format32) {
+			if (size <= fixMaxSize) {
+				sink.put(static_cast<uint8_t>(fixFormat | size));
+
+			} else if (format8 != 0 && size <= 0xff) {
+				sink.put(format8);
+				sink.put(static_cast<uint8_t>(size));
+
+			} else if (size <= 0xffff) {
+				sink.put(format16);
+				putBigEndian(sink, size, 2);
+
+			} else if (static_cast<uint64_t>(size) <= 0xffffffffu) {
+				sink.put(format32);
+				putBigEndian(sink, size, 4);
+
+			} else {
+				throw JsonWritingError("Value too large to be written in MessagePack.");
+			}
+		}
+
+		/**
+		 * Writes an integer using its most compact MessagePack encoding.
+		 * @param sink Sink to write the integer to.
+		 * @param value Integer to write.
+		 */
+		template <typename Sink>
+		void writeMsgPackInteger(Sink &sink, int64_t value) {
+			if (value >= 0) {
+				if (value <= MsgPack::POSITIVE_FIXINT_MAX) {
+					sink.put(static_cast<uint8_t>(value));
+
+				} else if (value <= 0xff) {
+					sink.put(MsgPack::UINT8);
+					sink.put(static_cast<uint8_t>(value));
+
+				} else if (value <= 0xffff) {
+					sink.put(MsgPack::UINT16);
+					putBigEndian(sink, static_cast<uint64_t>(value), 2);
+
+				} else if (value <= 0xffffffffll) {
+					sink.put(MsgPack::UINT32);
+					putBigEndian(sink, static_cast<uint64_t>(value), 4);
+
+				} else {
+					sink.put(MsgPack::UINT64);
+					putBigEndian(sink, static_cast<uint64_t>(value), 8);
+				}
+
+			} else if (value >= -32) {
+				sink.put(static_cast<uint8_t>(value));
+
+			} else if (value >= -128) {
+				sink.put(MsgPack::INT8);
+				sink.put(static_cast<uint8_t>(value));
+
+			} else if (value >= -32768) {
+				sink.put(MsgPack::INT16);
+				putBigEndian(sink, static_cast<uint64_t>(value), 2);
+
+			} else if (value >= INT_MIN) {
+				sink.put(MsgPack::INT32);
+				putBigEndian(sink, static_cast<uint64_t>(value), 4);
+
+			} else {
+				sink.put(MsgPack::INT64);
+				putBigEndian(sink, static_cast<uint64_t>(value), 8);
+			}
+		}
+
+		/**
+		 * Writes a double as a 32 bit float if it doesn't lose precision, as
+		 * a 64 bit float otherwise.
+		 * @param sink Sink to write the double to.
+		 * @param value Double to write.
+		 */
+		template <typename Sink>
+		void writeMsgPackDouble(Sink &sink, double value) {
+			if (isExactFloat(value)) {
+				sink.put(MsgPack::FLOAT32);
+				putBigEndian(sink, floatToBits(static_cast<float>(value)), 4);
+
+			} else {
+				sink.put(MsgPack::FLOAT64);
+				putBigEndian(sink, doubleToBits(value), 8);
+			}
+		}
+
+		/**
+		 * Writes a string.
+		 * @param sink Sink to write the string to.
+		 * @param str String to write.
+		 */
+		template <typename Sink>
+		void writeMsgPackString(Sink &sink, const std::string &str) {
+			writeMsgPackHeader(sink, str.size(), MsgPack::FIXSTR,
+			                   MsgPack::FIXSTR_MAX_SIZE, MsgPack::STR8,
+			                   MsgPack::STR16, MsgPack::STR32);
+			sink.write(str.data(), str.size());
+		}
+
+		/**
+		 * Writes a number of an array using a typed storage.
+		 * @param sink Sink to write the number to.
+		 * @param number Number to write.
+		 */
+		template <typename Sink>
+		void writeMsgPackNumber(Sink &sink, int32_t number) {
+			writeMsgPackInteger(sink, number);
+		}
+
+		template <typename Sink>
+		void writeMsgPackNumber(Sink &sink, int64_t number) {
+			writeMsgPackInteger(sink, number);
+		}
+
+		template <typename Sink>
+		void writeMsgPackNumber(Sink &sink, float number) {
+			writeMsgPackDouble(sink, number);
+		}
+
+		template <typename Sink>
+		void writeMsgPackNumber(Sink &sink, double number) {
+			writeMsgPackDouble(sink, number);
+		}
+
+		/**
+		 * Writes an array using a typed storage directly from its numbers.
+		 * @param sink Sink to write the array to.
+		 * @param numbers Numbers of the array.
+		 */
+		template <typename Sink, typename T>
+		void writeMsgPackNumbers(Sink &sink, NumericSpan<const T> numbers) {
+			writeMsgPackHeader(sink, numbers.size(), MsgPack::FIXARRAY,
+			                   MsgPack::FIXCONTAINER_MAX_SIZE, 0,
+			                   MsgPack::ARRAY16, MsgPack::ARRAY32);
+
+			for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+				writeMsgPackNumber(sink, *i);
+			}
+		}
+
+		/**
+		 * Writes a value and all its contents.
+		 * @param sink Sink to write the value to.
+		 * @param value Value to write.
+		 */
+		template <typename Sink>
+		void writeMsgPackValue(Sink &sink, const Value &value) {
+			switch (value.getType()) {
+			case Value::STRING:
+				writeMsgPackString(sink, value.getString());
+				break;
+
+			case Value::INTEGER:
+				writeMsgPackInteger(sink, value.getInteger());
+				break;
+
+			case Value::DOUBLE:
+				writeMsgPackDouble(sink, value.getDouble());
+				break;
+
+			case Value::OBJECT: {
+					const Object &object = value.getObject();
+					writeMsgPackHeader(sink, object.size(), MsgPack::FIXMAP,
+					                   MsgPack::FIXCONTAINER_MAX_SIZE, 0,
+					                   MsgPack::MAP16, MsgPack::MAP32);
+
+					for (Object::const_iterator i = object.begin(); i != object.end(); ++i) {
+						writeMsgPackString(sink, i->first);
+						writeMsgPackValue(sink, i->second);
+					}
+				}
+				break;
+
+			case Value::ARRAY:
+				switch (value.getArrayStorage()) {
+				case Value::INT32_ARRAY:
+					writeMsgPackNumbers(sink, value.getInt32Array());
+					break;
+
+				case Value::INT64_ARRAY:
+					writeMsgPackNumbers(sink, value.getInt64Array());
+					break;
+
+				case Value::FLOAT_ARRAY:
+					writeMsgPackNumbers(sink, value.getFloatArray());
+					break;
+
+				case Value::DOUBLE_ARRAY:
+					writeMsgPackNumbers(sink, value.getDoubleArray());
+					break;
+
+				default: {
+					const Array &array = value.getArray();
+					writeMsgPackHeader(sink, array.size(), MsgPack::FIXARRAY,
+					                   MsgPack::FIXCONTAINER_MAX_SIZE, 0,
+					                   MsgPack::ARRAY16, MsgPack::ARRAY32);
+
+					for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+						writeMsgPackValue(sink, *i);
+					}
+				}
+					break;
+				}
+
+				break;
+
+			case Value::BOOLEAN:
+				sink.put(value.getBoolean() ? MsgPack::TRUE_VALUE : MsgPack::FALSE_VALUE);
+				break;
+
+			case Value::RAW_JSON: {
+					Value parsed;
+					parsed.loadFromString(value.getRawJson());
+					writeMsgPackValue(sink, parsed);
+				}
+				break;
+
+			default:
+				sink.put(MsgPack::NIL);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * Reads MessagePack values. Declared as a friend of Value so the arrays
+	 * and objects are filled in place.
+	 */
+	class MsgPackReader {
+	public:
+		/**
+		 * Reads a value and all its contents. Throws a JsonParsingError if
+		 * its arrays and maps are nested deeper than BINARY_MAXIMUM_DEPTH.
+		 * @param source Source to read the value from.
+		 * @param result Value replaced by the value read.
+		 * @param depth Number of arrays and maps containing the value.
+		 */
+		template <typename Source>
+		static void read(Source &source, Value &result, unsigned int depth = 0) {
+			uint8_t format = source.get();
+
+			if (format <= MsgPack::POSITIVE_FIXINT_MAX) {
+				result.setInteger(format);
+
+			} else if (format >= MsgPack::NEGATIVE_FIXINT) {
+				result.setInteger(static_cast<int8_t>(format));
+
+			} else if (format < MsgPack::FIXARRAY) {
+				readObject(source, format & 0x0f, result, depth);
+
+			} else if (format < MsgPack::FIXSTR) {
+				readArray(source, format & 0x0f, result, depth);
+
+			} else if (format < MsgPack::NIL) {
+				readString(source, format & 0x1f, result);
+
+			} else {
+				switch (format) {
+				case MsgPack::NIL:
+					result.setNull();
+					break;
+
+				case MsgPack::FALSE_VALUE:
+					result.setBoolean(false);
+					break;
+
+				case MsgPack::TRUE_VALUE:
+					result.setBoolean(true);
+					break;
+
+				case MsgPack::BIN8:
+				case MsgPack::STR8:
+					readString(source, getBigEndian(source, 1), result);
+					break;
+
+				case MsgPack::BIN16:
+				case MsgPack::STR16:
+					readString(source, getBigEndian(source, 2), result);
+					break;
+
+				case MsgPack::BIN32:
+				case MsgPack::STR32:
+					readString(source, getBigEndian(source, 4), result);
+					break;
+
+				case MsgPack::FLOAT32:
+					result.setDouble(bitsToFloat(static_cast<uint32_t>(getBigEndian(source, 4))));
+					break;
+
+				case MsgPack::FLOAT64:
+					result.setDouble(bitsToDouble(getBigEndian(source, 8)));
+					break;
+
+				case MsgPack::UINT8:
+				case MsgPack::UINT16:
+				case MsgPack::UINT32:
+				case MsgPack::UINT64:
+					setUnsigned(getBigEndian(source, 1u << (format - MsgPack::UINT8)), result);
+					break;
+
+				case MsgPack::INT8:
+					setSigned(static_cast<int8_t>(getBigEndian(source, 1)), result);
+					break;
+
+				case MsgPack::INT16:
+					setSigned(static_cast<int16_t>(getBigEndian(source, 2)), result);
+					break;
+
+				case MsgPack::INT32:
+					setSigned(static_cast<int32_t>(getBigEndian(source, 4)), result);
+					break;
+
+				case MsgPack::INT64:
+					setSigned(static_cast<int64_t>(getBigEndian(source, 8)), result);
+					break;
+
+				case MsgPack::ARRAY16:
+					readArray(source, getBigEndian(source, 2), result, depth);
+					break;
+
+				case MsgPack::ARRAY32:
+					readArray(source, getBigEndian(source, 4), result, depth);
+					break;
+
+				case MsgPack::MAP16:
+					readObject(source, getBigEndian(source, 2), result, depth);
+					break;
+
+				case MsgPack::MAP32:
+					readObject(source, getBigEndian(source, 4), result, depth);
+					break;
+
+				default:
+					// The extension types and the never used format.
+					throw JsonParsingError("Unsupported MessagePack format found.");
+				}
+			}
+		}
+
+	private:
+		/**
+		 * Reads the bytes of a string.
+		 * @param source Source to read the string from.
+		 * @param size Number of bytes in the string.
+		 * @param result Value replaced by the string.
+		 */
+		template <typename Source>
+		static void readString(Source &source, uint64_t size, Value &result) {
+			result.setString(std::string());
+			source.read(result.data.stringValue->text, static_cast<size_t>(size));
+		}
+
+		/**
+		 * Reads the elements of an array.
+		 * @param source Source to read the elements from.
+		 * @param count Number of elements in the array.
+		 * @param result Value replaced by the array.
+		 * @param depth Number of arrays and maps containing the array.
+		 */
+		template <typename Source>
+		static void readArray(Source &source, uint64_t count, Value &result,
+		                      unsigned int depth) {
+			requireDepth(depth);
+			source.requireElements(count);
+			result.setArray(Array());
+			Array &array = *result.data.arrayValue;
+			array.resize(static_cast<size_t>(count));
+
+			for (Array::iterator i = array.begin(); i != array.end(); ++i) {
+				read(source, *i, depth + 1);
+			}
+		}
+
+		/**
+		 * Reads the members of an object.
+		 * @param source Source to read the members from.
+		 * @param count Number of members in the object.
+		 * @param result Value replaced by the object.
+		 * @param depth Number of arrays and maps containing the object.
+		 */
+		template <typename Source>
+		static void readObject(Source &source, uint64_t count, Value &result,
+		                       unsigned int depth) {
+			Value key;
+
+			requireDepth(depth);
+			source.requireElements(count);
+			result.setObject(Object());
+
+			for (uint64_t i = 0; i < count; ++i) {
+				read(source, key, depth + 1);
+
+				if (key.isString()) {
+					read(source, (*result.data.objectValue)[key.getString()], depth + 1);
+
+				} else if (key.isStringable()) {
+					read(source, (*result.data.objectValue)[key.getToString()], depth + 1);
+
+				} else {
+					throw JsonParsingError("Invalid MessagePack map key found.");
+				}
+			}
+		}
+
+		/**
+		 * Sets a value to an unsigned integer, as a double if it doesn't fit
+		 * in an int.
+		 * @param integer Integer to set.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setUnsigned(uint64_t integer, Value &result) {
+			if (integer <= static_cast<uint64_t>(INT_MAX)) {
+				result.setInteger(static_cast<int>(integer));
+
+			} else {
+				result.setDouble(static_cast<double>(integer));
+			}
+		}
+
+		/**
+		 * Sets a value to a signed integer, as a double if it doesn't fit in
+		 * an int.
+		 * @param integer Integer to set.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setSigned(int64_t integer, Value &result) {
+			if (integer >= INT_MIN && integer <= INT_MAX) {
+				result.setInteger(static_cast<int>(integer));
+
+			} else {
+				result.setDouble(static_cast<double>(integer));
+			}
+		}
+	};
+
+	void Value::loadFromMsgPack(std::istream &input) {
+		StreamSource source(input);
+		MsgPackReader::read(source, *this);
+	}
+
+	void Value::loadFromMsgPack(const char *data, size_t size) {
+		MemorySource source(data, size);
+		MsgPackReader::read(source, *this);
+	}
+
+	void Value::writeMsgPack(std::ostream &output) const {
+		StreamSink sink(output);
+		writeMsgPackValue(sink, *this);
+	}
+
+	void Value::writeMsgPack(std::string &buffer) const {
+		StringSink sink(buffer);
+		writeMsgPackValue(sink, *this);
+	}
+}
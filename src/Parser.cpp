@@ -0,0 +1,244 @@
+#include <JsonBox/Parser.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <streambuf>
+
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/TranscodingStream.h>
+#include <JsonBox/Value.h>
+
+namespace JsonBox {
+	/**
+	 * Input stream reading a block of memory in place, pointed at a new
+	 * block for each parse.
+	 */
+	class Parser::MemoryInput : public std::streambuf {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		MemoryInput() : stream(this) {
+		}
+
+		/**
+		 * Points the stream at a block of memory and clears its state.
+		 * @param data Pointer to the first character of the block.
+		 * @param size Number of characters in the block.
+		 * @return Input stream reading the block.
+		 */
+		std::istream &reset(const char *data, size_t size) {
+			char *begin = const_cast<char *>(data);
+			setg(begin, begin, begin + size);
+			stream.clear();
+			return stream;
+		}
+
+	private:
+		/// Input stream reading from this streambuf.
+		std::istream stream;
+	};
+
+	const unsigned int Parser::DEFAULT_MAXIMUM_DEPTH;
+	const size_t Parser::DEFAULT_MAXIMUM_INTERNED_COUNT;
+
+	namespace {
+		/**
+		 * Appends the rest of a streambuf to a string.
+		 * @param source Streambuf to read.
+		 * @param result String receiving the bytes read.
+		 * @param maximumSize Maximum size of the string.
+		 * @return False if the streambuf goes past the maximum size.
+		 */
+		bool readAll(std::streambuf *source, std::string &result,
+		             size_t maximumSize) {
+			const size_t BLOCK_SIZE = 65536;
+			std::streamsize count;
+
+			do {
+				size_t size = result.size();
+				result.resize(size + BLOCK_SIZE);
+				count = source->sgetn(&result[size], static_cast<std::streamsize>(BLOCK_SIZE));
+				result.resize(size + static_cast<size_t>(std::max<std::streamsize>(count, 0)));
+
+				if (result.size() > maximumSize) {
+					return false;
+				}
+			} while (count == static_cast<std::streamsize>(BLOCK_SIZE));
+
+			return true;
+		}
+
+		/**
+		 * Describes a document longer than the maximum size.
+		 * @param maximumSize Maximum size of the documents.
+		 * @return Result of the validation.
+		 */
+		ValidationResult makeTooLarge(size_t maximumSize) {
+			ValidationResult result;
+			result.valid = false;
+			result.error = ValidationResult::TOO_LARGE;
+			result.position = maximumSize;
+			result.message = "JSON document exceeds the maximum size.";
+			return result;
+		}
+	}
+
+	Parser::Parser() : memoryInput(NULL), buffer(), members(), document(),
+		transcoded(), frames(),
+		maximumDepth(DEFAULT_MAXIMUM_DEPTH),
+		maximumSize(std::numeric_limits<size_t>::max()),
+		typedArrays(false), maximumInternedSize(0),
+		maximumInternedCount(DEFAULT_MAXIMUM_INTERNED_COUNT), strings(),
+		internedText(std::string()) {
+	}
+
+	Parser::~Parser() {
+		clearInternedStrings();
+		delete memoryInput;
+	}
+
+	void Parser::parse(const char *json, size_t size, Value &result) {
+		if (size > maximumSize) {
+			throw JsonParsingError("JSON document exceeds the maximum size.");
+		}
+
+		if (!memoryInput) {
+			memoryInput = new MemoryInput();
+		}
+
+		result.readDocument(memoryInput->reset(json, size), NULL, *this);
+	}
+
+	void Parser::parse(const std::string &json, Value &result) {
+		parse(json.data(), json.size(), result);
+	}
+
+	void Parser::parse(std::istream &input, Value &result) {
+		if (maximumSize != std::numeric_limits<size_t>::max()) {
+			// The bytes are counted as the stream is read in blocks.
+			TranscodingInputStream limited(input, Encoding::UTF8, std::string(), maximumSize);
+			result.readDocument(limited, NULL, *this);
+
+		} else {
+			result.readDocument(input, NULL, *this);
+		}
+	}
+
+	ValidationResult Parser::tryParse(const char *json, size_t size,
+	                                  Value &result) {
+		if (size > maximumSize) {
+			return makeTooLarge(maximumSize);
+		}
+
+		size_t byteOrderMarkSize;
+		Encoding::Format format = Encoding::detect(json, std::min<size_t>(size, 4), byteOrderMarkSize);
+
+		if (format == Encoding::UTF8) {
+			return tryParseUTF8(json, size, byteOrderMarkSize, result);
+
+		} else {
+			if (!memoryInput) {
+				memoryInput = new MemoryInput();
+			}
+
+			// The converted text can be larger, it isn't limited.
+			TranscodingInputStream converted(memoryInput->reset(json + byteOrderMarkSize, size - byteOrderMarkSize), format);
+			transcoded.clear();
+			readAll(converted.rdbuf(), transcoded, std::numeric_limits<size_t>::max());
+			return tryParseUTF8(transcoded.data(), transcoded.size(), 0, result);
+		}
+	}
+
+	ValidationResult Parser::tryParse(const std::string &json, Value &result) {
+		return tryParse(json.data(), json.size(), result);
+	}
+
+	ValidationResult Parser::tryParse(std::istream &input, Value &result) {
+		document.clear();
+
+		if (!readAll(input.rdbuf(), document, maximumSize)) {
+			return makeTooLarge(maximumSize);
+		}
+
+		return tryParse(document.data(), document.size(), result);
+	}
+
+	ValidationResult Parser::tryParseUTF8(const char *json, size_t size,
+	                                      size_t byteOrderMarkSize,
+	                                      Value &result) {
+		ValidationResult validation = validate(json + byteOrderMarkSize, size - byteOrderMarkSize, maximumDepth);
+
+		if (validation.valid) {
+			// The parser accepts all the valid JSON within the limits.
+			parse(json, size, result);
+
+		} else {
+			validation.position += byteOrderMarkSize;
+		}
+
+		return validation;
+	}
+
+	unsigned int Parser::getMaximumDepth() const {
+		return maximumDepth;
+	}
+
+	void Parser::setMaximumDepth(unsigned int newMaximumDepth) {
+		maximumDepth = newMaximumDepth;
+	}
+
+	size_t Parser::getMaximumSize() const {
+		return maximumSize;
+	}
+
+	void Parser::setMaximumSize(size_t newMaximumSize) {
+		maximumSize = newMaximumSize;
+	}
+
+	bool Parser::getTypedArrays() const {
+		return typedArrays;
+	}
+
+	void Parser::setTypedArrays(bool newTypedArrays) {
+		typedArrays = newTypedArrays;
+	}
+
+	size_t Parser::getMaximumInternedSize() const {
+		return maximumInternedSize;
+	}
+
+	void Parser::setMaximumInternedSize(size_t newMaximumInternedSize) {
+		maximumInternedSize = newMaximumInternedSize;
+	}
+
+	size_t Parser::getMaximumInternedCount() const {
+		return maximumInternedCount;
+	}
+
+	void Parser::setMaximumInternedCount(size_t newMaximumInternedCount) {
+		maximumInternedCount = newMaximumInternedCount;
+	}
+
+	size_t Parser::getInternedStringCount() const {
+		return strings.size();
+	}
+
+	void Parser::clearInternedStrings() {
+		for (StringTable::iterator i = strings.begin(); i != strings.end(); ++i) {
+			Value::releaseString(*i);
+		}
+
+		strings.clear();
+	}
+
+	size_t Parser::StringHash::operator()(const Value::String *string) const {
+		return std::hash<std::string>()(string->text);
+	}
+
+	bool Parser::StringEqual::operator()(const Value::String *left,
+	                                     const Value::String *right) const {
+		return left->text == right->text;
+	}
+}
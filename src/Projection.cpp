@@ -0,0 +1,64 @@
+#include <JsonBox/Projection.h>
+
+namespace JsonBox {
+	Projection::Projection() : filter(), complete(false), members() {
+	}
+
+	Projection::Projection(MemberFilter newFilter) : filter(newFilter),
+		complete(false), members() {
+	}
+
+	Projection &Projection::addPointer(const std::string &pointer) {
+		Projection *current = this;
+		size_t position = 0;
+
+		if (!filter) {
+			// Each reference token starts with a solidus.
+			while (!current->complete && position < pointer.size()) {
+				size_t end = pointer.find('/', position + 1);
+				std::string token;
+
+				if (end == std::string::npos) {
+					end = pointer.size();
+				}
+
+				// We unescape the "~1" and "~0" sequences, in that order.
+				for (size_t i = position + 1; i < end; ++i) {
+					if (pointer[i] == '~' && i + 1 < end && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+						token.push_back((pointer[++i] == '1') ? ('/') : ('~'));
+
+					} else {
+						token.push_back(pointer[i]);
+					}
+				}
+
+				current = &current->members[token];
+				position = end;
+			}
+
+			// The value is selected whole, its previous selections don't
+			// matter anymore.
+			current->complete = true;
+			current->members.clear();
+		}
+
+		return *this;
+	}
+
+	bool Projection::selectMember(const std::string &name,
+	                              const Projection *&memberProjection) const {
+		bool result;
+
+		if (filter) {
+			result = filter(name);
+			memberProjection = this;
+
+		} else {
+			std::map<std::string, Projection>::const_iterator member = members.find(name);
+			result = (member != members.end());
+			memberProjection = (result && !member->second.complete) ? (&member->second) : (NULL);
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,642 @@
+#include <JsonBox/Snapshot.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <JsonBox/BinaryStream.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+
+namespace JsonBox {
+	/*
+	 * Snapshot layout, all numbers in big-endian byte order:
+	 *
+	 * header: magic (8 bytes), version (u32), reserved (u32), offset of the
+	 *         root node (u64), size of the file (u64)
+	 * nodes:  tag (1 byte) followed by
+	 *         - nothing for null, false and true
+	 *         - the integer (i32) or the double (IEEE 754, 64 bits)
+	 *         - the string's size (u32), its bytes and a null character
+	 *         - an array's element count (u32) and the offsets of the
+	 *           elements' nodes (u64 each)
+	 *         - an object's member count (u32) and the offsets of each
+	 *           member's name node and value node (u64 each), sorted by name
+	 *
+	 * Nodes are written after the nodes they refer to, so the root node is
+	 * the last one. Member names and short strings are written once and
+	 * shared by all the nodes using them.
+	 */
+	namespace SnapshotFormat {
+		const char MAGIC[] = {'J', 'B', 'S', 'N', 'A', 'P', 'S', 'H'};
+		const size_t MAGIC_SIZE = sizeof(MAGIC);
+		const uint32_t VERSION = 1;
+		const uint64_t HEADER_SIZE = 32;
+		const size_t ROOT_OFFSET_POSITION = 16;
+		const size_t FILE_SIZE_POSITION = 24;
+
+		const uint8_t NULL_TAG = 0;
+		const uint8_t FALSE_TAG = 1;
+		const uint8_t TRUE_TAG = 2;
+		const uint8_t INTEGER_TAG = 3;
+		const uint8_t DOUBLE_TAG = 4;
+		const uint8_t STRING_TAG = 5;
+		const uint8_t ARRAY_TAG = 6;
+		const uint8_t OBJECT_TAG = 7;
+
+		const unsigned int TAG_SIZE = 1;
+		const unsigned int COUNT_SIZE = 4;
+		const unsigned int OFFSET_SIZE = 8;
+		const unsigned int MEMBER_SIZE = 2 * OFFSET_SIZE;
+
+		/// Strings up to this size are shared between the nodes using them.
+		const size_t MAXIMUM_SHARED_STRING_SIZE = 64;
+	}
+
+	namespace {
+		/**
+		 * Writes the nodes of a value into a snapshot file, keeping track of
+		 * their offsets.
+		 */
+		class SnapshotWriter {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param output Output stream to write to, positioned at the
+			 * start of the snapshot.
+			 */
+			explicit SnapshotWriter(std::ostream &output) : sink(output),
+				position(0), sharedStrings() {
+			}
+
+			/**
+			 * Writes the snapshot's header.
+			 * @param rootOffset Offset of the root node.
+			 * @param fileSize Size of the whole snapshot.
+			 */
+			void writeHeader(uint64_t rootOffset, uint64_t fileSize) {
+				write(SnapshotFormat::MAGIC, SnapshotFormat::MAGIC_SIZE);
+				putNumber(SnapshotFormat::VERSION, 4);
+				putNumber(0, 4);
+				putNumber(rootOffset, SnapshotFormat::OFFSET_SIZE);
+				putNumber(fileSize, SnapshotFormat::OFFSET_SIZE);
+			}
+
+			/**
+			 * Writes the nodes of the numbers of an array using a typed
+			 * storage.
+			 * @param numbers Numbers of the array.
+			 * @param elements Receives the offsets of the numbers' nodes.
+			 */
+			template <typename T>
+			void writeNumbers(NumericSpan<const T> numbers,
+			                  std::vector<uint64_t> &elements) {
+				elements.reserve(numbers.size());
+
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					elements.push_back(writeNumber(*i));
+				}
+			}
+
+			/**
+			 * Writes the node of a number.
+			 * @param number Number to write, as a double if it doesn't fit in
+			 * an int.
+			 * @return Offset of the number's node.
+			 */
+			uint64_t writeNumber(int32_t number) {
+				uint64_t result = beginNode(SnapshotFormat::INTEGER_TAG);
+				putNumber(static_cast<uint32_t>(number), 4);
+				return result;
+			}
+
+			uint64_t writeNumber(int64_t number) {
+				return (number >= INT32_MIN && number <= INT32_MAX) ? (writeNumber(static_cast<int32_t>(number))) : (writeNumber(static_cast<double>(number)));
+			}
+
+			uint64_t writeNumber(float number) {
+				return writeNumber(static_cast<double>(number));
+			}
+
+			uint64_t writeNumber(double number) {
+				uint64_t result = beginNode(SnapshotFormat::DOUBLE_TAG);
+				putNumber(doubleToBits(number), 8);
+				return result;
+			}
+
+			/**
+			 * Writes the nodes of a value and all its contents.
+			 * @param value Value to write.
+			 * @return Offset of the value's node.
+			 */
+			uint64_t writeValue(const Value &value) {
+				uint64_t result;
+
+				switch (value.getType()) {
+				case Value::STRING:
+					result = writeString(value.getString(), value.getString().size() <= SnapshotFormat::MAXIMUM_SHARED_STRING_SIZE);
+					break;
+
+				case Value::INTEGER:
+					result = writeNumber(static_cast<int32_t>(value.getInteger()));
+					break;
+
+				case Value::DOUBLE:
+					result = writeNumber(value.getDouble());
+					break;
+
+				case Value::OBJECT: {
+						const Object &object = value.getObject();
+						std::vector<std::pair<uint64_t, uint64_t> > members;
+						members.reserve(object.size());
+
+						// The object's members are already sorted by name.
+						for (Object::const_iterator i = object.begin(); i != object.end(); ++i) {
+							uint64_t nameOffset = writeString(i->first, true);
+							members.push_back(std::make_pair(nameOffset, writeValue(i->second)));
+						}
+
+						result = beginNode(SnapshotFormat::OBJECT_TAG);
+						putCount(members.size());
+
+						for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator i = members.begin(); i != members.end(); ++i) {
+							putNumber(i->first, SnapshotFormat::OFFSET_SIZE);
+							putNumber(i->second, SnapshotFormat::OFFSET_SIZE);
+						}
+					}
+					break;
+
+				case Value::ARRAY: {
+						std::vector<uint64_t> elements;
+
+						switch (value.getArrayStorage()) {
+						case Value::INT32_ARRAY:
+							writeNumbers(value.getInt32Array(), elements);
+							break;
+
+						case Value::INT64_ARRAY:
+							writeNumbers(value.getInt64Array(), elements);
+							break;
+
+						case Value::FLOAT_ARRAY:
+							writeNumbers(value.getFloatArray(), elements);
+							break;
+
+						case Value::DOUBLE_ARRAY:
+							writeNumbers(value.getDoubleArray(), elements);
+							break;
+
+						default: {
+								const Array &array = value.getArray();
+								elements.reserve(array.size());
+
+								for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+									elements.push_back(writeValue(*i));
+								}
+							}
+							break;
+						}
+
+						result = beginNode(SnapshotFormat::ARRAY_TAG);
+						putCount(elements.size());
+
+						for (std::vector<uint64_t>::const_iterator i = elements.begin(); i != elements.end(); ++i) {
+							putNumber(*i, SnapshotFormat::OFFSET_SIZE);
+						}
+					}
+					break;
+
+				case Value::BOOLEAN:
+					result = beginNode(value.getBoolean() ? SnapshotFormat::TRUE_TAG : SnapshotFormat::FALSE_TAG);
+					break;
+
+				case Value::RAW_JSON: {
+						Value parsed;
+						parsed.loadFromString(value.getRawJson());
+						result = writeValue(parsed);
+					}
+					break;
+
+				default:
+					result = beginNode(SnapshotFormat::NULL_TAG);
+					break;
+				}
+
+				return result;
+			}
+
+			/**
+			 * Gets the number of bytes written so far.
+			 * @return Offset of the next node.
+			 */
+			uint64_t getPosition() const {
+				return position;
+			}
+
+		private:
+			/**
+			 * Writes a string node, or finds the one already written for the
+			 * same string.
+			 * @param str String to write.
+			 * @param shared Specifies if the node can be shared with the
+			 * other identical strings.
+			 * @return Offset of the string's node.
+			 */
+			uint64_t writeString(const std::string &str, bool shared) {
+				if (shared) {
+					std::map<std::string, uint64_t>::const_iterator found = sharedStrings.find(str);
+
+					if (found != sharedStrings.end()) {
+						return found->second;
+					}
+				}
+
+				uint64_t result = beginNode(SnapshotFormat::STRING_TAG);
+				putCount(str.size());
+				write(str.c_str(), str.size() + 1);
+
+				if (shared) {
+					sharedStrings.insert(std::make_pair(str, result));
+				}
+
+				return result;
+			}
+
+			/**
+			 * Starts a node by writing its tag.
+			 * @param tag Tag of the node.
+			 * @return Offset of the node.
+			 */
+			uint64_t beginNode(uint8_t tag) {
+				uint64_t result = position;
+				sink.put(tag);
+				++position;
+				return result;
+			}
+
+			/**
+			 * Writes a size or a count. Throws a JsonWritingError if it
+			 * doesn't fit in 32 bits.
+			 * @param count Size or count to write.
+			 */
+			void putCount(size_t count) {
+				if (static_cast<uint64_t>(count) > 0xffffffffu) {
+					throw JsonWritingError("Value too large to be written in a snapshot.");
+				}
+
+				putNumber(count, SnapshotFormat::COUNT_SIZE);
+			}
+
+			/**
+			 * Writes an unsigned integer.
+			 * @param number Integer to write.
+			 * @param size Number of bytes to write.
+			 */
+			void putNumber(uint64_t number, unsigned int size) {
+				putBigEndian(sink, number, size);
+				position += size;
+			}
+
+			/**
+			 * Writes a block of bytes.
+			 * @param bytes Pointer to the first byte of the block.
+			 * @param size Number of bytes in the block.
+			 */
+			void write(const char *bytes, size_t size) {
+				sink.write(bytes, size);
+				position += size;
+			}
+
+			/// Sink writing to the snapshot file.
+			StreamSink sink;
+
+			/// Number of bytes written so far.
+			uint64_t position;
+
+			/// Offsets of the string nodes that can be shared.
+			std::map<std::string, uint64_t> sharedStrings;
+		};
+	}
+
+	SnapshotValue::SnapshotValue() : data(NULL), size(0), offset(0) {
+	}
+
+	Value::Type SnapshotValue::getType() const {
+		switch (getTag()) {
+		case SnapshotFormat::NULL_TAG:
+			return Value::NULL_VALUE;
+
+		case SnapshotFormat::FALSE_TAG:
+		case SnapshotFormat::TRUE_TAG:
+			return Value::BOOLEAN;
+
+		case SnapshotFormat::INTEGER_TAG:
+			return Value::INTEGER;
+
+		case SnapshotFormat::DOUBLE_TAG:
+			return Value::DOUBLE;
+
+		case SnapshotFormat::STRING_TAG:
+			return Value::STRING;
+
+		case SnapshotFormat::ARRAY_TAG:
+			return Value::ARRAY;
+
+		case SnapshotFormat::OBJECT_TAG:
+			return Value::OBJECT;
+
+		default:
+			throw JsonParsingError("Invalid snapshot node found.");
+		}
+	}
+
+	bool SnapshotValue::isString() const {
+		return getTag() == SnapshotFormat::STRING_TAG;
+	}
+
+	bool SnapshotValue::isInteger() const {
+		return getTag() == SnapshotFormat::INTEGER_TAG;
+	}
+
+	bool SnapshotValue::isDouble() const {
+		return getTag() == SnapshotFormat::DOUBLE_TAG;
+	}
+
+	bool SnapshotValue::isObject() const {
+		return getTag() == SnapshotFormat::OBJECT_TAG;
+	}
+
+	bool SnapshotValue::isArray() const {
+		return getTag() == SnapshotFormat::ARRAY_TAG;
+	}
+
+	bool SnapshotValue::isBoolean() const {
+		uint8_t tag = getTag();
+		return tag == SnapshotFormat::FALSE_TAG || tag == SnapshotFormat::TRUE_TAG;
+	}
+
+	bool SnapshotValue::isNull() const {
+		return getTag() == SnapshotFormat::NULL_TAG;
+	}
+
+	std::string SnapshotValue::getString() const {
+		return std::string(getStringData(), getStringSize());
+	}
+
+	const char *SnapshotValue::getStringData() const {
+		if (isString()) {
+			return getBytes(offset + SnapshotFormat::TAG_SIZE + SnapshotFormat::COUNT_SIZE, getStringSize() + 1);
+
+		} else {
+			return "";
+		}
+	}
+
+	size_t SnapshotValue::getStringSize() const {
+		return (isString()) ? (static_cast<size_t>(getCount())) : (0);
+	}
+
+	int SnapshotValue::getInteger() const {
+		uint8_t tag = getTag();
+
+		if (tag == SnapshotFormat::INTEGER_TAG) {
+			return static_cast<int32_t>(readBigEndian(getBytes(offset + SnapshotFormat::TAG_SIZE, 4), 4));
+
+		} else if (tag == SnapshotFormat::DOUBLE_TAG) {
+			return static_cast<int>(getDouble());
+
+		} else {
+			return 0;
+		}
+	}
+
+	double SnapshotValue::getDouble() const {
+		uint8_t tag = getTag();
+
+		if (tag == SnapshotFormat::DOUBLE_TAG) {
+			return bitsToDouble(readBigEndian(getBytes(offset + SnapshotFormat::TAG_SIZE, 8), 8));
+
+		} else if (tag == SnapshotFormat::INTEGER_TAG) {
+			return static_cast<double>(getInteger());
+
+		} else {
+			return 0.0;
+		}
+	}
+
+	bool SnapshotValue::getBoolean() const {
+		return getTag() == SnapshotFormat::TRUE_TAG;
+	}
+
+	size_t SnapshotValue::getSize() const {
+		uint8_t tag = getTag();
+		return (tag == SnapshotFormat::ARRAY_TAG || tag == SnapshotFormat::OBJECT_TAG) ? (static_cast<size_t>(getCount())) : (0);
+	}
+
+	SnapshotValue SnapshotValue::operator[](size_t index) const {
+		if (isArray() && index < getCount()) {
+			return getNode(offset + SnapshotFormat::TAG_SIZE + SnapshotFormat::COUNT_SIZE + static_cast<uint64_t>(index) * SnapshotFormat::OFFSET_SIZE);
+
+		} else {
+			return SnapshotValue();
+		}
+	}
+
+	SnapshotValue SnapshotValue::operator[](const std::string &key) const {
+		return find(key.data(), key.size());
+	}
+
+	SnapshotValue SnapshotValue::operator[](const char *key) const {
+		return find(key, std::strlen(key));
+	}
+
+	SnapshotValue SnapshotValue::find(const char *key, size_t keySize) const {
+		if (isObject()) {
+			uint32_t first = 0, last = getCount();
+
+			while (first < last) {
+				uint32_t middle = first + (last - first) / 2;
+				SnapshotValue name = getMemberName(middle);
+				size_t nameSize = name.getStringSize();
+				int comparison = std::memcmp(name.getStringData(), key, std::min(nameSize, keySize));
+
+				if (comparison == 0) {
+					comparison = (nameSize < keySize) ? (-1) : ((nameSize > keySize) ? (1) : (0));
+				}
+
+				if (comparison < 0) {
+					first = middle + 1;
+
+				} else if (comparison > 0) {
+					last = middle;
+
+				} else {
+					return getMemberValue(middle);
+				}
+			}
+		}
+
+		return SnapshotValue();
+	}
+
+	SnapshotValue SnapshotValue::getMemberName(size_t index) const {
+		if (isObject() && index < getCount()) {
+			return getNode(offset + SnapshotFormat::TAG_SIZE + SnapshotFormat::COUNT_SIZE + static_cast<uint64_t>(index) * SnapshotFormat::MEMBER_SIZE);
+
+		} else {
+			return SnapshotValue();
+		}
+	}
+
+	SnapshotValue SnapshotValue::getMemberValue(size_t index) const {
+		if (isObject() && index < getCount()) {
+			return getNode(offset + SnapshotFormat::TAG_SIZE + SnapshotFormat::COUNT_SIZE + static_cast<uint64_t>(index) * SnapshotFormat::MEMBER_SIZE + SnapshotFormat::OFFSET_SIZE);
+
+		} else {
+			return SnapshotValue();
+		}
+	}
+
+	Value SnapshotValue::toValue() const {
+		Value result;
+		copyTo(result, 0);
+		return result;
+	}
+
+	SnapshotValue::SnapshotValue(const char *newData, size_t newSize,
+	                             uint64_t newOffset) : data(newData),
+		size(newSize), offset(newOffset) {
+	}
+
+	const char *SnapshotValue::getBytes(uint64_t position, uint64_t length) const {
+		if (position > size || length > size - position) {
+			throw JsonParsingError("Invalid snapshot node found.");
+		}
+
+		return data + position;
+	}
+
+	uint8_t SnapshotValue::getTag() const {
+		return (offset == 0) ? (SnapshotFormat::NULL_TAG) : (static_cast<uint8_t>(*getBytes(offset, SnapshotFormat::TAG_SIZE)));
+	}
+
+	uint32_t SnapshotValue::getCount() const {
+		uint32_t result = static_cast<uint32_t>(readBigEndian(getBytes(offset + SnapshotFormat::TAG_SIZE, SnapshotFormat::COUNT_SIZE), SnapshotFormat::COUNT_SIZE));
+		uint8_t tag = getTag();
+		uint64_t entrySize = (tag == SnapshotFormat::ARRAY_TAG) ? (SnapshotFormat::OFFSET_SIZE) : ((tag == SnapshotFormat::OBJECT_TAG) ? (SnapshotFormat::MEMBER_SIZE) : (1));
+
+		// A corrupted count is rejected before anything is allocated for it.
+		getBytes(offset + SnapshotFormat::TAG_SIZE + SnapshotFormat::COUNT_SIZE, result * entrySize);
+		return result;
+	}
+
+	SnapshotValue SnapshotValue::getNode(uint64_t position) const {
+		uint64_t nodeOffset = readBigEndian(getBytes(position, SnapshotFormat::OFFSET_SIZE), SnapshotFormat::OFFSET_SIZE);
+
+		// Pointing strictly backwards, the nodes can't form a cycle.
+		if (nodeOffset < SnapshotFormat::HEADER_SIZE || nodeOffset >= offset) {
+			throw JsonParsingError("Invalid snapshot node found.");
+		}
+
+		return SnapshotValue(data, size, nodeOffset);
+	}
+
+	void SnapshotValue::copyTo(Value &result, unsigned int depth) const {
+		switch (getType()) {
+		case Value::STRING:
+			result.setString(getString());
+			break;
+
+		case Value::INTEGER:
+			result.setInteger(getInteger());
+			break;
+
+		case Value::DOUBLE:
+			result.setDouble(getDouble());
+			break;
+
+		case Value::OBJECT: {
+				size_t memberCount = getSize();
+				requireDepth(depth);
+				result.setObject(Object());
+
+				for (size_t i = 0; i < memberCount; ++i) {
+					getMemberValue(i).copyTo(result[getMemberName(i).getString()], depth + 1);
+				}
+			}
+			break;
+
+		case Value::ARRAY: {
+				size_t elementCount = getSize();
+				requireDepth(depth);
+				result.setArray(Array(elementCount));
+
+				for (size_t i = 0; i < elementCount; ++i) {
+					(*this)[i].copyTo(result[i], depth + 1);
+				}
+			}
+			break;
+
+		case Value::BOOLEAN:
+			result.setBoolean(getBoolean());
+			break;
+
+		default:
+			result.setNull();
+			break;
+		}
+	}
+
+	Snapshot::Snapshot(const std::string &filePath) : file(filePath),
+		rootOffset(0) {
+		const char *header = file.getData();
+
+		if (file.getSize() < SnapshotFormat::HEADER_SIZE ||
+		    std::memcmp(header, SnapshotFormat::MAGIC, SnapshotFormat::MAGIC_SIZE) != 0 ||
+		    readBigEndian(header + SnapshotFormat::MAGIC_SIZE, 4) != SnapshotFormat::VERSION ||
+		    readBigEndian(header + SnapshotFormat::FILE_SIZE_POSITION, SnapshotFormat::OFFSET_SIZE) != file.getSize()) {
+			throw JsonParsingError(std::string("Invalid snapshot file: ").append(filePath));
+		}
+
+		rootOffset = readBigEndian(header + SnapshotFormat::ROOT_OFFSET_POSITION, SnapshotFormat::OFFSET_SIZE);
+
+		if (rootOffset < SnapshotFormat::HEADER_SIZE || rootOffset >= file.getSize()) {
+			throw JsonParsingError(std::string("Invalid snapshot file: ").append(filePath));
+		}
+	}
+
+	SnapshotValue Snapshot::getRoot() const {
+		return SnapshotValue(file.getData(), file.getSize(), rootOffset);
+	}
+
+	bool Snapshot::isMapped() const {
+		return file.isMapped();
+	}
+
+	void Value::writeSnapshot(const std::string &filePath) const {
+		std::ofstream file;
+		file.open(filePath.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+
+		if (file.is_open()) {
+			SnapshotWriter writer(file);
+			writer.writeHeader(0, 0);
+			uint64_t root = writer.writeValue(*this);
+			uint64_t fileSize = writer.getPosition();
+
+			// Now that the root node is written, we know where it is.
+			file.seekp(0);
+			SnapshotWriter(file).writeHeader(root, fileSize);
+			file.close();
+
+			if (file.fail()) {
+				throw JsonWritingError(std::string("Failed to write the following snapshot file: ").append(filePath));
+			}
+
+		} else {
+			throw JsonWritingError(std::string("Failed to open the following file to write the snapshot to: ").append(filePath));
+		}
+	}
+}
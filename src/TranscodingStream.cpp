@@ -0,0 +1,203 @@
+#include <JsonBox/TranscodingStream.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <JsonBox/Convert.h>
+#include <JsonBox/JsonParsingError.h>
+
+namespace JsonBox {
+	/// Number of bytes read from the source at once.
+	static const size_t TRANSCODING_BLOCK_SIZE = 64 * 1024;
+
+	/// Number of converted characters kept to be put back.
+	static const size_t TRANSCODING_PUTBACK_SIZE = 16;
+
+	/// Longest UTF-8 sequence appended at once.
+	static const size_t MAXIMUM_SEQUENCE_SIZE = 4;
+
+	Encoding::Format Encoding::detect(const char *bytes, size_t size,
+	                                  size_t &byteOrderMarkSize) {
+		const unsigned char *b = reinterpret_cast<const unsigned char *>(bytes);
+		Format result = UTF8;
+
+		byteOrderMarkSize = 0;
+
+		if (size >= 3 && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) {
+			byteOrderMarkSize = 3;
+
+		} else if (size >= 4 && b[0] == 0x00 && b[1] == 0x00 && b[2] == 0xFE && b[3] == 0xFF) {
+			result = UTF32BE;
+			byteOrderMarkSize = 4;
+
+		} else if (size >= 4 && b[0] == 0xFF && b[1] == 0xFE && b[2] == 0x00 && b[3] == 0x00) {
+			result = UTF32LE;
+			byteOrderMarkSize = 4;
+
+		} else if (size >= 2 && b[0] == 0xFE && b[1] == 0xFF) {
+			result = UTF16BE;
+			byteOrderMarkSize = 2;
+
+		} else if (size >= 2 && b[0] == 0xFF && b[1] == 0xFE) {
+			result = UTF16LE;
+			byteOrderMarkSize = 2;
+
+		} else if (size >= 4 && b[0] == 0x00 && b[1] == 0x00 && b[2] == 0x00) {
+			// 00 00 00 xx
+			result = UTF32BE;
+
+		} else if (size >= 4 && b[1] == 0x00 && b[2] == 0x00 && b[3] == 0x00) {
+			// xx 00 00 00
+			result = UTF32LE;
+
+		} else if (size >= 2 && b[0] == 0x00) {
+			// 00 xx
+			result = UTF16BE;
+
+		} else if (size >= 2 && b[1] == 0x00) {
+			// xx 00
+			result = UTF16LE;
+		}
+
+		return result;
+	}
+
+	TranscodingStreambuf::TranscodingStreambuf(std::streambuf *newSource,
+	                                           Encoding::Format newFormat,
+	                                           const std::string &prefix,
+	                                           size_t newMaximumSize) :
+		source(newSource), format(newFormat),
+		input(std::max(TRANSCODING_BLOCK_SIZE, prefix.size() + MAXIMUM_SEQUENCE_SIZE)),
+		inputNext(0), inputEnd(prefix.size()), sourceEnded(false),
+		remainingSize(newMaximumSize), output() {
+		if (prefix.size() > remainingSize) {
+			throw JsonParsingError("JSON document exceeds the maximum size.");
+		}
+
+		remainingSize -= prefix.size();
+		std::copy(prefix.begin(), prefix.end(), input.begin());
+		output.reserve(TRANSCODING_PUTBACK_SIZE + TRANSCODING_BLOCK_SIZE + MAXIMUM_SEQUENCE_SIZE);
+	}
+
+	TranscodingStreambuf::int_type TranscodingStreambuf::underflow() {
+		if (gptr() == egptr()) {
+			// The last characters are kept in front of the block so they
+			// can still be put back.
+			size_t putbackSize = std::min<size_t>(gptr() - eback(), TRANSCODING_PUTBACK_SIZE);
+			std::string putback(gptr() - putbackSize, gptr());
+
+			output.assign(putback);
+
+			while (output.size() == putbackSize && (inputNext != inputEnd || !sourceEnded)) {
+				// A code unit or a surrogate pair can span two blocks.
+				if (inputEnd - inputNext < MAXIMUM_SEQUENCE_SIZE && !sourceEnded) {
+					fillInput();
+				}
+
+				convertInput(putbackSize + TRANSCODING_BLOCK_SIZE);
+			}
+
+			char *begin = &output[0];
+			setg(begin, begin + putbackSize, begin + output.size());
+		}
+
+		return (gptr() == egptr()) ? (traits_type::eof()) : (traits_type::to_int_type(*gptr()));
+	}
+
+	void TranscodingStreambuf::fillInput() {
+		size_t remaining = inputEnd - inputNext;
+
+		if (remaining > 0) {
+			std::memmove(&input[0], &input[inputNext], remaining);
+		}
+
+		inputNext = 0;
+		inputEnd = remaining;
+
+		// One byte more than allowed is asked for, to know if the source
+		// goes past the maximum size.
+		size_t wanted = std::min(input.size() - inputEnd, (remainingSize < input.size()) ? (remainingSize + 1) : (input.size()));
+		std::streamsize count = source->sgetn(&input[inputEnd], static_cast<std::streamsize>(wanted));
+
+		if (count > 0) {
+			if (static_cast<size_t>(count) > remainingSize) {
+				throw JsonParsingError("JSON document exceeds the maximum size.");
+			}
+
+			inputEnd += static_cast<size_t>(count);
+			remainingSize -= static_cast<size_t>(count);
+
+		} else {
+			sourceEnded = true;
+		}
+	}
+
+	void TranscodingStreambuf::convertInput(size_t limit) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&input[0]);
+		size_t unitSize = (format == Encoding::UTF8) ? (1) : ((format == Encoding::UTF16LE || format == Encoding::UTF16BE) ? (2) : (4));
+
+		if (format == Encoding::UTF8) {
+			size_t count = std::min(inputEnd - inputNext, limit - output.size());
+			output.append(&input[inputNext], count);
+			inputNext += count;
+		}
+
+		while (format != Encoding::UTF8 && output.size() < limit && inputEnd - inputNext >= unitSize) {
+			const unsigned char *unit = bytes + inputNext;
+			int32_t codePoint;
+
+			if (format == Encoding::UTF16LE || format == Encoding::UTF16BE) {
+				bool littleEndian = (format == Encoding::UTF16LE);
+				codePoint = (littleEndian) ? (unit[0] | (unit[1] << 8)) : ((unit[0] << 8) | unit[1]);
+
+				if (codePoint < 0x80) {
+					// Most of the characters of a JSON document are ASCII.
+					output.push_back(static_cast<char>(codePoint));
+					inputNext += 2;
+					continue;
+
+				} else if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+					if (inputEnd - inputNext < 4 && !sourceEnded) {
+						// We wait for the low surrogate.
+						break;
+
+					} else if (inputEnd - inputNext >= 4) {
+						int32_t lowSurrogate = (littleEndian) ? (unit[2] | (unit[3] << 8)) : ((unit[2] << 8) | unit[3]);
+
+						if (lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF) {
+							codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+							inputNext += 2;
+						}
+					}
+				}
+
+				// The unpaired surrogates are replaced by appendUTF8(...).
+				inputNext += 2;
+
+			} else {
+				uint32_t value = (format == Encoding::UTF32LE) ?
+				                 (unit[0] | (unit[1] << 8) | (unit[2] << 16) | (static_cast<uint32_t>(unit[3]) << 24)) :
+				                 ((static_cast<uint32_t>(unit[0]) << 24) | (unit[1] << 16) | (unit[2] << 8) | unit[3]);
+				codePoint = (value > 0x10FFFF) ? (Convert::REPLACEMENT_CHARACTER) : (static_cast<int32_t>(value));
+				inputNext += 4;
+			}
+
+			Convert::appendUTF8(codePoint, output);
+		}
+
+		if (sourceEnded && inputNext != inputEnd && inputEnd - inputNext < unitSize) {
+			// The text ends in the middle of a code unit.
+			Convert::appendUTF8(Convert::REPLACEMENT_CHARACTER, output);
+			inputNext = inputEnd;
+		}
+	}
+
+	TranscodingInputStream::TranscodingInputStream(std::istream &source,
+	                                               Encoding::Format format,
+	                                               const std::string &prefix,
+	                                               size_t maximumSize) :
+		std::istream(NULL), buffer(source.rdbuf(), format, prefix, maximumSize) {
+		rdbuf(&buffer);
+		exceptions(std::ios::badbit);
+	}
+}
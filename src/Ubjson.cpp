@@ -0,0 +1,774 @@
+#include <JsonBox/Value.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#include <JsonBox/BinaryStream.h>
+#include <JsonBox/JsonParsingError.h>
+#include <JsonBox/JsonWritingError.h>
+
+namespace JsonBox {
+	// Universal Binary JSON markers.
+	namespace Ubjson {
+		const uint8_t NULL_VALUE = 'Z';
+		const uint8_t NO_OP = 'N';
+		const uint8_t TRUE_VALUE = 'T';
+		const uint8_t FALSE_VALUE = 'F';
+		const uint8_t INT8 = 'i';
+		const uint8_t UINT8 = 'U';
+		const uint8_t INT16 = 'I';
+		const uint8_t INT32 = 'l';
+		const uint8_t INT64 = 'L';
+		const uint8_t FLOAT32 = 'd';
+		const uint8_t FLOAT64 = 'D';
+		const uint8_t HIGH_PRECISION = 'H';
+		const uint8_t CHAR = 'C';
+		const uint8_t STRING = 'S';
+		const uint8_t BEGIN_ARRAY = '[';
+		const uint8_t END_ARRAY = ']';
+		const uint8_t BEGIN_OBJECT = '{';
+		const uint8_t END_OBJECT = '}';
+		const uint8_t CONTAINER_TYPE = '$';
+		const uint8_t CONTAINER_COUNT = '#';
+	}
+
+	namespace {
+		/**
+		 * Gets the narrowest integer marker holding a range of integers.
+		 * @param minimum Smallest integer of the range.
+		 * @param maximum Largest integer of the range.
+		 * @return Integer marker.
+		 */
+		uint8_t getUbjsonIntegerMarker(int64_t minimum, int64_t maximum) {
+			uint8_t result;
+
+			if (minimum >= -0x80 && maximum < 0x80) {
+				result = Ubjson::INT8;
+
+			} else if (minimum >= 0 && maximum <= 0xff) {
+				result = Ubjson::UINT8;
+
+			} else if (minimum >= -0x8000 && maximum < 0x8000) {
+				result = Ubjson::INT16;
+
+			} else if (minimum >= INT32_MIN && maximum <= INT32_MAX) {
+				result = Ubjson::INT32;
+
+			} else {
+				result = Ubjson::INT64;
+			}
+
+			return result;
+		}
+
+		/**
+		 * Gets the number of bytes following a number marker.
+		 * @param marker Integer or float marker.
+		 * @return Size of the number, 0 if the marker isn't a number marker.
+		 */
+		unsigned int getUbjsonNumberSize(uint8_t marker) {
+			switch (marker) {
+			case Ubjson::INT8:
+			case Ubjson::UINT8:
+				return 1;
+
+			case Ubjson::INT16:
+				return 2;
+
+			case Ubjson::INT32:
+			case Ubjson::FLOAT32:
+				return 4;
+
+			case Ubjson::INT64:
+			case Ubjson::FLOAT64:
+				return 8;
+
+			default:
+				return 0;
+			}
+		}
+
+		/**
+		 * Writes an integer with the narrowest integer marker holding it.
+		 * @param sink Sink to write the integer to.
+		 * @param integer Integer to write.
+		 */
+		template <typename Sink>
+		void writeUbjsonInteger(Sink &sink, int64_t integer) {
+			uint8_t marker = getUbjsonIntegerMarker(integer, integer);
+			sink.put(marker);
+			putBigEndian(sink, static_cast<uint64_t>(integer), getUbjsonNumberSize(marker));
+		}
+
+		/**
+		 * Writes a double as a 32 bit float if it doesn't lose precision, as
+		 * a 64 bit float otherwise. Infinities and NaN are written as null,
+		 * as the format requires.
+		 * @param sink Sink to write the double to.
+		 * @param number Double to write.
+		 */
+		template <typename Sink>
+		void writeUbjsonDouble(Sink &sink, double number) {
+			if (!std::isfinite(number)) {
+				sink.put(Ubjson::NULL_VALUE);
+
+			} else if (isExactFloat(number)) {
+				sink.put(Ubjson::FLOAT32);
+				putBigEndian(sink, floatToBits(static_cast<float>(number)), 4);
+
+			} else {
+				sink.put(Ubjson::FLOAT64);
+				putBigEndian(sink, doubleToBits(number), 8);
+			}
+		}
+
+		/**
+		 * Writes the length and the bytes of a string, without the string
+		 * marker. Used as is for the object member names.
+		 * @param sink Sink to write the string to.
+		 * @param str String to write.
+		 */
+		template <typename Sink>
+		void writeUbjsonStringBytes(Sink &sink, const std::string &str) {
+			writeUbjsonInteger(sink, static_cast<int64_t>(str.size()));
+			sink.write(str.data(), str.size());
+		}
+
+		/**
+		 * Writes non-empty numbers as a strongly typed, count prefixed array:
+		 * a single type marker followed by the numbers' bytes. Integers use
+		 * the narrowest marker holding all of them, floating point numbers
+		 * are written as 32 bit floats if none of them loses precision.
+		 * @param sink Sink to write the array to.
+		 * @param numbers Numbers of the array.
+		 * @return True if the array was written, false if it is empty or
+		 * contains infinities or NaN and nothing was written.
+		 */
+		template <typename Sink, typename T>
+		bool writeUbjsonTypedArray(Sink &sink, NumericSpan<const T> numbers) {
+			bool isFloat = !std::numeric_limits<T>::is_integer;
+			uint8_t type;
+
+			if (numbers.empty()) {
+				return false;
+
+			} else if (isFloat) {
+				bool exactFloats = true;
+
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					if (!std::isfinite(static_cast<double>(*i))) {
+						return false;
+					}
+
+					exactFloats = exactFloats && isExactFloat(static_cast<double>(*i));
+				}
+
+				type = (exactFloats) ? (Ubjson::FLOAT32) : (Ubjson::FLOAT64);
+
+			} else {
+				int64_t minimum = 0, maximum = 0;
+
+				for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+					minimum = std::min<int64_t>(minimum, static_cast<int64_t>(*i));
+					maximum = std::max<int64_t>(maximum, static_cast<int64_t>(*i));
+				}
+
+				type = getUbjsonIntegerMarker(minimum, maximum);
+			}
+
+			unsigned int size = getUbjsonNumberSize(type);
+			sink.put(Ubjson::BEGIN_ARRAY);
+			sink.put(Ubjson::CONTAINER_TYPE);
+			sink.put(type);
+			sink.put(Ubjson::CONTAINER_COUNT);
+			writeUbjsonInteger(sink, static_cast<int64_t>(numbers.size()));
+
+			for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+				if (type == Ubjson::FLOAT32) {
+					putBigEndian(sink, floatToBits(static_cast<float>(*i)), 4);
+
+				} else if (type == Ubjson::FLOAT64) {
+					putBigEndian(sink, doubleToBits(static_cast<double>(*i)), 8);
+
+				} else {
+					putBigEndian(sink, static_cast<uint64_t>(static_cast<int64_t>(*i)), size);
+				}
+			}
+
+			return true;
+		}
+
+		/**
+		 * Writes the numbers of a typed storage as a strongly typed array,
+		 * or as an array without a type marker if it is empty or contains
+		 * infinities or NaN.
+		 * @param sink Sink to write the array to.
+		 * @param numbers Numbers to write.
+		 */
+		template <typename Sink, typename T>
+		void writeUbjsonNumbers(Sink &sink, NumericSpan<const T> numbers) {
+			if (writeUbjsonTypedArray(sink, numbers)) {
+				return;
+			}
+
+			sink.put(Ubjson::BEGIN_ARRAY);
+
+			for (const T *i = numbers.begin(); i != numbers.end(); ++i) {
+				if (std::numeric_limits<T>::is_integer) {
+					writeUbjsonInteger(sink, static_cast<int64_t>(*i));
+
+				} else {
+					writeUbjsonDouble(sink, static_cast<double>(*i));
+				}
+			}
+
+			sink.put(Ubjson::END_ARRAY);
+		}
+
+		/**
+		 * Writes a generic array as a strongly typed array if it contains
+		 * only integers or only doubles.
+		 * @param sink Sink to write the array to.
+		 * @param array Array to write.
+		 * @return True if the array was written, false if it isn't a
+		 * homogeneous array of numbers and nothing was written.
+		 */
+		template <typename Sink>
+		bool writeUbjsonHomogeneousArray(Sink &sink, const Array &array) {
+			bool result = false;
+
+			if (!array.empty() && array.front().isInteger()) {
+				std::vector<int32_t> integers;
+				integers.reserve(array.size());
+
+				for (Array::const_iterator i = array.begin(); i != array.end() && i->isInteger(); ++i) {
+					integers.push_back(i->getInteger());
+				}
+
+				result = integers.size() == array.size() && writeUbjsonTypedArray(sink, NumericSpan<const int32_t>(&integers[0], integers.size()));
+
+			} else if (!array.empty() && array.front().isDouble()) {
+				std::vector<double> numbers;
+				numbers.reserve(array.size());
+
+				for (Array::const_iterator i = array.begin(); i != array.end() && i->isDouble(); ++i) {
+					numbers.push_back(i->getDouble());
+				}
+
+				result = numbers.size() == array.size() && writeUbjsonTypedArray(sink, NumericSpan<const double>(&numbers[0], numbers.size()));
+			}
+
+			return result;
+		}
+
+		/**
+		 * Writes a value and all its contents.
+		 * @param sink Sink to write the value to.
+		 * @param value Value to write.
+		 */
+		template <typename Sink>
+		void writeUbjsonValue(Sink &sink, const Value &value) {
+			switch (value.getType()) {
+			case Value::STRING:
+				sink.put(Ubjson::STRING);
+				writeUbjsonStringBytes(sink, value.getString());
+				break;
+
+			case Value::INTEGER:
+				writeUbjsonInteger(sink, value.getInteger());
+				break;
+
+			case Value::DOUBLE:
+				writeUbjsonDouble(sink, value.getDouble());
+				break;
+
+			case Value::OBJECT: {
+					const Object &object = value.getObject();
+					sink.put(Ubjson::BEGIN_OBJECT);
+
+					for (Object::const_iterator i = object.begin(); i != object.end(); ++i) {
+						writeUbjsonStringBytes(sink, i->first);
+						writeUbjsonValue(sink, i->second);
+					}
+
+					sink.put(Ubjson::END_OBJECT);
+				}
+				break;
+
+			case Value::ARRAY:
+				switch (value.getArrayStorage()) {
+				case Value::INT32_ARRAY:
+					writeUbjsonNumbers(sink, value.getInt32Array());
+					break;
+
+				case Value::INT64_ARRAY:
+					writeUbjsonNumbers(sink, value.getInt64Array());
+					break;
+
+				case Value::FLOAT_ARRAY:
+					writeUbjsonNumbers(sink, value.getFloatArray());
+					break;
+
+				case Value::DOUBLE_ARRAY:
+					writeUbjsonNumbers(sink, value.getDoubleArray());
+					break;
+
+				default: {
+					const Array &array = value.getArray();
+
+					if (!writeUbjsonHomogeneousArray(sink, array)) {
+						// Empty arrays and arrays of doubles with
+						// infinities or NaN also end up here.
+						sink.put(Ubjson::BEGIN_ARRAY);
+
+						for (Array::const_iterator i = array.begin(); i != array.end(); ++i) {
+							writeUbjsonValue(sink, *i);
+						}
+
+						sink.put(Ubjson::END_ARRAY);
+					}
+				}
+					break;
+				}
+
+				break;
+
+			case Value::BOOLEAN:
+				sink.put(value.getBoolean() ? Ubjson::TRUE_VALUE : Ubjson::FALSE_VALUE);
+				break;
+
+			case Value::RAW_JSON: {
+					Value parsed;
+					parsed.loadFromString(value.getRawJson());
+					writeUbjsonValue(sink, parsed);
+				}
+				break;
+
+			default:
+				sink.put(Ubjson::NULL_VALUE);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * Reads Universal Binary JSON values. Declared as a friend of Value so
+	 * the strings, arrays and objects are filled in place.
+	 */
+	class UbjsonReader {
+	public:
+		/**
+		 * Reads a value and all its contents. Throws a JsonParsingError if
+		 * its arrays and objects are nested deeper than BINARY_MAXIMUM_DEPTH.
+		 * @param source Source to read the value from.
+		 * @param result Value replaced by the value read.
+		 * @param depth Number of arrays and objects containing the value.
+		 */
+		template <typename Source>
+		static void read(Source &source, Value &result, unsigned int depth = 0) {
+			uint8_t marker = source.get();
+
+			while (marker == Ubjson::NO_OP) {
+				marker = source.get();
+			}
+
+			readItem(source, marker, result, depth);
+		}
+
+	private:
+		/**
+		 * Reads a value whose marker was already read.
+		 * @param source Source to read the rest of the value from.
+		 * @param marker Marker giving the value's type.
+		 * @param result Value replaced by the value read.
+		 * @param depth Number of arrays and objects containing the value.
+		 */
+		template <typename Source>
+		static void readItem(Source &source, uint8_t marker, Value &result,
+		                     unsigned int depth) {
+			switch (marker) {
+			case Ubjson::NULL_VALUE:
+				result.setNull();
+				break;
+
+			case Ubjson::TRUE_VALUE:
+				result.setBoolean(true);
+				break;
+
+			case Ubjson::FALSE_VALUE:
+				result.setBoolean(false);
+				break;
+
+			case Ubjson::INT8:
+			case Ubjson::UINT8:
+			case Ubjson::INT16:
+			case Ubjson::INT32:
+			case Ubjson::INT64:
+				setInteger(readInteger(source, marker), result);
+				break;
+
+			case Ubjson::FLOAT32:
+				result.setDouble(bitsToFloat(static_cast<uint32_t>(getBigEndian(source, 4))));
+				break;
+
+			case Ubjson::FLOAT64:
+				result.setDouble(bitsToDouble(getBigEndian(source, 8)));
+				break;
+
+			case Ubjson::HIGH_PRECISION:
+				readHighPrecision(source, result);
+				break;
+
+			case Ubjson::CHAR:
+				result.setString(std::string(1, static_cast<char>(source.get())));
+				break;
+
+			case Ubjson::STRING:
+				result.setString(std::string());
+				source.read(result.data.stringValue->text, readLength(source, source.get()));
+				break;
+
+			case Ubjson::BEGIN_ARRAY:
+				readArray(source, result, depth);
+				break;
+
+			case Ubjson::BEGIN_OBJECT:
+				readObject(source, result, depth);
+				break;
+
+			default:
+				throw JsonParsingError("Invalid UBJSON marker found.");
+			}
+		}
+
+		/**
+		 * Reads the bytes of an integer.
+		 * @param source Source to read the integer from.
+		 * @param marker Integer marker giving the integer's size.
+		 * @return Integer read.
+		 */
+		template <typename Source>
+		static int64_t readInteger(Source &source, uint8_t marker) {
+			int64_t result;
+
+			switch (marker) {
+			case Ubjson::INT8:
+				result = static_cast<int8_t>(source.get());
+				break;
+
+			case Ubjson::UINT8:
+				result = source.get();
+				break;
+
+			case Ubjson::INT16:
+				result = static_cast<int16_t>(getBigEndian(source, 2));
+				break;
+
+			case Ubjson::INT32:
+				result = static_cast<int32_t>(getBigEndian(source, 4));
+				break;
+
+			case Ubjson::INT64:
+				result = static_cast<int64_t>(getBigEndian(source, 8));
+				break;
+
+			default:
+				throw JsonParsingError("Invalid UBJSON integer found.");
+			}
+
+			return result;
+		}
+
+		/**
+		 * Reads the length of a string or the count of a container.
+		 * @param source Source to read the length from.
+		 * @param marker Integer marker of the length, already read.
+		 * @return Length read.
+		 */
+		template <typename Source>
+		static size_t readLength(Source &source, uint8_t marker) {
+			int64_t length = readInteger(source, marker);
+
+			if (length < 0 || static_cast<uint64_t>(length) > std::numeric_limits<size_t>::max()) {
+				throw JsonParsingError("Invalid UBJSON length found.");
+			}
+
+			return static_cast<size_t>(length);
+		}
+
+		/**
+		 * Reads a high-precision number, a string containing a JSON number.
+		 * @param source Source to read the number from.
+		 * @param result Value replaced by the number, as a double if it
+		 * isn't an integer fitting in an int.
+		 */
+		template <typename Source>
+		static void readHighPrecision(Source &source, Value &result) {
+			std::string digits;
+			source.read(digits, readLength(source, source.get()));
+			std::istringstream stream(digits);
+			stream.imbue(std::locale::classic());
+			int64_t integer;
+			double number;
+
+			if (digits.find_first_of(".eE") == std::string::npos && (stream >> integer) && stream.eof()) {
+				setInteger(integer, result);
+
+			} else {
+				stream.clear();
+				stream.str(digits);
+
+				if ((stream >> number) && stream.eof()) {
+					result.setDouble(number);
+
+				} else {
+					throw JsonParsingError("Invalid UBJSON high-precision number found.");
+				}
+			}
+		}
+
+		/**
+		 * Reads the optional type and count following the beginning of a
+		 * container.
+		 * @param source Source to read the header from.
+		 * @param type Receives the type marker shared by all the elements,
+		 * 0 if the elements have their own markers.
+		 * @param count Receives the number of elements.
+		 * @param marker Receives the first marker inside the container if it
+		 * doesn't have a count.
+		 * @return True if the container has a count, false if it ends with
+		 * an end marker.
+		 */
+		template <typename Source>
+		static bool readContainerHeader(Source &source, uint8_t &type,
+		                                size_t &count, uint8_t &marker) {
+			bool counted = false;
+			type = 0;
+			count = 0;
+			marker = source.get();
+
+			if (marker == Ubjson::CONTAINER_TYPE) {
+				type = source.get();
+
+				if (source.get() != Ubjson::CONTAINER_COUNT) {
+					throw JsonParsingError("Invalid UBJSON container found.");
+				}
+
+				marker = Ubjson::CONTAINER_COUNT;
+			}
+
+			if (marker == Ubjson::CONTAINER_COUNT) {
+				count = readLength(source, source.get());
+				counted = true;
+			}
+
+			return counted;
+		}
+
+		/**
+		 * Reads the elements of an array. Strongly typed arrays of numbers
+		 * are read into the matching typed storage.
+		 * @param source Source to read the elements from.
+		 * @param result Value replaced by the array.
+		 * @param depth Number of arrays and objects containing the array.
+		 * @see JsonBox::Value::getArrayStorage
+		 */
+		template <typename Source>
+		static void readArray(Source &source, Value &result,
+		                      unsigned int depth) {
+			uint8_t type, marker;
+			size_t count;
+
+			requireDepth(depth);
+
+			if (!readContainerHeader(source, type, count, marker)) {
+				result.setArray(Array());
+				Array &array = *result.data.arrayValue;
+
+				while (marker != Ubjson::END_ARRAY) {
+					if (marker != Ubjson::NO_OP) {
+						array.push_back(Value());
+						readItem(source, marker, array.back(), depth + 1);
+					}
+
+					marker = source.get();
+				}
+
+			} else if (getUbjsonNumberSize(type) != 0) {
+				source.requireElements(count);
+
+				switch (type) {
+				case Ubjson::INT64:
+					readNumbers<int64_t>(source, type, count, result);
+					break;
+
+				case Ubjson::FLOAT32:
+					readNumbers<float>(source, type, count, result);
+					break;
+
+				case Ubjson::FLOAT64:
+					readNumbers<double>(source, type, count, result);
+					break;
+
+				default:
+					readNumbers<int32_t>(source, type, count, result);
+					break;
+				}
+
+			} else {
+				if (type != Ubjson::NULL_VALUE && type != Ubjson::TRUE_VALUE && type != Ubjson::FALSE_VALUE) {
+					source.requireElements(count);
+				}
+
+				result.setArray(Array());
+				Array &array = *result.data.arrayValue;
+				array.resize(count);
+
+				for (Array::iterator i = array.begin(); i != array.end(); ++i) {
+					if (type != 0) {
+						readItem(source, type, *i, depth + 1);
+
+					} else {
+						read(source, *i, depth + 1);
+					}
+				}
+			}
+		}
+
+		/**
+		 * Reads the numbers of a strongly typed array into a typed storage.
+		 * @tparam T Type of the typed storage's numbers.
+		 * @param source Source to read the numbers from.
+		 * @param type Number marker shared by the numbers.
+		 * @param count Number of numbers in the array.
+		 * @param result Value replaced by the array.
+		 */
+		template <typename T, typename Source>
+		static void readNumbers(Source &source, uint8_t type, size_t count,
+		                        Value &result) {
+			result.setTypedArray(std::vector<T>(count));
+			NumericSpan<T> numbers = getNumbers(result, static_cast<T *>(NULL));
+
+			for (T *i = numbers.begin(); i != numbers.end(); ++i) {
+				if (type == Ubjson::FLOAT32) {
+					*i = static_cast<T>(bitsToFloat(static_cast<uint32_t>(getBigEndian(source, 4))));
+
+				} else if (type == Ubjson::FLOAT64) {
+					*i = static_cast<T>(bitsToDouble(getBigEndian(source, 8)));
+
+				} else {
+					*i = static_cast<T>(readInteger(source, type));
+				}
+			}
+		}
+
+		/**
+		 * Gets the numbers of a value using a typed storage.
+		 * @param value Value using the typed storage.
+		 * @return View of the value's numbers.
+		 */
+		static NumericSpan<int32_t> getNumbers(Value &value, int32_t *) {
+			return value.getInt32Array();
+		}
+
+		static NumericSpan<int64_t> getNumbers(Value &value, int64_t *) {
+			return value.getInt64Array();
+		}
+
+		static NumericSpan<float> getNumbers(Value &value, float *) {
+			return value.getFloatArray();
+		}
+
+		static NumericSpan<double> getNumbers(Value &value, double *) {
+			return value.getDoubleArray();
+		}
+
+		/**
+		 * Reads the members of an object.
+		 * @param source Source to read the members from.
+		 * @param result Value replaced by the object.
+		 * @param depth Number of arrays and objects containing the object.
+		 */
+		template <typename Source>
+		static void readObject(Source &source, Value &result,
+		                       unsigned int depth) {
+			uint8_t type, marker;
+			size_t count;
+			std::string name;
+
+			requireDepth(depth);
+			bool counted = readContainerHeader(source, type, count, marker);
+
+			if (counted && type != Ubjson::NULL_VALUE && type != Ubjson::TRUE_VALUE && type != Ubjson::FALSE_VALUE) {
+				source.requireElements(count);
+			}
+
+			result.setObject(Object());
+
+			for (size_t i = 0; (counted) ? (i < count) : (marker != Ubjson::END_OBJECT); ++i) {
+				if (counted || marker != Ubjson::NO_OP) {
+					source.read(name, readLength(source, (counted) ? (source.get()) : (marker)));
+					Value &member = (*result.data.objectValue)[name];
+
+					if (type != 0) {
+						readItem(source, type, member, depth + 1);
+
+					} else {
+						read(source, member, depth + 1);
+					}
+				}
+
+				if (!counted) {
+					marker = source.get();
+				}
+			}
+		}
+
+		/**
+		 * Sets a value to an integer, as a double if it doesn't fit in an
+		 * int.
+		 * @param integer Integer to set.
+		 * @param result Value replaced by the integer.
+		 */
+		static void setInteger(int64_t integer, Value &result) {
+			if (integer >= INT_MIN && integer <= INT_MAX) {
+				result.setInteger(static_cast<int>(integer));
+
+			} else {
+				result.setDouble(static_cast<double>(integer));
+			}
+		}
+	};
+
+	void Value::loadFromUbjson(std::istream &input, bool typedArrays) {
+		StreamSource source(input);
+		UbjsonReader::read(source, *this);
+
+		if (!typedArrays) {
+			convertTypedArrays();
+		}
+	}
+
+	void Value::loadFromUbjson(const char *data, size_t size, bool typedArrays) {
+		MemorySource source(data, size);
+		UbjsonReader::read(source, *this);
+
+		if (!typedArrays) {
+			convertTypedArrays();
+		}
+	}
+
+	void Value::writeUbjson(std::ostream &output) const {
+		StreamSink sink(output);
+		writeUbjsonValue(sink, *this);
+	}
+
+	void Value::writeUbjson(std::string &buffer) const {
+		StringSink sink(buffer);
+		writeUbjsonValue(sink, *this);
+	}
+}
@@ -0,0 +1,594 @@
+#include <JsonBox/Validator.h>
+
+#include <streambuf>
+#include <vector>
+#include <stdint.h>
+
+#include <JsonBox/Grammar.h>
+
+namespace JsonBox {
+	namespace {
+		/// Returned by the readers at the end of the JSON.
+		const int END = -1;
+
+		/**
+		 * Reads the characters of a JSON document in a block of memory.
+		 */
+		class MemoryReader {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param data Pointer to the first byte of the JSON.
+			 * @param size Number of bytes of the JSON.
+			 */
+			MemoryReader(const char *data, size_t size) : begin(data),
+				current(data), end(data + size) {
+			}
+
+			/**
+			 * Gets the current character without moving to the next one.
+			 * @return Current byte, from 0 to 255, or END.
+			 */
+			int peek() const {
+				return (current != end) ? (static_cast<unsigned char>(*current)) : (END);
+			}
+
+			/**
+			 * Moves to the next character.
+			 */
+			void next() {
+				++current;
+			}
+
+			/**
+			 * Gets the position of the current character.
+			 * @return Offset of the current byte.
+			 */
+			size_t getPosition() const {
+				return static_cast<size_t>(current - begin);
+			}
+
+		private:
+			/// Pointer to the first byte of the JSON.
+			const char *begin;
+
+			/// Pointer to the current byte.
+			const char *current;
+
+			/// Pointer past the last byte of the JSON.
+			const char *end;
+		};
+
+		/**
+		 * Reads the characters of a JSON document from a streambuf.
+		 */
+		class StreamReader {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param newBuffer Streambuf to read the JSON from.
+			 */
+			explicit StreamReader(std::streambuf &newBuffer) : buffer(newBuffer),
+				position(0) {
+			}
+
+			/**
+			 * Gets the current character without moving to the next one.
+			 * @return Current byte, from 0 to 255, or END.
+			 */
+			int peek() {
+				std::streambuf::int_type character = buffer.sgetc();
+				return (character != std::streambuf::traits_type::eof()) ? (static_cast<unsigned char>(character)) : (END);
+			}
+
+			/**
+			 * Moves to the next character.
+			 */
+			void next() {
+				buffer.sbumpc();
+				++position;
+			}
+
+			/**
+			 * Gets the position of the current character.
+			 * @return Number of bytes read before the current one.
+			 */
+			size_t getPosition() const {
+				return position;
+			}
+
+		private:
+			/// Streambuf the JSON is read from.
+			std::streambuf &buffer;
+
+			/// Number of bytes read.
+			size_t position;
+		};
+
+		/**
+		 * Checks the syntax of a JSON document read by a reader. The
+		 * containers are tracked with a stack of bits instead of recursion,
+		 * so nothing is allocated up to MAXIMUM_VALIDATION_DEPTH.
+		 * @tparam Reader Either MemoryReader or StreamReader.
+		 */
+		template <typename Reader>
+		class Validator {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param newReader Reader of the JSON to validate.
+			 * @param newMaximumDepth Maximum nesting depth of the arrays and
+			 * objects.
+			 */
+			Validator(Reader &newReader, unsigned int newMaximumDepth) :
+				reader(newReader), depth(0), maximumDepth(newMaximumDepth),
+				deepContainers((newMaximumDepth > MAXIMUM_VALIDATION_DEPTH) ? (newMaximumDepth / 32 + 1) : (0)),
+				containers((deepContainers.empty()) ? (fixedContainers) : (&deepContainers[0])),
+				line(1), lineStart(0), result() {
+			}
+
+			/**
+			 * Validates the whole document.
+			 * @return Result of the validation.
+			 */
+			ValidationResult validate() {
+				bool expectingValue = true;
+				skipWhitespace();
+
+				while (result.valid) {
+					if (expectingValue) {
+						expectingValue = readValue();
+
+					} else {
+						expectingValue = readSeparator();
+
+						if (depth == 0 && result.valid) {
+							if (reader.peek() != END) {
+								fail(ValidationResult::TRAILING_CHARACTERS, "Invalid characters found after the JSON value.");
+							}
+
+							break;
+						}
+					}
+				}
+
+				return result;
+			}
+
+		private:
+			/**
+			 * Reads a value, or only the opening bracket of an object or an
+			 * array.
+			 * @return True if a value is expected next, which happens after
+			 * the opening of a non-empty array or object.
+			 */
+			bool readValue() {
+				int character = reader.peek();
+				bool expectingValue = false;
+
+				if (character == Structural::BEGIN_OBJECT || character == Structural::BEGIN_ARRAY) {
+					bool isObject = (character == Structural::BEGIN_OBJECT);
+					reader.next();
+					skipWhitespace();
+
+					// Empty containers count toward the depth, like they do
+					// for the parser.
+					if (push(isObject)) {
+						if (reader.peek() == ((isObject) ? (Structural::END_OBJECT) : (Structural::END_ARRAY))) {
+							reader.next();
+							skipWhitespace();
+							--depth;
+
+						} else {
+							expectingValue = !isObject || readMemberName();
+						}
+					}
+
+				} else {
+					if (character == Structural::BEGIN_END_STRING) {
+						readString();
+
+					} else if (character == Numbers::MINUS || (character >= '0' && character <= '9')) {
+						readNumber();
+
+					} else if (character == Literals::TRUE_STRING[0]) {
+						readLiteral(Literals::TRUE_STRING);
+
+					} else if (character == Literals::FALSE_STRING[0]) {
+						readLiteral(Literals::FALSE_STRING);
+
+					} else if (character == Literals::NULL_STRING[0]) {
+						readLiteral(Literals::NULL_STRING);
+
+					} else if (character == END) {
+						fail(ValidationResult::UNEXPECTED_END, "JSON ends where a value was expected.");
+
+					} else {
+						fail(ValidationResult::UNEXPECTED_CHARACTER, "Invalid character found where a value was expected.");
+					}
+
+					skipWhitespace();
+				}
+
+				return expectingValue;
+			}
+
+			/**
+			 * Reads what follows a value: a value separator, or the end of
+			 * the containers that end after it.
+			 * @return True if a value is expected next.
+			 */
+			bool readSeparator() {
+				bool expectingValue = false;
+
+				while (depth > 0 && !expectingValue && result.valid) {
+					int character = reader.peek();
+					bool isObject = isInObject();
+
+					if (character == Structural::VALUE_SEPARATOR) {
+						reader.next();
+						skipWhitespace();
+						expectingValue = !isObject || readMemberName();
+
+					} else if (character == ((isObject) ? (Structural::END_OBJECT) : (Structural::END_ARRAY))) {
+						reader.next();
+						skipWhitespace();
+						--depth;
+
+					} else {
+						fail(getUnexpectedError(character), "Expected a value separator or the end of the container.");
+					}
+				}
+
+				return expectingValue;
+			}
+
+			/**
+			 * Reads an object member's name and the name separator after it.
+			 * @return True if the name was valid.
+			 */
+			bool readMemberName() {
+				if (reader.peek() != Structural::BEGIN_END_STRING) {
+					return fail(getUnexpectedError(reader.peek()), "Expected an object member's name.");
+
+				} else if (readString()) {
+					skipWhitespace();
+
+					if (reader.peek() != Structural::NAME_SEPARATOR) {
+						return fail(getUnexpectedError(reader.peek()), "Expected a name separator.");
+					}
+
+					reader.next();
+					skipWhitespace();
+				}
+
+				return result.valid;
+			}
+
+			/**
+			 * Reads a string, checking its escape sequences and its UTF-8.
+			 * @return True if the string was valid.
+			 */
+			bool readString() {
+				reader.next();
+
+				for (;;) {
+					int character = reader.peek();
+
+					if (character == Structural::BEGIN_END_STRING) {
+						reader.next();
+						return true;
+
+					} else if (character == END) {
+						return fail(ValidationResult::UNEXPECTED_END, "JSON ends in the middle of a string.");
+
+					} else if (character < 0x20) {
+						return fail(ValidationResult::INVALID_STRING, "Invalid control character found in a string.");
+
+					} else if (character == Strings::Json::Escape::BEGIN_ESCAPE) {
+						reader.next();
+						character = reader.peek();
+
+						if (character == Strings::Json::Escape::BEGIN_UNICODE) {
+							reader.next();
+
+							for (unsigned int i = 0; i < 4; ++i) {
+								if (!isHexDigit(reader.peek())) {
+									return fail(ValidationResult::INVALID_ESCAPE, "Invalid escape sequence found.");
+								}
+
+								reader.next();
+							}
+
+						} else if (character == Strings::Json::Escape::QUOTATION_MARK ||
+						           character == Strings::Json::Escape::REVERSE_SOLIDUS ||
+						           character == Strings::Json::Escape::SOLIDUS ||
+						           character == Strings::Json::Escape::BACKSPACE ||
+						           character == Strings::Json::Escape::FORM_FEED ||
+						           character == Strings::Json::Escape::LINE_FEED ||
+						           character == Strings::Json::Escape::CARRIAGE_RETURN ||
+						           character == Strings::Json::Escape::TAB) {
+							reader.next();
+
+						} else {
+							return fail(ValidationResult::INVALID_ESCAPE, "Invalid escape sequence found.");
+						}
+
+					} else if (character < 0x80) {
+						reader.next();
+
+					} else if (!readMultiByteCharacter(character)) {
+						return false;
+					}
+				}
+			}
+
+			/**
+			 * Reads a character encoded on several bytes in UTF-8, rejecting
+			 * overlong encodings, surrogates and code points past U+10FFFF.
+			 * @param character First byte of the character.
+			 * @return True if the character was valid.
+			 */
+			bool readMultiByteCharacter(int character) {
+				unsigned int continuationCount;
+				int minimum = 0x80, maximum = 0xbf;
+
+				if (character >= 0xc2 && character <= 0xdf) {
+					continuationCount = 1;
+
+				} else if (character == 0xe0) {
+					continuationCount = 2;
+					minimum = 0xa0;
+
+				} else if (character == 0xed) {
+					continuationCount = 2;
+					maximum = 0x9f;
+
+				} else if (character >= 0xe1 && character <= 0xef) {
+					continuationCount = 2;
+
+				} else if (character == 0xf0) {
+					continuationCount = 3;
+					minimum = 0x90;
+
+				} else if (character == 0xf4) {
+					continuationCount = 3;
+					maximum = 0x8f;
+
+				} else if (character >= 0xf1 && character <= 0xf3) {
+					continuationCount = 3;
+
+				} else {
+					return fail(ValidationResult::INVALID_UTF8, "Invalid UTF-8 sequence found.");
+				}
+
+				reader.next();
+
+				for (unsigned int i = 0; i < continuationCount; ++i) {
+					character = reader.peek();
+
+					if (character < minimum || character > maximum) {
+						return fail(ValidationResult::INVALID_UTF8, "Invalid UTF-8 sequence found.");
+					}
+
+					reader.next();
+					minimum = 0x80;
+					maximum = 0xbf;
+				}
+
+				return true;
+			}
+
+			/**
+			 * Reads a number.
+			 * @return True if the number was valid.
+			 */
+			bool readNumber() {
+				if (reader.peek() == Numbers::MINUS) {
+					reader.next();
+				}
+
+				if (reader.peek() == '0') {
+					reader.next();
+
+				} else if (!readDigits()) {
+					return false;
+				}
+
+				if (reader.peek() == '.') {
+					reader.next();
+
+					if (!readDigits()) {
+						return false;
+					}
+				}
+
+				if (reader.peek() == 'e' || reader.peek() == 'E') {
+					reader.next();
+
+					if (reader.peek() == '+' || reader.peek() == Numbers::MINUS) {
+						reader.next();
+					}
+
+					if (!readDigits()) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			/**
+			 * Reads one or more digits.
+			 * @return True if there was at least one digit.
+			 */
+			bool readDigits() {
+				if (!isDigit(reader.peek())) {
+					return fail(ValidationResult::INVALID_NUMBER, "Invalid number found.");
+				}
+
+				do {
+					reader.next();
+				} while (isDigit(reader.peek()));
+
+				return true;
+			}
+
+			/**
+			 * Reads a literal.
+			 * @param literal Expected literal.
+			 * @return True if the literal was found.
+			 */
+			bool readLiteral(const std::string &literal) {
+				for (std::string::const_iterator i = literal.begin(); i != literal.end(); ++i) {
+					if (reader.peek() != static_cast<unsigned char>(*i)) {
+						return fail(ValidationResult::INVALID_LITERAL, "Invalid literal found.");
+					}
+
+					reader.next();
+				}
+
+				return true;
+			}
+
+			/**
+			 * Skips the whitespace at the current position.
+			 */
+			void skipWhitespace() {
+				int character = reader.peek();
+
+				while (hasClass(character, CharacterClass::WHITESPACE)) {
+					reader.next();
+
+					// Line feeds can only be found in whitespace, strings
+					// can't contain them unescaped.
+					if (character == Whitespace::NEW_LINE) {
+						++line;
+						lineStart = reader.getPosition();
+					}
+
+					character = reader.peek();
+				}
+			}
+
+			/**
+			 * Enters an object or an array.
+			 * @param isObject True for an object, false for an array.
+			 * @return True if the maximum depth wasn't exceeded.
+			 */
+			bool push(bool isObject) {
+				if (depth == maximumDepth) {
+					return fail(ValidationResult::TOO_DEEP, "Arrays and objects are nested too deeply.");
+				}
+
+				if (isObject) {
+					containers[depth / 32] |= (static_cast<uint32_t>(1) << (depth % 32));
+
+				} else {
+					containers[depth / 32] &= ~(static_cast<uint32_t>(1) << (depth % 32));
+				}
+
+				++depth;
+				return true;
+			}
+
+			/**
+			 * Checks if the innermost container is an object.
+			 * @return True for an object, false for an array.
+			 */
+			bool isInObject() const {
+				return (containers[(depth - 1) / 32] & (static_cast<uint32_t>(1) << ((depth - 1) % 32))) != 0;
+			}
+
+			/**
+			 * Records an error at the current position.
+			 * @param error Kind of error found.
+			 * @param message Static string describing the error.
+			 * @return Always false.
+			 */
+			bool fail(ValidationResult::Error error, const char *message) {
+				result.valid = false;
+				result.error = error;
+				result.position = reader.getPosition();
+				result.line = line;
+				result.column = result.position - lineStart + 1;
+				result.message = message;
+				return false;
+			}
+
+			/**
+			 * Gets the kind of error of a character found where another one
+			 * was expected.
+			 * @param character Character found.
+			 * @return UNEXPECTED_END at the end of the JSON,
+			 * UNEXPECTED_CHARACTER otherwise.
+			 */
+			static ValidationResult::Error getUnexpectedError(int character) {
+				return (character == END) ? (ValidationResult::UNEXPECTED_END) : (ValidationResult::UNEXPECTED_CHARACTER);
+			}
+
+			/**
+			 * Checks if a character read belongs to one of several classes.
+			 * @param character Character read, or END.
+			 * @param classes Combination of CharacterClass flags.
+			 * @return True if the character is in one of the classes.
+			 */
+			static bool hasClass(int character, unsigned char classes) {
+				return character != END && (CHARACTER_CLASSES[character] & classes) != 0;
+			}
+
+			static bool isDigit(int character) {
+				return hasClass(character, CharacterClass::DIGIT);
+			}
+
+			static bool isHexDigit(int character) {
+				return hasClass(character, CharacterClass::HEX_DIGIT);
+			}
+
+			/// Reader of the JSON.
+			Reader &reader;
+
+			/// Number of containers the current position is in.
+			unsigned int depth;
+
+			/// Maximum nesting depth of the arrays and objects.
+			unsigned int maximumDepth;
+
+			/// Stack of the containers, a set bit for an object, when it
+			/// doesn't fit in fixedContainers.
+			std::vector<uint32_t> deepContainers;
+
+			/// Stack of the containers, a set bit for an object, for the
+			/// default maximum depth.
+			uint32_t fixedContainers[MAXIMUM_VALIDATION_DEPTH / 32];
+
+			/// Stack of the containers used, either fixedContainers or
+			/// deepContainers.
+			uint32_t *containers;
+
+			/// Current line, starting at 1.
+			size_t line;
+
+			/// Position of the first byte of the current line.
+			size_t lineStart;
+
+			/// Result of the validation so far.
+			ValidationResult result;
+		};
+	}
+
+	ValidationResult::ValidationResult() : valid(true), error(VALID),
+		position(0), line(0), column(0), message(NULL) {
+	}
+
+	ValidationResult validate(const char *json, size_t size,
+	                          unsigned int maximumDepth) {
+		MemoryReader reader(json, size);
+		return Validator<MemoryReader>(reader, maximumDepth).validate();
+	}
+
+	ValidationResult validate(std::istream &input, unsigned int maximumDepth) {
+		StreamReader reader(*input.rdbuf());
+		return Validator<StreamReader>(reader, maximumDepth).validate();
+	}
+}
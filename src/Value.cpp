@@ -1,20 +1,32 @@
 #include <JsonBox/Value.h>
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <stack>
 #include <sstream>
 #include <list>
 #include <iomanip>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
+#include <streambuf>
 
+#include <JsonBox/CompressedStream.h>
 #include <JsonBox/Grammar.h>
 #include <JsonBox/Convert.h>
-#include <JsonBox/OutputFilter.h>
-#include <JsonBox/Indenter.h>
-#include <JsonBox/IndentCanceller.h>
-#include <JsonBox/SolidusEscaper.h>
+#include <JsonBox/Writer.h>
+#include <JsonBox/ParallelWriter.h>
 #include <JsonBox/JsonParsingError.h>
+#include <JsonBox/Parser.h>
+#include <JsonBox/TranscodingStream.h>
 #include <JsonBox/JsonWritingError.h>
 
 namespace JsonBox {
@@ -61,82 +73,326 @@ namespace JsonBox {
 	 */
 	static const bool EMPTY_BOOL = false;
 
-	std::string Value::escapeMinimumCharacters(const std::string &str) {
-		std::stringstream result;
+	/**
+	 * Makes a view of a typed array's numbers.
+	 * @param numbers Vector containing the numbers.
+	 * @return View of the vector's numbers.
+	 */
+	template <typename T, typename Vector>
+	static NumericSpan<T> makeSpan(Vector &numbers) {
+		return NumericSpan<T>(numbers.empty() ? NULL : &numbers[0], numbers.size());
+	}
+
+	/**
+	 * Makes a value from a typed array's number.
+	 * @param number Number to put in the value.
+	 * @return Integer value.
+	 */
+	static Value makeNumberValue(int32_t number) {
+		return Value(static_cast<int>(number));
+	}
+
+	/**
+	 * Makes a value from a typed array's number.
+	 * @param number Number to put in the value.
+	 * @return Integer value, or double value if the number doesn't fit in an
+	 * int.
+	 */
+	static Value makeNumberValue(int64_t number) {
+		return (number >= INT_MIN && number <= INT_MAX) ? (Value(static_cast<int>(number))) : (Value(static_cast<double>(number)));
+	}
 
-		// For each character in the string.
-		for (std::string::const_iterator i = str.begin(); i != str.end(); ++i) {
-			if (*i == Strings::Std::QUOTATION_MARK) {
-				result << Strings::Json::QUOTATION_MARK;
+	/**
+	 * Makes a value from a typed array's number.
+	 * @param number Number to put in the value.
+	 * @return Double value.
+	 */
+	static Value makeNumberValue(double number) {
+		return Value(number);
+	}
 
-			} else if (*i == Strings::Std::REVERSE_SOLIDUS) {
-				result << Strings::Json::REVERSE_SOLIDUS;
+	/**
+	 * Makes generic array elements from a typed array's numbers.
+	 * @param numbers Numbers to copy.
+	 * @param result Array receiving a value per number.
+	 */
+	template <typename T>
+	static void copyToValues(const std::vector<T> &numbers, Array &result) {
+		result.reserve(numbers.size());
 
-			} else if (*i == Strings::Std::BACKSPACE) {
-				result << Strings::Json::BACKSPACE;
+		for (typename std::vector<T>::const_iterator i = numbers.begin(); i != numbers.end(); ++i) {
+			result.push_back(makeNumberValue(*i));
+		}
+	}
 
-			} else if (*i == Strings::Std::FORM_FEED) {
-				result << Strings::Json::FORM_FEED;
+	/**
+	 * Widens a typed array's number to the type it is converted from.
+	 * @param number Number to widen.
+	 * @return Same number.
+	 */
+	static int64_t widenNumber(int32_t number) {
+		return number;
+	}
 
-			} else if (*i == Strings::Std::LINE_FEED) {
-				result << Strings::Json::LINE_FEED;
+	static int64_t widenNumber(int64_t number) {
+		return number;
+	}
 
-			} else if (*i == Strings::Std::CARRIAGE_RETURN) {
-				result << Strings::Json::CARRIAGE_RETURN;
+	static double widenNumber(float number) {
+		return number;
+	}
 
-			} else if (*i == Strings::Std::TAB) {
-				result << Strings::Json::TAB;
+	static double widenNumber(double number) {
+		return number;
+	}
 
-			} else if (*i >= '\0' && *i <= '\x1f') {
-				result << Value::escapeToUnicode(*i);
+	/**
+	 * Converts a number to a typed array's number type.
+	 * @param number Number to convert.
+	 * @param result Receives the converted number.
+	 * @return True if the number was converted, false if it doesn't fit in
+	 * the type or if it isn't an integer while the type is.
+	 */
+	static bool convertNumber(int64_t number, int32_t &result) {
+		result = static_cast<int32_t>(number);
+		return number >= INT32_MIN && number <= INT32_MAX;
+	}
 
-			} else {
-				result << *i;
-			}
+	static bool convertNumber(double number, int32_t &result) {
+		bool converted = number >= INT32_MIN && number <= INT32_MAX && number == std::floor(number);
+		result = (converted) ? (static_cast<int32_t>(number)) : (0);
+		return converted;
+	}
+
+	static bool convertNumber(int64_t number, int64_t &result) {
+		result = number;
+		return true;
+	}
+
+	static bool convertNumber(double number, int64_t &result) {
+		// 2^63 is exactly representable, unlike INT64_MAX.
+		bool converted = number >= -9223372036854775808.0 && number < 9223372036854775808.0 && number == std::floor(number);
+		result = (converted) ? (static_cast<int64_t>(number)) : (0);
+		return converted;
+	}
+
+	static bool convertNumber(int64_t number, float &result) {
+		result = static_cast<float>(number);
+		return true;
+	}
+
+	static bool convertNumber(double number, float &result) {
+		result = static_cast<float>(number);
+		return true;
+	}
+
+	static bool convertNumber(int64_t number, double &result) {
+		result = static_cast<double>(number);
+		return true;
+	}
+
+	static bool convertNumber(double number, double &result) {
+		result = number;
+		return true;
+	}
+
+	/**
+	 * Checks if a number read by the parser is written back with the text
+	 * it was read from, so a typed array can store it without losing
+	 * anything.
+	 * @param text JSON text the number was read from.
+	 * @param number Number converted from the text.
+	 * @return True if the writers output the number as the same text.
+	 */
+	static bool isWrittenAs(const char *text, int number) {
+		char formatted[16];
+		std::snprintf(formatted, sizeof(formatted), "%d", number);
+		return std::strcmp(text, formatted) == 0;
+	}
+
+	static bool isWrittenAs(const char *text, double number) {
+		char formatted[32];
+		std::snprintf(formatted, sizeof(formatted), "%.17g", number);
+
+		// printf uses the C locale's decimal point, the writers always use
+		// a period.
+		char *point = std::strchr(formatted, *std::localeconv()->decimal_point);
+
+		if (point) {
+			*point = '.';
 		}
 
-		return result.str();
+		return std::strcmp(text, formatted) == 0;
 	}
 
-	std::string Value::escapeAllCharacters(const std::string &str) {
-		std::stringstream result;
+	/**
+	 * Converts the JSON text of an integer read by the parser, saturating
+	 * at the limits of an int.
+	 * @param text Null-terminated JSON text of the integer.
+	 * @return Integer converted from the text.
+	 */
+	static int readInteger(const char *text) {
+		long long number = std::strtoll(text, NULL, 10);
+		return (number < INT_MIN) ? (INT_MIN) : ((number > INT_MAX) ? (INT_MAX) : (static_cast<int>(number)));
+	}
+
+	/**
+	 * Converts the JSON text of a double read by the parser, saturating at
+	 * the largest finite doubles.
+	 * @param text Null-terminated JSON text of the double.
+	 * @return Double converted from the text.
+	 */
+	static double readDouble(const char *text) {
+		// strtod expects the C locale's decimal point, JSON always uses a
+		// period.
+		const char *decimalPoint = std::localeconv()->decimal_point;
+		double number;
+		const char *point = std::strchr(text, '.');
+
+		if (!point || std::strcmp(decimalPoint, ".") == 0) {
+			number = std::strtod(text, NULL);
+
+		} else {
+			std::string localized(text);
+			localized.replace(point - text, 1, decimalPoint);
+			number = std::strtod(localized.c_str(), NULL);
+		}
 
-		// For each character in the string.
-		for (std::string::const_iterator i = str.begin(); i != str.end(); ++i) {
-			if (*i == Strings::Std::QUOTATION_MARK) {
-				result << Strings::Json::QUOTATION_MARK;
+		return (number > std::numeric_limits<double>::max()) ? (std::numeric_limits<double>::max()) : ((number < -std::numeric_limits<double>::max()) ? (-std::numeric_limits<double>::max()) : (number));
+	}
+
+	/// Lock under which the strings read by the parser are unescaped.
+	static std::mutex unescapingMutex;
+
+	/**
+	 * Converts a typed array's numbers to another type.
+	 * @param numbers Numbers to convert.
+	 * @param result Vector receiving the converted numbers.
+	 * @return True if all the numbers were converted.
+	 */
+	template <typename Source, typename T>
+	static bool convertNumbers(const std::vector<Source> &numbers,
+	                           std::vector<T> &result) {
+		bool converted = true;
+		result.resize(numbers.size());
+
+		for (size_t i = 0; converted && i < numbers.size(); ++i) {
+			converted = convertNumber(widenNumber(numbers[i]), result[i]);
+		}
+
+		return converted;
+	}
 
-			} else if (*i == Strings::Std::REVERSE_SOLIDUS) {
-				result << Strings::Json::REVERSE_SOLIDUS;
+	/**
+	 * Finds the end of an object or an array without parsing it, by matching
+	 * its brackets. The brackets inside strings are ignored.
+	 * @param document JSON document containing the container.
+	 * @param position Offset of the container's opening bracket.
+	 * @return Offset following the container's closing bracket, or the
+	 * document's size if the container isn't closed.
+	 */
+	static size_t skipContainer(const std::string &document, size_t position) {
+		size_t level = 0;
 
-			} else if (*i == Strings::Std::SOLIDUS) {
-				result << Strings::Json::SOLIDUS;
+		do {
+			char character = document[position++];
 
-			} else if (*i == Strings::Std::BACKSPACE) {
-				result << Strings::Json::BACKSPACE;
+			if (character == Structural::BEGIN_END_STRING) {
+				while (position < document.size() && document[position] != Structural::BEGIN_END_STRING) {
+					position += (document[position] == Strings::Json::Escape::BEGIN_ESCAPE) ? (2) : (1);
+				}
 
-			} else if (*i == Strings::Std::FORM_FEED) {
-				result << Strings::Json::FORM_FEED;
+				++position;
 
-			} else if (*i == Strings::Std::LINE_FEED) {
-				result << Strings::Json::LINE_FEED;
+			} else if (character == Structural::BEGIN_OBJECT || character == Structural::BEGIN_ARRAY) {
+				++level;
 
-			} else if (*i == Strings::Std::CARRIAGE_RETURN) {
-				result << Strings::Json::CARRIAGE_RETURN;
+			} else if (character == Structural::END_OBJECT || character == Structural::END_ARRAY) {
+				--level;
+			}
+		} while (level > 0 && position < document.size());
+
+		return std::min(position, document.size());
+	}
+
+	namespace {
+		/**
+		 * Read-only streambuf over a JSON document loaded lazily. Supports
+		 * seeking, so the parser can jump over the nested containers.
+		 */
+		class DocumentStreambuf : public std::streambuf {
+		public:
+			/**
+			 * Parameterized constructor.
+			 * @param document JSON document to read.
+			 * @param position Offset of the first character to read.
+			 */
+			DocumentStreambuf(const std::string &document, size_t position) {
+				char *begin = const_cast<char *>(document.data());
+				setg(begin, begin + position, begin + document.size());
+			}
 
-			} else if (*i == Strings::Std::TAB) {
-				result << Strings::Json::TAB;
+		protected:
+			virtual pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+			                         std::ios_base::openmode mode) {
+				if (direction == std::ios_base::cur) {
+					offset += gptr() - eback();
 
-			} else if (*i >= '\0' && *i <= '\x1f') {
-				result << Value::escapeToUnicode(*i);
+				} else if (direction == std::ios_base::end) {
+					offset += egptr() - eback();
+				}
 
-			} else {
-				result << *i;
+				return seekpos(pos_type(offset), mode);
 			}
 
+			virtual pos_type seekpos(pos_type position, std::ios_base::openmode /*mode*/) {
+				off_type offset = position;
+
+				if (offset < 0 || offset > egptr() - eback()) {
+					return pos_type(off_type(-1));
+				}
+
+				setg(eback(), eback() + offset, egptr());
+				return position;
+			}
+		};
+
+		/**
+		 * Escapes the characters of a string belonging to a class.
+		 * @param str String to escape.
+		 * @param escapedClass CharacterClass of the characters to escape.
+		 * @return Escaped string.
+		 */
+		std::string escapeCharacters(const std::string &str,
+		                             unsigned char escapedClass) {
+			std::string result;
+			char sequence[6];
+			const char *run = str.data();
+			const char *end = run + str.size();
+
+			result.reserve(str.size());
+
+			// The runs of characters that don't need escaping are appended
+			// at once.
+			for (const char *i = run; i != end; ++i) {
+				if (isCharacterClass(*i, escapedClass)) {
+					result.append(run, i);
+					result.append(sequence, getEscapeSequence(*i, sequence));
+					run = i + 1;
+				}
+			}
+
+			result.append(run, end);
+			return result;
 		}
+	}
 
-		return result.str();
+	std::string Value::escapeMinimumCharacters(const std::string &str) {
+		return escapeCharacters(str, CharacterClass::ESCAPED);
+	}
+
+	std::string Value::escapeAllCharacters(const std::string &str) {
+		return escapeCharacters(str, CharacterClass::ESCAPED_ALL);
 	}
 
 
@@ -151,67 +407,78 @@ namespace JsonBox {
 		return result.str();
 	}
 
-	Value::Value() : type(NULL_VALUE), data() {
+	Value::Value() : type(NULL_VALUE), arrayStorage(GENERIC_ARRAY), data(), extension(NULL) {
 	}
 
-	Value::Value(std::istream &input) : type(NULL_VALUE), data() {
+	Value::Value(std::istream &input) : type(NULL_VALUE), arrayStorage(GENERIC_ARRAY), data(),
+		extension(NULL) {
 		loadFromStream(input);
 	}
 
-	Value::Value(const std::string &newString) : type(STRING),
-		data(new std::string(newString)) {
+	Value::Value(const std::string &newString) : type(STRING), arrayStorage(GENERIC_ARRAY),
+		data(new String(newString)),
+		extension(NULL) {
 	}
 
-	Value::Value(const char *newCString) : type(STRING),
-		data(new std::string(newCString)) {
+	Value::Value(const char *newCString) : type(STRING), arrayStorage(GENERIC_ARRAY),
+		data(new String(newCString)),
+		extension(NULL) {
 	}
 
-	Value::Value(int newInt) : type(INTEGER), data(new int(newInt)) {
+	Value::Value(int newInt) : type(INTEGER), arrayStorage(GENERIC_ARRAY), data(new Number(newInt)),
+		extension(NULL) {
 	}
 
-	Value::Value(double newDouble) : type(DOUBLE), data(new double(newDouble)) {
+	Value::Value(double newDouble) : type(DOUBLE), arrayStorage(GENERIC_ARRAY), data(new Number(newDouble)),
+		extension(NULL) {
 	}
 
-	Value::Value(const Object &newObject) : type(OBJECT),
-		data(new Object(newObject)) {
+	Value::Value(const Object &newObject) : type(OBJECT), arrayStorage(GENERIC_ARRAY),
+		data(new Object(newObject)),
+		extension(NULL) {
 	}
 
-	Value::Value(const Array &newArray) : type(ARRAY),
-		data(new Array(newArray)) {
+	Value::Value(const Array &newArray) : type(ARRAY), arrayStorage(GENERIC_ARRAY),
+		data(new Array(newArray)),
+		extension(NULL) {
 	}
 
-	Value::Value(bool newBoolean) : type(BOOLEAN), data(new bool(newBoolean)) {
+	Value::Value(bool newBoolean) : type(BOOLEAN), arrayStorage(GENERIC_ARRAY), data(new bool(newBoolean)),
+		extension(NULL) {
 	}
 
-	Value::Value(const Value &src) : type(src.type), data() {
-		switch (type) {
-		case STRING:
-			data.stringValue = new std::string(*src.data.stringValue);
-			break;
+	Value::Value(const Value &src) : type(src.type), arrayStorage(GENERIC_ARRAY), data(), extension(NULL) {
+		if (!copyLazyContainer(src)) {
+			switch (type) {
+			case STRING:
+				data.stringValue = copyString(src.data.stringValue);
+				break;
 
-		case INTEGER:
-			data.intValue = new int(*src.data.intValue);
-			break;
+			case RAW_JSON:
+				data.rawJsonValue = new std::string(*src.data.rawJsonValue);
+				break;
 
-		case DOUBLE:
-			data.doubleValue = new double(*src.data.doubleValue);
-			break;
+			case INTEGER:
+			case DOUBLE:
+				data.numberValue = Number::copy(*src.data.numberValue);
+				break;
 
-		case OBJECT:
-			data.objectValue = new Object(*src.data.objectValue);
-			break;
+			case OBJECT:
+				data.objectValue = new Object(*src.data.objectValue);
+				break;
 
-		case ARRAY:
-			data.arrayValue = new Array(*src.data.arrayValue);
-			break;
+			case ARRAY:
+				copyArray(src);
+				break;
 
-		case BOOLEAN:
-			data.boolValue = new bool(*src.data.boolValue);
-			break;
+			case BOOLEAN:
+				data.boolValue = new bool(*src.data.boolValue);
+				break;
 
-		default:
-			type = NULL_VALUE;
-			break;
+			default:
+				type = NULL_VALUE;
+				break;
+			}
 		}
 	}
 
@@ -224,35 +491,38 @@ namespace JsonBox {
 			clear();
 			type = src.type;
 
-			switch (type) {
-			case STRING:
-				data.stringValue = new std::string(*src.data.stringValue);
-				break;
+			if (!copyLazyContainer(src)) {
+				switch (type) {
+				case STRING:
+					data.stringValue = copyString(src.data.stringValue);
+					break;
 
-			case INTEGER:
-				data.intValue = new int(*src.data.intValue);
-				break;
+				case RAW_JSON:
+					data.rawJsonValue = new std::string(*src.data.rawJsonValue);
+					break;
 
-			case DOUBLE:
-				data.doubleValue = new double(*src.data.doubleValue);
-				break;
+				case INTEGER:
+				case DOUBLE:
+					data.numberValue = Number::copy(*src.data.numberValue);
+					break;
 
-			case OBJECT:
-				data.objectValue = new Object(*src.data.objectValue);
-				break;
+				case OBJECT:
+					data.objectValue = new Object(*src.data.objectValue);
+					break;
 
-			case ARRAY:
-				data.arrayValue = new Array(*src.data.arrayValue);
-				break;
+				case ARRAY:
+					copyArray(src);
+					break;
 
-			case BOOLEAN:
-				data.boolValue = new bool(*src.data.boolValue);
-				break;
+				case BOOLEAN:
+					data.boolValue = new bool(*src.data.boolValue);
+					break;
 
-			default:
-				type = NULL_VALUE;
-				data.stringValue = NULL;
-				break;
+				default:
+					type = NULL_VALUE;
+					data.stringValue = NULL;
+					break;
+				}
 			}
 		}
 
@@ -305,18 +575,27 @@ namespace JsonBox {
 		bool result = true;
 
 		if (this != &rhs) {
+			parseLazyContainer();
+			rhs.parseLazyContainer();
+
 			if (type == rhs.type) {
 				switch (type) {
 				case STRING:
-					result = (*data.stringValue == rhs.getString());
+					// Interned strings are compared by address.
+					result = (data.stringValue == rhs.data.stringValue) ||
+					         (getUnescapedString() == rhs.getUnescapedString());
+					break;
+
+				case RAW_JSON:
+					result = (*data.rawJsonValue == *rhs.data.rawJsonValue);
 					break;
 
 				case INTEGER:
-					result = (*data.intValue == rhs.getInteger());
+					result = (getIntegerNumber() == rhs.getInteger());
 					break;
 
 				case DOUBLE:
-					result = (*data.doubleValue == rhs.getDouble());
+					result = (getDoubleNumber() == rhs.getDouble());
 					break;
 
 				case OBJECT:
@@ -324,7 +603,7 @@ namespace JsonBox {
 					break;
 
 				case ARRAY:
-					result = (*data.arrayValue == rhs.getArray());
+					result = isArrayEqual(rhs);
 					break;
 
 				case BOOLEAN:
@@ -351,18 +630,25 @@ namespace JsonBox {
 		bool result = false;
 
 		if (this != &rhs) {
+			parseLazyContainer();
+			rhs.parseLazyContainer();
+
 			if (type == rhs.type) {
 				switch (type) {
 				case STRING:
-					result = (*data.stringValue < rhs.getString());
+					result = (getUnescapedString() < rhs.getUnescapedString());
+					break;
+
+				case RAW_JSON:
+					result = (*data.rawJsonValue < *rhs.data.rawJsonValue);
 					break;
 
 				case INTEGER:
-					result = (*data.intValue < rhs.getInteger());
+					result = (getIntegerNumber() < rhs.getInteger());
 					break;
 
 				case DOUBLE:
-					result = (*data.doubleValue < rhs.getDouble());
+					result = (getDoubleNumber() < rhs.getDouble());
 					break;
 
 				case OBJECT:
@@ -370,7 +656,7 @@ namespace JsonBox {
 					break;
 
 				case ARRAY:
-					result = (*data.arrayValue < rhs.getArray());
+					result = isArrayLess(rhs);
 					break;
 
 				case BOOLEAN:
@@ -400,6 +686,9 @@ namespace JsonBox {
 	}
 
 	Value &Value::operator[](const Object::key_type &key) {
+		discardSerializedForms();
+		parseLazyContainer();
+
 		if (type != OBJECT) {
 			clear();
 			type = OBJECT;
@@ -414,14 +703,21 @@ namespace JsonBox {
 	}
 
 	Value &Value::operator[](Array::size_type index) {
+		discardSerializedForms();
+		parseLazyContainer();
+
 		// We make sure it's an array.
 		if (type != ARRAY) {
 			clear();
 			type = ARRAY;
 			data.arrayValue = new Array(index + 1);
-		} else if (index >= (*data.arrayValue).size()) {
-			// We make sure the array is big enough.
-			data.arrayValue->resize(index + 1);
+		} else {
+			convertToGenericArray();
+
+			if (index >= (*data.arrayValue).size()) {
+				// We make sure the array is big enough.
+				data.arrayValue->resize(index + 1);
+			}
 		}
 
 		return (*data.arrayValue)[index];
@@ -467,29 +763,39 @@ namespace JsonBox {
 		return type == NULL_VALUE;
 	}
 
+	bool Value::isRawJson() const {
+		return type == RAW_JSON;
+	}
+
 	const std::string &Value::getString() const {
 		return tryGetString(EMPTY_STRING);
 	}
 
 	const std::string &Value::tryGetString(const std::string &defaultValue) const {
-		return (type == STRING) ? (*data.stringValue) : (defaultValue);
+		return (type == STRING) ? (getUnescapedString()) : (defaultValue);
 	}
 
 	const std::string Value::getToString() const {
 		if (type == STRING) {
-			return  *data.stringValue;
+			return getUnescapedString();
+
+		} else if (type == RAW_JSON) {
+			return *data.rawJsonValue;
+
+		} else if (getNumberText()) {
+			return getNumberText();
 
 		} else {
 			switch (type) {
 			case INTEGER: {
 					std::stringstream ss;
-					ss << *data.intValue;
+					ss << getIntegerNumber();
 					return ss.str();
 				}
 
 			case DOUBLE: {
 					std::stringstream ss;
-					ss << *data.doubleValue;
+					ss << getDoubleNumber();
 					return ss.str();
 				}
 
@@ -506,13 +812,13 @@ namespace JsonBox {
 	}
 
 	void Value::setString(std::string const &newString) {
-		if (type == STRING) {
-			*data.stringValue = newString;
+		if (type == STRING && data.stringValue->references == 1) {
+			*data.stringValue = String(newString);
 
 		} else {
 			clear();
 			type = STRING;
-			data.stringValue = new std::string(newString);
+			data.stringValue = new String(newString);
 		}
 	}
 
@@ -521,17 +827,20 @@ namespace JsonBox {
 	}
 
 	int Value::tryGetInteger(int defaultValue) const {
-		return (type == INTEGER) ? (*data.intValue) : ((type == DOUBLE) ? (static_cast<int>(*data.doubleValue)) : (defaultValue));
+		return (type == INTEGER) ? (getIntegerNumber()) : ((type == DOUBLE) ? (static_cast<int>(getDoubleNumber())) : (defaultValue));
 	}
 
 	void Value::setInteger(int newInteger) {
-		if (type == INTEGER) {
-			*data.intValue = newInteger;
+		if (type == INTEGER || type == DOUBLE) {
+			type = INTEGER;
+			data.numberValue->value.integerValue = newInteger;
+			data.numberValue->length = 0;
+			data.numberValue->state.store(Number::CONVERTED, std::memory_order_relaxed);
 
 		} else {
 			clear();
 			type = INTEGER;
-			data.intValue = new int(newInteger);
+			data.numberValue = new Number(newInteger);
 		}
 	}
 
@@ -540,7 +849,7 @@ namespace JsonBox {
 	}
 
 	double Value::tryGetDouble(double defaultValue) const {
-		return (type == DOUBLE) ? (*data.doubleValue) : ((type == INTEGER) ? (static_cast<double>(*data.intValue)) : (defaultValue));
+		return (type == DOUBLE) ? (getDoubleNumber()) : ((type == INTEGER) ? (static_cast<double>(getIntegerNumber())) : (defaultValue));
 	}
 
 	float Value::getFloat() const {
@@ -548,26 +857,31 @@ namespace JsonBox {
 	}
 
 	float Value::tryGetFloat(float defaultValue) const {
-		return (type == DOUBLE) ? (static_cast<float>(*data.doubleValue)) : ((type == INTEGER) ? (static_cast<float>(*data.intValue)) : (defaultValue));
+		return (type == DOUBLE) ? (static_cast<float>(getDoubleNumber())) : ((type == INTEGER) ? (static_cast<float>(getIntegerNumber())) : (defaultValue));
 	}
 
 	void Value::setDouble(double newDouble) {
-		if (type == DOUBLE) {
-			*data.doubleValue = newDouble;
+		if (type == INTEGER || type == DOUBLE) {
+			type = DOUBLE;
+			data.numberValue->value.doubleValue = newDouble;
+			data.numberValue->length = 0;
+			data.numberValue->state.store(Number::CONVERTED, std::memory_order_relaxed);
 
 		} else {
 			clear();
 			type = DOUBLE;
-			data.doubleValue = new double(newDouble);
+			data.numberValue = new Number(newDouble);
 		}
 	}
 
 	const Object &Value::getObject() const {
+		parseLazyContainer();
 		return (type == OBJECT) ? (*data.objectValue) : (EMPTY_OBJECT);
 	}
 
 	void Value::setObject(const Object &newObject) {
-		if (type == OBJECT) {
+		if (type == OBJECT && !getLazyContainer()) {
+			discardSerializedForms();
 			*data.objectValue = newObject;
 
 		} else {
@@ -578,11 +892,18 @@ namespace JsonBox {
 	}
 
 	const Array &Value::getArray() const {
+		parseLazyContainer();
+
+		if (type == ARRAY && arrayStorage != GENERIC_ARRAY) {
+			throw std::logic_error("The array uses a typed storage and must be read with its typed accessor.");
+		}
+
 		return (type == ARRAY) ? (*data.arrayValue) : (EMPTY_ARRAY);
 	}
 
 	void Value::setArray(const Array &newArray) {
-		if (type == ARRAY) {
+		if (type == ARRAY && arrayStorage == GENERIC_ARRAY && !getLazyContainer()) {
+			discardSerializedForms();
 			*data.arrayValue = newArray;
 
 		} else {
@@ -592,6 +913,142 @@ namespace JsonBox {
 		}
 	}
 
+	Value::ArrayStorage Value::getArrayStorage() const {
+		parseLazyContainer();
+		return (type == ARRAY) ? (arrayStorage) : (GENERIC_ARRAY);
+	}
+
+	bool Value::setArrayStorage(ArrayStorage newStorage) {
+		bool result = (type == ARRAY);
+		parseLazyContainer();
+
+		if (result && newStorage != arrayStorage) {
+			switch (newStorage) {
+			case INT32_ARRAY: {
+					std::vector<int32_t> numbers;
+					result = copyNumbers(numbers);
+
+					if (result) {
+						setTypedArray(numbers);
+					}
+				}
+				break;
+
+			case INT64_ARRAY: {
+					std::vector<int64_t> numbers;
+					result = copyNumbers(numbers);
+
+					if (result) {
+						setTypedArray(numbers);
+					}
+				}
+				break;
+
+			case FLOAT_ARRAY: {
+					std::vector<float> numbers;
+					result = copyNumbers(numbers);
+
+					if (result) {
+						setTypedArray(numbers);
+					}
+				}
+				break;
+
+			case DOUBLE_ARRAY: {
+					std::vector<double> numbers;
+					result = copyNumbers(numbers);
+
+					if (result) {
+						setTypedArray(numbers);
+					}
+				}
+				break;
+
+			default:
+				convertToGenericArray();
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	NumericSpan<const int32_t> Value::getInt32Array() const {
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == INT32_ARRAY) ? (makeSpan<const int32_t>(*data.int32ArrayValue)) : (NumericSpan<const int32_t>());
+	}
+
+	NumericSpan<int32_t> Value::getInt32Array() {
+		discardSerializedForms();
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == INT32_ARRAY) ? (makeSpan<int32_t>(*data.int32ArrayValue)) : (NumericSpan<int32_t>());
+	}
+
+	NumericSpan<const int64_t> Value::getInt64Array() const {
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == INT64_ARRAY) ? (makeSpan<const int64_t>(*data.int64ArrayValue)) : (NumericSpan<const int64_t>());
+	}
+
+	NumericSpan<int64_t> Value::getInt64Array() {
+		discardSerializedForms();
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == INT64_ARRAY) ? (makeSpan<int64_t>(*data.int64ArrayValue)) : (NumericSpan<int64_t>());
+	}
+
+	NumericSpan<const float> Value::getFloatArray() const {
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == FLOAT_ARRAY) ? (makeSpan<const float>(*data.floatArrayValue)) : (NumericSpan<const float>());
+	}
+
+	NumericSpan<float> Value::getFloatArray() {
+		discardSerializedForms();
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == FLOAT_ARRAY) ? (makeSpan<float>(*data.floatArrayValue)) : (NumericSpan<float>());
+	}
+
+	NumericSpan<const double> Value::getDoubleArray() const {
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == DOUBLE_ARRAY) ? (makeSpan<const double>(*data.doubleArrayValue)) : (NumericSpan<const double>());
+	}
+
+	NumericSpan<double> Value::getDoubleArray() {
+		discardSerializedForms();
+		parseLazyContainer();
+		return (type == ARRAY && arrayStorage == DOUBLE_ARRAY) ? (makeSpan<double>(*data.doubleArrayValue)) : (NumericSpan<double>());
+	}
+
+	void Value::setTypedArray(const std::vector<int32_t> &newArray) {
+		std::vector<int32_t> *numbers = new std::vector<int32_t>(newArray);
+		clear();
+		type = ARRAY;
+		arrayStorage = INT32_ARRAY;
+		data.int32ArrayValue = numbers;
+	}
+
+	void Value::setTypedArray(const std::vector<int64_t> &newArray) {
+		std::vector<int64_t> *numbers = new std::vector<int64_t>(newArray);
+		clear();
+		type = ARRAY;
+		arrayStorage = INT64_ARRAY;
+		data.int64ArrayValue = numbers;
+	}
+
+	void Value::setTypedArray(const std::vector<float> &newArray) {
+		std::vector<float> *numbers = new std::vector<float>(newArray);
+		clear();
+		type = ARRAY;
+		arrayStorage = FLOAT_ARRAY;
+		data.floatArrayValue = numbers;
+	}
+
+	void Value::setTypedArray(const std::vector<double> &newArray) {
+		std::vector<double> *numbers = new std::vector<double>(newArray);
+		clear();
+		type = ARRAY;
+		arrayStorage = DOUBLE_ARRAY;
+		data.doubleArrayValue = numbers;
+	}
+
 	bool Value::getBoolean() const {
 		return tryGetBoolean(EMPTY_BOOL);
 	}
@@ -617,159 +1074,162 @@ namespace JsonBox {
 		data.stringValue = NULL;
 	}
 
+	const std::string &Value::getRawJson() const {
+		return (type == RAW_JSON) ? (*data.rawJsonValue) : (EMPTY_STRING);
+	}
+
+	void Value::setRawJson(const std::string &newRawJson) {
+		if (type == RAW_JSON) {
+			*data.rawJsonValue = newRawJson;
+
+		} else {
+			clear();
+			type = RAW_JSON;
+			data.rawJsonValue = new std::string(newRawJson);
+		}
+	}
+
 	void Value::loadFromString(std::string const &json) {
-		std::stringstream jsonStream(json);
+		// The JSON is read in place instead of being copied in a stream.
+		DocumentStreambuf buffer(json, 0);
+		std::istream jsonStream(&buffer);
 		loadFromStream(jsonStream);
 	}
 
+	void Value::loadFromString(const std::string &json,
+	                           const Projection &projection) {
+		DocumentStreambuf buffer(json, 0);
+		std::istream jsonStream(&buffer);
+		loadFromStream(jsonStream, projection);
+	}
+
 	void Value::loadFromStream(std::istream &input) {
-		char currentCharacter;
+		Parser parser;
+		readDocument(input, NULL, parser);
+	}
 
-		// We check that the stream is in UTF-8.
-		char encoding[2];
-		input.get(encoding[0]);
-		input.get(encoding[1]);
+	void Value::loadFromStream(std::istream &input, const Projection &projection) {
+		Parser parser;
+		readDocument(input, (projection.complete) ? (NULL) : (&projection), parser);
+	}
 
-		if (encoding[0] != '\0' && encoding[1] != '\0') {
-			// We put the characters back.
-			input.putback(encoding[1]);
-			input.putback(encoding[0]);
+	ValidationResult Value::tryLoadFromString(const std::string &json) {
+		Parser parser;
+		return parser.tryParse(json, *this);
+	}
 
-			// Boolean value used to stop reading characters after the value
-			// is done loading.
-			bool reading = true;
+	ValidationResult Value::tryLoadFromStream(std::istream &input) {
+		Parser parser;
+		return parser.tryParse(input, *this);
+	}
 
-			while (reading && input.good()) {
-				input.get(currentCharacter);
+	void Value::readDocument(std::istream &input, const Projection *projection,
+	                         Parser &parser) {
+		// A previous parse may have thrown with containers on the stack.
+		parser.frames.clear();
+		parser.members.clear();
 
-				if (input.good()) {
-					if (currentCharacter == Structural::BEGIN_END_STRING) {
-						// The value to be parsed is a string.
-						setString("");
-						readString(input, *data.stringValue);
-						reading = false;
-
-					} else if (currentCharacter == Structural::BEGIN_OBJECT) {
-						// The value to be parsed is an object.
-						setObject(Object());
-						readObject(input, *data.objectValue);
-						reading = false;
-
-					} else if (currentCharacter == Structural::BEGIN_ARRAY) {
-						// The value to be parsed is an array.
-						setArray(Array());
-						readArray(input, *data.arrayValue);
-						reading = false;
-
-					} else if (currentCharacter == Literals::NULL_STRING[0]) {
-						// We try to read the literal 'null'.
-						if (!input.eof()) {
-							input.get(currentCharacter);
-
-							if (currentCharacter == Literals::NULL_STRING[1]) {
-								if (!input.eof()) {
-									input.get(currentCharacter);
-
-									if (currentCharacter == Literals::NULL_STRING[2]) {
-										if (!input.eof()) {
-											input.get(currentCharacter);
-
-											if (currentCharacter == Literals::NULL_STRING[3]) {
-												setNull();
-												reading = false;
-
-											} else {
-												throw JsonParsingError("Invalid characters found.");
-											}
-
-										} else {
-											throw JsonParsingError("JSON input ends incorrectly.");
-										}
-
-									} else {
-										throw JsonParsingError("Invalid characters found.");
-									}
+		std::streambuf *buffer = input.rdbuf();
+		std::streambuf::int_type character;
+		char bytes[4];
+		size_t size = 0, byteOrderMarkSize;
 
-								} else {
-									throw JsonParsingError("JSON ends incorrectly.");
-								}
+		// We read the first bytes to detect the encoding.
+		while (size < 4 && !std::streambuf::traits_type::eq_int_type(character = buffer->sbumpc(), std::streambuf::traits_type::eof())) {
+			bytes[size++] = std::streambuf::traits_type::to_char_type(character);
+		}
 
-							} else {
-								throw JsonParsingError("Invalid characters found");
-							}
+		Encoding::Format format = Encoding::detect(bytes, size, byteOrderMarkSize);
+		size_t unread = size;
 
-						} else {
-							throw JsonParsingError("JSON input ends incorrectly.");
-						}
+		if (format == Encoding::UTF8) {
+			// We put back the bytes following the byte order mark, so UTF-8
+			// is read straight from the stream.
+			while (unread > byteOrderMarkSize && !std::streambuf::traits_type::eq_int_type(buffer->sputbackc(bytes[unread - 1]), std::streambuf::traits_type::eof())) {
+				--unread;
+			}
+		}
 
-					} else if (currentCharacter == Numbers::MINUS ||
-					           (currentCharacter >= Numbers::DIGITS[0] && currentCharacter <= Numbers::DIGITS[9])) {
-						// Numbers can't start with zeroes.
-						input.putback(currentCharacter);
-						readNumber(input, *this);
-						reading = false;
-
-					} else if (currentCharacter == Literals::TRUE_STRING[0]) {
-						// We try to read the boolean literal 'true'.
-						if (!input.eof()) {
-							input.get(currentCharacter);
-
-							if (currentCharacter == Literals::TRUE_STRING[1]) {
-								if (!input.eof()) {
-									input.get(currentCharacter);
-
-									if (currentCharacter == Literals::TRUE_STRING[2]) {
-										if (!input.eof()) {
-											input.get(currentCharacter);
-
-											if (currentCharacter == Literals::TRUE_STRING[3]) {
-												setBoolean(true);
-												reading = false;
-											}
-										}
-									}
-								}
-							}
-						}
+		if (format == Encoding::UTF8 && unread == byteOrderMarkSize) {
+			readValue(input, projection, parser);
 
-					} else if (currentCharacter == Literals::FALSE_STRING[0]) {
-						// We try to read the boolean literal 'false'.
-						if (!input.eof()) {
-							input.get(currentCharacter);
-
-							if (currentCharacter == Literals::FALSE_STRING[1]) {
-								if (!input.eof()) {
-									input.get(currentCharacter);
-
-									if (currentCharacter == Literals::FALSE_STRING[2]) {
-										if (!input.eof()) {
-											input.get(currentCharacter);
-
-											if (currentCharacter == Literals::FALSE_STRING[3]) {
-												if (!input.eof()) {
-													input.get(currentCharacter);
-
-													if (currentCharacter == Literals::FALSE_STRING[4]) {
-														setBoolean(false);
-														reading = false;
-													}
-												}
-											}
-										}
-									}
-								}
-							}
+		} else {
+			// The other encodings are converted to UTF-8 in blocks, as they
+			// are parsed.
+			TranscodingInputStream transcoded(input, format, std::string(bytes + byteOrderMarkSize, bytes + unread));
+			readValue(transcoded, projection, parser);
+		}
+	}
+
+	bool Value::readValue(std::istream &input, const Projection *projection,
+	                      Parser &parser) {
+		size_t base = parser.frames.size();
+		bool result = beginValue(input, projection, parser);
+
+		if (parser.frames.size() > base) {
+			readContainers(input, NULL, parser, base);
+		}
+
+		return result;
+	}
+
+	bool Value::beginValue(std::istream &input, const Projection *projection,
+	                       Parser &parser) {
+		char currentCharacter;
+
+		// Boolean value used to stop reading characters after the value
+		// is done loading.
+		bool reading = true;
+
+		while (reading && input.good()) {
+			input.get(currentCharacter);
+
+			if (input.good()) {
+				if (currentCharacter == Structural::BEGIN_END_STRING) {
+					// The value to be parsed is a string.
+					// The string is only unescaped when it is accessed.
+					if (parser.maximumInternedSize > 0) {
+						readInternedString(input, parser);
+
+					} else {
+						if (type == STRING && data.stringValue->references == 1) {
+							discardSerializedForms();
+
+						} else {
+							setString("");
 						}
 
-					} else if (!isWhiteSpace(currentCharacter)) {
-						throw JsonParsingError( std::string("Invalid character found: '").append(std::string(1, currentCharacter)).append("'"));
+						readEscapedString(input, *data.stringValue);
 					}
+
+					reading = false;
+
+				} else if (currentCharacter == Structural::BEGIN_OBJECT ||
+				           currentCharacter == Structural::BEGIN_ARRAY) {
+					// The value to be parsed is an object or an array, its
+					// contents are read by readContainers(...).
+					beginContainer(currentCharacter, projection, parser);
+					reading = false;
+
+				} else if (currentCharacter == Literals::NULL_STRING[0] ||
+				           currentCharacter == Literals::TRUE_STRING[0] ||
+				           currentCharacter == Literals::FALSE_STRING[0]) {
+					reading = !readLiteral(input, currentCharacter);
+
+				} else if (currentCharacter == Numbers::MINUS ||
+				           (currentCharacter >= Numbers::DIGITS[0] && currentCharacter <= Numbers::DIGITS[9])) {
+					// Numbers can't start with zeroes.
+					input.putback(currentCharacter);
+					readNumber(input, *this, parser.buffer);
+					reading = false;
+
+				} else if (!isWhiteSpace(currentCharacter)) {
+					throw JsonParsingError( std::string("Invalid character found: '").append(std::string(1, currentCharacter)).append("'"));
 				}
 			}
-
-		} else {
-			throw std::invalid_argument("JSON in input stream is not in UTF-8.");
 		}
+
+		return !reading;
 	}
 
 	void Value::loadFromFile(const std::string &filePath) {
@@ -777,7 +1237,16 @@ namespace JsonBox {
 		file.open(filePath.c_str(), std::ios::binary | std::ios::in);
 
 		if (file.is_open()) {
-			loadFromStream(file);
+			Compression::Format format = Compression::getFormat(filePath);
+
+			if (format != Compression::NONE) {
+				DecompressingInputStream decompressed(file, format);
+				loadFromStream(decompressed);
+
+			} else {
+				loadFromStream(file);
+			}
+
 			file.close();
 
 		} else {
@@ -785,18 +1254,44 @@ namespace JsonBox {
 		}
 	}
 
+	void Value::loadLazilyFromString(const std::string &json) {
+		// The JSON is only copied in the buffer shared by the containers.
+		loadLazilyFromDocument(std::make_shared<std::string>(json));
+	}
+
+	void Value::loadLazilyFromStream(std::istream &input) {
+		// The stream is read straight in the buffer shared by the containers.
+		std::shared_ptr<std::string> document = std::make_shared<std::string>();
+		document->assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+		loadLazilyFromDocument(document);
+	}
+
 	void Value::writeToStream(std::ostream &output, bool indent,
-	                          bool escapeAll) const {
-		this->output(output, indent, escapeAll);
+	                          bool escapeAll, unsigned int threadCount) const {
+		this->output(output, indent, escapeAll, threadCount);
 	}
 
 	void Value::writeToFile(const std::string &filePath, bool indent,
-	                        bool escapeAll) const {
+	                        bool escapeAll, unsigned int threadCount) const {
 		std::ofstream file;
-		file.open(filePath.c_str());
+		Compression::Format format = Compression::getFormat(filePath);
+
+		if (!Compression::isSupported(format)) {
+			throw std::invalid_argument(std::string("JsonBox was built without support for the compression of the following file: ").append(filePath));
+		}
+
+		file.open(filePath.c_str(), (format != Compression::NONE) ? (std::ios::out | std::ios::binary) : (std::ios::out));
 
 		if (file.is_open()) {
-			writeToStream(file, indent, escapeAll);
+			if (format != Compression::NONE) {
+				CompressingOutputStream compressed(file, format);
+				writeToStream(compressed, indent, escapeAll, threadCount);
+				compressed.finish();
+
+			} else {
+				writeToStream(file, indent, escapeAll, threadCount);
+			}
+
 			file.close();
 
 		} else {
@@ -804,463 +1299,1435 @@ namespace JsonBox {
 		}
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(): stringValue(NULL) {
+	Value::LazyContainer::LazyContainer(const std::shared_ptr<const std::string> &newDocument,
+	                                    size_t newPosition) : document(newDocument),
+		position(newPosition) {
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(std::string *newStringValue) :
-		stringValue(newStringValue) {
+	Value::Extension::Extension() : serializedForms(), lazyContainer(NULL),
+		lazyError(), mutex() {
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(int *newIntValue) :
-		intValue(newIntValue) {
+	Value::Extension::~Extension() {
+		delete lazyContainer.load(std::memory_order_relaxed);
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(double *newDoubleValue) :
-		doubleValue(newDoubleValue) {
+	Value::String::String(const std::string &newText) : text(newText),
+		escaped(false), decoded(false), unescaped(), verbatim(false),
+		references(1) {
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(Object *newObjectValue) :
-		objectValue(newObjectValue) {
+	Value::String::String(const String &src) : text(src.text),
+		escaped(src.escaped), decoded(false), unescaped(), verbatim(src.verbatim),
+		references(src.references.load()) {
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(Array *newArrayValue) :
-		arrayValue(newArrayValue) {
+	Value::String &Value::String::operator=(const String &src) {
+		if (this != &src) {
+			text = src.text;
+			escaped = src.escaped;
+			decoded = false;
+			unescaped.clear();
+			verbatim = src.verbatim;
+			references = src.references.load();
+		}
+
+		return *this;
 	}
 
-	Value::ValueDataPointer::ValueDataPointer(bool *newBoolValue) :
-		boolValue(newBoolValue) {
+	Value::Number::Number(int newInteger) : value(), length(0),
+		capacity(0), state(CONVERTED) {
+		value.integerValue = newInteger;
 	}
 
-	bool Value::isHexDigit(char digit) {
-		return (digit >= Numbers::DIGITS[0] && digit <= Numbers::DIGITS[9]) || (digit >= Numbers::DIGITS[10] && digit <= Numbers::DIGITS[15]) ||
-		       (digit >= Numbers::DIGITS[16] && digit <= Numbers::DIGITS[21]);
+	Value::Number::Number(double newDouble) : value(), length(0),
+		capacity(0), state(CONVERTED) {
+		value.doubleValue = newDouble;
 	}
 
-	bool Value::isWhiteSpace(char whiteSpace) {
-		return whiteSpace == Whitespace::SPACE ||
-		       whiteSpace == Whitespace::HORIZONTAL_TAB ||
-		       whiteSpace == Whitespace::NEW_LINE ||
-		       whiteSpace == Whitespace::CARRIAGE_RETURN;
+	Value::Number *Value::Number::create(const std::string &newText) {
+		Number *result = allocate(newText.size() + 1);
+		result->setText(newText);
+		return result;
 	}
 
-	void Value::readString(std::istream &input, std::string &result) {
-		bool noErrors = true, noUnicodeError = true;
-		char currentCharacter, tmpCharacter;
-		std::stringstream constructing;
-		std::string tmpStr(4, ' ');
-		std::stringstream tmpSs;
-		int32_t tmpInt;
-		String32 tmpStr32;
-		unsigned int tmpCounter;
-
-		// As long as there aren't any errors and that we haven't reached the
-		// end of the input stream.
-		while (noErrors && !input.eof()) {
-			input.get(currentCharacter);
+	Value::Number *Value::Number::copy(const Number &src) {
+		Number *result = allocate((src.length != 0) ? (src.length + 1) : (0));
 
-			if (input.good()) {
-				if (currentCharacter & 0x80) { // 0x80 --> 10000000
-					// The character is part of an utf8 character.
-					constructing << currentCharacter;
+		// Another thread may still be converting the source, the copy then
+		// converts its own text.
+		if (src.state.load(std::memory_order_acquire) == CONVERTED) {
+			result->value = src.value;
+
+		} else {
+			result->state.store(TEXT, std::memory_order_relaxed);
+		}
 
-				} else if (currentCharacter == Strings::Json::Escape::BEGIN_ESCAPE) {
-					if (!input.eof()) {
-						input.get(tmpCharacter);
+		if (src.length != 0) {
+			std::memcpy(result + 1, src.getText(), src.length + 1);
+			result->length = src.length;
+		}
 
-						switch (tmpCharacter) {
-						case Strings::Json::Escape::QUOTATION_MARK:
-							constructing << Strings::Std::QUOTATION_MARK;
-							break;
+		return result;
+	}
 
-						case Strings::Json::Escape::REVERSE_SOLIDUS:
-							constructing << Strings::Std::REVERSE_SOLIDUS;
-							break;
+	void Value::Number::setText(const std::string &newText) {
+		std::memcpy(this + 1, newText.c_str(), newText.size() + 1);
+		length = static_cast<unsigned int>(newText.size());
+		state.store(TEXT, std::memory_order_relaxed);
+	}
 
-						case Strings::Json::Escape::SOLIDUS:
-							constructing << Strings::Std::SOLIDUS;
-							break;
+	void Value::Number::operator delete(void *pointer) {
+		::operator delete(pointer);
+	}
 
-						case Strings::Json::Escape::BACKSPACE:
-							constructing << Strings::Std::BACKSPACE;
-							break;
+	const char *Value::Number::getText() const {
+		return reinterpret_cast<const char *>(this + 1);
+	}
 
-						case Strings::Json::Escape::FORM_FEED:
-							constructing << Strings::Std::FORM_FEED;
-							break;
+	Value::Number *Value::Number::allocate(size_t room) {
+		Number *result = new(::operator new(sizeof(Number) + room)) Number(0);
+		result->capacity = static_cast<unsigned short>(std::min<size_t>(room, USHRT_MAX));
+		return result;
+	}
 
-						case Strings::Json::Escape::LINE_FEED:
-							constructing << Strings::Std::LINE_FEED;
-							break;
+	Value::ValueDataPointer::ValueDataPointer(): stringValue(NULL) {
+	}
 
-						case Strings::Json::Escape::CARRIAGE_RETURN:
-							constructing << Strings::Std::CARRIAGE_RETURN;
-							break;
+	Value::ValueDataPointer::ValueDataPointer(String *newStringValue) :
+		stringValue(newStringValue) {
+	}
 
-						case Strings::Json::Escape::TAB:
-							constructing << Strings::Std::TAB;
-							break;
+	Value::ValueDataPointer::ValueDataPointer(Number *newNumberValue) :
+		numberValue(newNumberValue) {
+	}
 
-						case Strings::Json::Escape::BEGIN_UNICODE:
-							// TODO: Check for utf16 surrogate pairs.
-							tmpCounter = 0;
-							tmpStr.clear();
-							tmpStr = "    ";
-							noUnicodeError = true;
+	Value::ValueDataPointer::ValueDataPointer(Object *newObjectValue) :
+		objectValue(newObjectValue) {
+	}
 
-							while (tmpCounter < 4 && !input.eof()) {
-								input.get(tmpCharacter);
+	Value::ValueDataPointer::ValueDataPointer(Array *newArrayValue) :
+		arrayValue(newArrayValue) {
+	}
 
-								if (isHexDigit(tmpCharacter)) {
-									tmpStr[tmpCounter] = tmpCharacter;
+	Value::ValueDataPointer::ValueDataPointer(bool *newBoolValue) :
+		boolValue(newBoolValue) {
+	}
 
-								} else {
-									// Invalid \u character, skipping it.
-									noUnicodeError = false;
-								}
+	bool Value::isHexDigit(char digit) {
+		return isCharacterClass(digit, CharacterClass::HEX_DIGIT);
+	}
 
-								++tmpCounter;
-							}
+	bool Value::isWhiteSpace(char whiteSpace) {
+		return isCharacterClass(whiteSpace, CharacterClass::WHITESPACE);
+	}
 
-							if (noUnicodeError) {
-								tmpSs.clear();
-								tmpSs.str("");
-								tmpSs << std::hex << tmpStr;
-								tmpSs >> tmpInt;
-								tmpStr32.clear();
-								tmpStr32.push_back(tmpInt);
-								tmpStr = Convert::encodeToUTF8(tmpStr32);
-								constructing << tmpStr;
-							}
+	void Value::readString(std::istream &input, std::string &result) {
+		String escapedString((std::string()));
 
-							break;
+		// The text is read in the result's buffer to reuse its capacity.
+		escapedString.text.swap(result);
 
-						default:
-							break;
-						}
-					}
+		readEscapedString(input, escapedString);
 
-				} else if (currentCharacter == '"') {
-					result = constructing.str();
-					noErrors = false;
+		if (escapedString.escaped) {
+			unescapeString(escapedString.text, result);
 
-				} else {
-					constructing << currentCharacter;
-				}
-			}
+		} else {
+			result.swap(escapedString.text);
 		}
 	}
 
-	void Value::readObject(std::istream &input, Object &result) {
-		bool noErrors = true;
+	void Value::readEscapedString(std::istream &input, String &result) {
+		bool escaped = false, verbatim = true;
 		char currentCharacter;
-		std::string tmpString;
-
-		while (noErrors && !input.eof()) {
-			input.get(currentCharacter);
-
-			if (input.good()) {
-				if (currentCharacter == Structural::BEGIN_END_STRING) {
-					// We read the object's member's name.
-					readString(input, tmpString);
-					currentCharacter = input.peek();
-					// We read white spaces until the next non white space.
-					readToNonWhiteSpace(input, currentCharacter);
-
-					if (!input.eof()) {
+		std::string &constructing = result.text;
 
-						// We make sure it's the right character.
-						if (currentCharacter == Structural::NAME_SEPARATOR) {
-							// We read until the value starts.
-							readToNonWhiteSpace(input, currentCharacter);
+		constructing.clear();
 
-							if (!input.eof()) {
-								// We put the character back and we load the value
-								// from the stream.
-								input.putback(currentCharacter);
-								result[tmpString].loadFromStream(input);
+		// As long as we haven't reached the end of the input stream.
+		while (input.get(currentCharacter)) {
+			if (currentCharacter == Structural::BEGIN_END_STRING) {
+				// The escape sequences are ASCII, so the escaped text can be
+				// validated as it is.
+				if (!Convert::isValidUTF8(constructing)) {
+					throw JsonParsingError("Invalid UTF-8 sequence found in string.");
+				}
 
-								while (!input.eof() && currentCharacter != Structural::VALUE_SEPARATOR &&
-								       currentCharacter != Structural::END_OBJECT) {
-									input.get(currentCharacter);
-								}
+				result.escaped = escaped;
+				result.decoded = false;
+				result.verbatim = verbatim;
+				return;
+
+			} else if (currentCharacter == Strings::Json::Escape::BEGIN_ESCAPE) {
+				// We keep the escape sequence as it is, only checking that
+				// it is valid so the text can be written back.
+				escaped = true;
+				constructing.push_back(currentCharacter);
+
+				if (input.get(currentCharacter)) {
+					constructing.push_back(currentCharacter);
+
+					switch (currentCharacter) {
+					case Strings::Json::Escape::QUOTATION_MARK:
+					case Strings::Json::Escape::REVERSE_SOLIDUS:
+					case Strings::Json::Escape::SOLIDUS:
+					case Strings::Json::Escape::BACKSPACE:
+					case Strings::Json::Escape::FORM_FEED:
+					case Strings::Json::Escape::LINE_FEED:
+					case Strings::Json::Escape::CARRIAGE_RETURN:
+					case Strings::Json::Escape::TAB:
+						break;
+
+					case Strings::Json::Escape::BEGIN_UNICODE: {
+							unsigned int digitCount = 0;
+
+							while (digitCount < 4 && input.get(currentCharacter) && isHexDigit(currentCharacter)) {
+								constructing.push_back(currentCharacter);
+								++digitCount;
+							}
 
-								if (currentCharacter == Structural::END_OBJECT) {
-									// We are done reading the object.
-									noErrors = false;
-								}
+							if (digitCount < 4) {
+								throw JsonParsingError("Invalid unicode escape sequence found in string.");
 							}
 						}
-					}
+						break;
 
-				} else if (currentCharacter == Structural::END_OBJECT) {
-					noErrors = false;
-
-				} else if (!isWhiteSpace(currentCharacter)) {
-					std::cout << "Expected '\"', got '" << currentCharacter << "', ignoring it." << std::endl;
+					default:
+						verbatim = false;
+						break;
+					}
 				}
+
+			} else {
+				// Control characters are accepted, but must be escaped when
+				// the string is written.
+				verbatim = verbatim && !(static_cast<unsigned char>(currentCharacter) < 0x20);
+				constructing.push_back(currentCharacter);
 			}
 		}
-	}
 
-	void Value::readArray(std::istream &input, Array &result) {
-		bool notDone = true;
-		char currentChar;
-
-		while (notDone && !input.eof()) {
-			input.get(currentChar);
+		throw JsonParsingError("JSON input ends inside a string.");
+	}
 
-			if (input.good()) {
-				if (currentChar == Structural::END_ARRAY) {
-					notDone = false;
+	bool Value::readLiteral(std::istream &input, char firstCharacter) {
+		// The rest of the literal is read and compared at once, instead of
+		// character by character.
+		char rest[4];
+		const char *expected = (firstCharacter == Literals::NULL_STRING[0]) ? ("ull") : ((firstCharacter == Literals::TRUE_STRING[0]) ? ("rue") : ("alse"));
+		std::streamsize size = (firstCharacter == Literals::FALSE_STRING[0]) ? (4) : (3);
+		std::streamsize count = input.rdbuf()->sgetn(rest, size);
 
-				} else if (!isWhiteSpace(currentChar)) {
-					input.putback(currentChar);
-					result.push_back(Value());
-					result.back().type = UNKNOWN;
-					result.back().loadFromStream(input);
+		if (count == size && std::memcmp(rest, expected, static_cast<size_t>(size)) == 0) {
+			if (firstCharacter == Literals::NULL_STRING[0]) {
+				setNull();
 
-					if (result.back().type == UNKNOWN) {
-						result.pop_back();
-					}
+			} else {
+				setBoolean(firstCharacter == Literals::TRUE_STRING[0]);
+			}
 
-					while (!input.eof() && currentChar != ',' &&
-					       currentChar != Structural::END_ARRAY) {
-						input.get(currentChar);
-					}
+			return true;
 
-					if (currentChar == Structural::END_ARRAY) {
-						notDone = false;
-					}
-				}
-			}
+		} else if (firstCharacter == Literals::NULL_STRING[0]) {
+			throw JsonParsingError((count == size) ? ("Invalid characters found.") : ("JSON input ends incorrectly."));
 		}
-	}
-
-	void Value::readNumber(std::istream &input, JsonBox::Value &result) {
-		bool notDone = true, inFraction = false, inExponent = false;
-		char currentCharacter;
-		std::stringstream constructing;
 
-		if (!input.eof() && input.peek() == Numbers::DIGITS[0]) {
-			// We make sure there isn't more than one zero.
-			input.get(currentCharacter);
+		// Invalid booleans are skipped.
+		return false;
+	}
 
-			if (input.peek() == '0') {
-				notDone = false;
+	void Value::readInternedString(std::istream &input, Parser &parser) {
+		String &read = parser.internedText;
+		readEscapedString(input, read);
 
-			} else {
-				input.putback(currentCharacter);
+		// Strings with escape sequences are left out, since they are decoded
+		// when accessed.
+		if (read.escaped || read.text.size() > parser.maximumInternedSize) {
+			// The previous text is swapped into the scratch string, which
+			// keeps its capacity.
+			if (type != STRING || data.stringValue->references > 1) {
+				setString("");
 			}
-		}
-
-		while (notDone && !input.eof()) {
-			input.get(currentCharacter);
-
-			if (currentCharacter == '-') {
-				if (constructing.str().empty()) {
-					constructing << currentCharacter;
 
-				} else {
-					std::cout << "Expected a digit, '.', 'e' or 'E', got '" << currentCharacter << "' instead, ignoring it." << std::endl;
-				}
+			data.stringValue->text.swap(read.text);
+			data.stringValue->escaped = read.escaped;
+			data.stringValue->decoded = false;
+			data.stringValue->verbatim = read.verbatim;
 
-			} else if (currentCharacter >= '0' && currentCharacter <= '9') {
-				constructing << currentCharacter;
+		} else {
+			// The scratch string is looked up as is, its text being the key.
+			Parser::StringTable::iterator i = parser.strings.find(&read);
 
-			} else if (currentCharacter == '.') {
-				if (!inFraction && !inExponent) {
-					inFraction = true;
-					constructing << currentCharacter;
+			if (i == parser.strings.end()) {
+				if (parser.strings.size() >= parser.maximumInternedCount) {
+					parser.clearInternedStrings();
 				}
 
-			} else if (currentCharacter == 'e' || currentCharacter == 'E') {
-				if (!inExponent) {
-					inExponent = true;
-					constructing << currentCharacter;
+				String *interned = new String(read.text);
+				interned->verbatim = read.verbatim;
+				i = parser.strings.insert(interned).first;
+			}
 
-					if (!input.eof() && (input.peek() == '-' || input.peek() == '+')) {
-						input.get(currentCharacter);
-						constructing << currentCharacter;
-					}
-				}
+			if (type == STRING && data.stringValue == *i) {
+				discardSerializedForms();
 
 			} else {
-				input.putback(currentCharacter);
-				notDone = false;
+				clear();
+				type = STRING;
+				data.stringValue = *i;
+				++data.stringValue->references;
 			}
 		}
+	}
 
-		if (inFraction || inExponent) {
-			double doubleResult;
-			constructing >> doubleResult;
-			result.setDouble(doubleResult);
+	Value::String *Value::copyString(String *string) {
+		if (string->references > 1) {
+			++string->references;
+			return string;
 
 		} else {
-			int intResult;
-			constructing >> intResult;
-			result.setInteger(intResult);
+			String *result = new String(*string);
+			result->references = 1;
+			return result;
 		}
 	}
 
-	void Value::readToNonWhiteSpace(std::istream &input, char &currentCharacter) {
-		do {
-			input.get(currentCharacter);
-		} while (!input.eof() && isWhiteSpace(currentCharacter));
-	}
-
-	void Value::clear() {
-		switch (type) {
-		case STRING:
-			delete data.stringValue;
-			break;
-
-		case INTEGER:
-			delete data.intValue;
-			break;
-
-		case DOUBLE:
-			delete data.doubleValue;
-			break;
-
-		case OBJECT:
-			delete data.objectValue;
-			break;
-
-		case ARRAY:
-			delete data.arrayValue;
-			break;
-
-		case BOOLEAN:
-			delete data.boolValue;
-			break;
-
-		default:
-			break;
+	void Value::releaseString(String *string) {
+		if (--string->references == 0) {
+			delete string;
 		}
 	}
 
-	void Value::output(std::ostream &output, bool indent,
-	                   bool escapeAll) const {
-		if (indent) {
-			if (escapeAll) {
-				OutputFilter<SolidusEscaper> solidusEscaper(output.rdbuf());
-				output.rdbuf(&solidusEscaper);
-				output << *this;
-				output.rdbuf(solidusEscaper.getDestination());
-
-			} else {
-				output << *this;
-			}
-
-		} else {
-			OutputFilter<IndentCanceller> indentCanceller(output.rdbuf());
-			output.rdbuf(&indentCanceller);
+	int32_t Value::readHexCodeUnit(std::string::const_iterator &i,
+	                               std::string::const_iterator end) {
+		int32_t codeUnit = 0;
+		unsigned int counter = 0;
 
-			if (escapeAll) {
-				OutputFilter<SolidusEscaper> solidusEscaper(output.rdbuf());
-				output.rdbuf(&solidusEscaper);
-				output << *this;
-				output.rdbuf(solidusEscaper.getDestination());
+		for (; counter < 4 && i != end; ++counter, ++i) {
+			if (isHexDigit(*i)) {
+				codeUnit = codeUnit * 16 + ((*i <= '9') ? (*i - '0') : ((*i & ~0x20) - 'A' + 10));
 
 			} else {
-				output << *this;
+				codeUnit = -1;
 			}
-
-			output.rdbuf(indentCanceller.getDestination());
 		}
+
+		return (codeUnit >= 0 && counter == 4) ? (codeUnit) : (-1);
 	}
 
-	std::ostream &operator<<(std::ostream &output, const Value &v) {
-		switch (v.type) {
-		case Value::STRING:
-			output << Structural::BEGIN_END_STRING << Value::escapeMinimumCharacters(v.getString()) << Structural::BEGIN_END_STRING;
-			break;
+	void Value::unescapeString(const std::string &escaped, std::string &result) {
+		std::string::const_iterator i = escaped.begin();
 
-		case Value::INTEGER:
-			output << v.getInteger();
-			break;
+		result.clear();
+		result.reserve(escaped.size());
 
-		case Value::DOUBLE: {
-				std::streamsize precisionBackup = output.precision();
-				output.precision(17);
-				output << v.getDouble();
-				output.precision(precisionBackup);
-			}
-			break;
+		while (i != escaped.end()) {
+			if (*i != Strings::Json::Escape::BEGIN_ESCAPE) {
+				result.push_back(*i);
+				++i;
 
-		case Value::OBJECT:
-			output << v.getObject();
-			break;
+			} else if (++i != escaped.end()) {
+				switch (*i++) {
+				case Strings::Json::Escape::QUOTATION_MARK:
+					result.push_back(Strings::Std::QUOTATION_MARK);
+					break;
 
-		case Value::ARRAY:
-			output << v.getArray();
-			break;
+				case Strings::Json::Escape::REVERSE_SOLIDUS:
+					result.push_back(Strings::Std::REVERSE_SOLIDUS);
+					break;
 
-		case Value::BOOLEAN:
-			output << (v.getBoolean() ? Literals::TRUE_STRING : Literals::FALSE_STRING);
-			break;
+				case Strings::Json::Escape::SOLIDUS:
+					result.push_back(Strings::Std::SOLIDUS);
+					break;
 
-		case Value::NULL_VALUE:
-			output << Literals::NULL_STRING;
-			break;
+				case Strings::Json::Escape::BACKSPACE:
+					result.push_back(Strings::Std::BACKSPACE);
+					break;
 
-		default:
-			break;
-		}
+				case Strings::Json::Escape::FORM_FEED:
+					result.push_back(Strings::Std::FORM_FEED);
+					break;
 
-		return output;
-	}
+				case Strings::Json::Escape::LINE_FEED:
+					result.push_back(Strings::Std::LINE_FEED);
+					break;
 
-	std::ostream &operator<<(std::ostream &output, const Array &a) {
-		if (a.empty()) {
-			output << Structural::BEGIN_ARRAY << Structural::END_ARRAY;
+				case Strings::Json::Escape::CARRIAGE_RETURN:
+					result.push_back(Strings::Std::CARRIAGE_RETURN);
+					break;
+
+				case Strings::Json::Escape::TAB:
+					result.push_back(Strings::Std::TAB);
+					break;
+
+				case Strings::Json::Escape::BEGIN_UNICODE: {
+						int32_t codePoint = readHexCodeUnit(i, escaped.end());
+
+						// A high surrogate followed by an escaped low surrogate
+						// forms a single code point, the unpaired surrogates
+						// are replaced by U+FFFD.
+						if (codePoint >= 0xD800 && codePoint <= 0xDBFF &&
+						    escaped.end() - i >= 6 && *i == Strings::Json::Escape::BEGIN_ESCAPE &&
+						    *(i + 1) == Strings::Json::Escape::BEGIN_UNICODE) {
+							std::string::const_iterator next = i + 2;
+							int32_t lowSurrogate = readHexCodeUnit(next, escaped.end());
+
+							if (lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF) {
+								codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+								i = next;
+							}
+						}
+
+						// Invalid \u escape sequences are skipped.
+						if (codePoint >= 0) {
+							Convert::appendUTF8(codePoint, result);
+						}
+
+						break;
+					}
+
+				default:
+					break;
+				}
+			}
+		}
+	}
+
+	void Value::beginContainer(char bracket, const Projection *projection,
+	                           Parser &parser) {
+		if (parser.frames.size() >= parser.maximumDepth) {
+			throw JsonParsingError("JSON exceeds the maximum nesting depth.");
+		}
+
+		Parser::Frame frame;
+		frame.value = this;
+		frame.projection = projection;
+		frame.count = 0;
+		frame.firstMember = parser.members.size();
+		frame.reusing = false;
+		frame.afterValue = false;
+
+		if (bracket == Structural::BEGIN_OBJECT) {
+			if (type == OBJECT && !getLazyContainer()) {
+				discardSerializedForms();
+
+				// The members read are only tracked when some could be
+				// stale.
+				frame.reusing = !data.objectValue->empty();
+
+			} else {
+				setObject(Object());
+			}
+
+		} else if (type == ARRAY && arrayStorage == GENERIC_ARRAY && !getLazyContainer()) {
+			discardSerializedForms();
 
 		} else {
-			output << Structural::BEGIN_ARRAY << std::endl;
-			OutputFilter<Indenter> indent(output.rdbuf());
-			output.rdbuf(&indent);
+			setArray(Array());
+		}
+
+		parser.frames.push_back(frame);
+	}
+
+	void Value::readContainers(std::istream &input,
+	                           const LazyContainer *container,
+	                           Parser &parser, size_t base) {
+		char currentCharacter;
+
+		while (parser.frames.size() > base) {
+			// The frame is copied back before a nested container is pushed,
+			// which can move the stack.
+			size_t index = parser.frames.size() - 1;
+			Parser::Frame frame = parser.frames[index];
+			char end = (frame.value->type == OBJECT) ? (Structural::END_OBJECT) : (Structural::END_ARRAY);
+			bool started = false;
+
+			if (frame.afterValue) {
+				// We read until the next member or element.
+				currentCharacter = '\0';
+
+				while (!input.eof() && currentCharacter != Structural::VALUE_SEPARATOR &&
+				       currentCharacter != end) {
+					input.get(currentCharacter);
+				}
+
+				if (currentCharacter == end) {
+					endContainer(parser);
+					continue;
+				}
+
+				frame.afterValue = false;
+			}
+
+			while (!started && !input.eof()) {
+				input.get(currentCharacter);
+
+				if (!input.good()) {
+					// The input ended before the closing bracket.
+
+				} else if (currentCharacter == end) {
+					break;
+
+				} else if (end == Structural::END_OBJECT) {
+					// Other characters than a member's name are ignored.
+					if (currentCharacter == Structural::BEGIN_END_STRING) {
+						// We read the object's member's name.
+						readString(input, parser.buffer);
+						currentCharacter = input.peek();
+						// We read white spaces until the next non white space.
+						readToNonWhiteSpace(input, currentCharacter);
+
+						// We make sure it's the right character.
+						if (!input.eof() && currentCharacter == Structural::NAME_SEPARATOR) {
+							// We read until the value starts.
+							readToNonWhiteSpace(input, currentCharacter);
+
+							if (!input.eof()) {
+								// We put the character back and we load the value
+								// from the stream.
+								input.putback(currentCharacter);
+								const Projection *memberProjection = NULL;
+								frame.afterValue = true;
+								parser.frames[index] = frame;
+								started = true;
+
+								if (!frame.projection || frame.projection->selectMember(parser.buffer, memberProjection)) {
+									Value &member = (*frame.value->data.objectValue)[parser.buffer];
+
+									if (frame.reusing) {
+										parser.members.push_back(&member);
+									}
+
+									readElement(input, member, container, memberProjection, parser);
+
+								} else {
+									skipValue(input);
+								}
+							}
+						}
+					}
+
+				} else if (!isWhiteSpace(currentCharacter)) {
+					input.putback(currentCharacter);
+					Array &elements = *frame.value->data.arrayValue;
 
-			for (Array::const_iterator i = a.begin(); i != a.end(); ++i) {
-				if (i != a.begin()) {
-					output << Structural::VALUE_SEPARATOR << std::endl;
+					// The elements already there are parsed in place.
+					if (frame.count == elements.size()) {
+						elements.push_back(Value());
+					}
+
+					frame.afterValue = true;
+					parser.frames[index] = frame;
+					started = true;
+
+					if (readElement(input, elements[frame.count], container, frame.projection, parser)) {
+						++parser.frames[index].count;
+					}
 				}
+			}
+
+			if (!started) {
+				endContainer(parser);
+			}
+		}
+	}
+
+	void Value::endContainer(Parser &parser) {
+		Parser::Frame &frame = parser.frames.back();
 
-				output << *i;
+		if (frame.value->type == OBJECT) {
+			if (frame.reusing) {
+				eraseStaleMembers(*frame.value->data.objectValue, parser.members, frame.firstMember);
 			}
 
-			output.rdbuf(indent.getDestination());
+		} else {
+			Array &elements = *frame.value->data.arrayValue;
+			elements.erase(elements.begin() + frame.count, elements.end());
 
-			output << std::endl << Structural::END_ARRAY;
+			if (parser.typedArrays) {
+				frame.value->detectTypedArray();
+			}
 		}
 
-		return output;
+		parser.frames.pop_back();
 	}
 
-	std::ostream &operator<<(std::ostream &output, const Object &o) {
-		// If the object is empty, we simply write "{}".
-		if (o.empty()) {
-			output << Structural::BEGIN_OBJECT << Structural::END_OBJECT;
+	void Value::eraseStaleMembers(Object &object,
+	                              std::vector<const Value *> &members,
+	                              size_t firstMember) {
+		std::vector<const Value *>::iterator first = members.begin() + firstMember;
+
+		if (object.size() != static_cast<size_t>(members.end() - first)) {
+			// Members can be read twice, so only the members missing from
+			// the sorted list are erased.
+			std::sort(first, members.end());
+
+			for (Object::iterator i = object.begin(); i != object.end();) {
+				if (std::binary_search(first, members.end(), &i->second)) {
+					++i;
+
+				} else {
+					object.erase(i++);
+				}
+			}
+		}
+
+		members.erase(first, members.end());
+	}
+
+	bool Value::readElement(std::istream &input, Value &result,
+	                        const LazyContainer *container,
+	                        const Projection *projection, Parser &parser) {
+		if (container && (input.peek() == Structural::BEGIN_OBJECT || input.peek() == Structural::BEGIN_ARRAY)) {
+			// We only record where the nested container starts and jump
+			// over it.
+			size_t position = static_cast<size_t>(input.tellg());
+			input.seekg(skipContainer(*container->document, position));
+			result.setLazyContainer(container->document, position);
+			return true;
 
 		} else {
-			output << Structural::BEGIN_OBJECT << std::endl;
-			OutputFilter<Indenter> indent(output.rdbuf());
-			output.rdbuf(&indent);
-
-			// For each item in the object.
-			for (Object::const_iterator i = o.begin(); i != o.end(); ++i) {
-				if (i != o.begin()) {
-					output << Structural::VALUE_SEPARATOR << std::endl;
+			return result.beginValue(input, projection, parser);
+		}
+	}
+
+	void Value::skipValue(std::istream &input) {
+		std::streambuf *buffer = input.rdbuf();
+		std::streambuf::int_type character = buffer->sgetc();
+		size_t level = 0;
+
+		// We read straight from the streambuf, skipping is only about
+		// finding where the value ends.
+		while (character != std::streambuf::traits_type::eof()) {
+			if (character == Structural::BEGIN_END_STRING) {
+				character = buffer->snextc();
+
+				while (character != std::streambuf::traits_type::eof() && character != Structural::BEGIN_END_STRING) {
+					if (character == Strings::Json::Escape::BEGIN_ESCAPE) {
+						buffer->sbumpc();
+					}
+
+					character = buffer->snextc();
+				}
+
+				if (character != std::streambuf::traits_type::eof()) {
+					character = buffer->snextc();
+				}
+
+				if (level == 0) {
+					return;
+				}
+
+			} else if (character == Structural::BEGIN_OBJECT || character == Structural::BEGIN_ARRAY) {
+				++level;
+				character = buffer->snextc();
+
+			} else if (character == Structural::END_OBJECT || character == Structural::END_ARRAY) {
+				if (level == 0) {
+					// The end of the parent container.
+					return;
+				}
+
+				character = buffer->snextc();
+
+				if (--level == 0) {
+					return;
+				}
+
+			} else if (level == 0 && (character == Structural::VALUE_SEPARATOR || isWhiteSpace(static_cast<char>(character)))) {
+				// The end of a number or a literal.
+				return;
+
+			} else {
+				character = buffer->snextc();
+			}
+		}
+
+		input.setstate(std::ios::eofbit);
+	}
+
+	void Value::readNumber(std::istream &input, JsonBox::Value &result,
+	                       std::string &buffer) {
+		bool notDone = true, inFraction = false, inExponent = false;
+		char currentCharacter;
+		std::string &constructing = buffer;
+
+		constructing.clear();
+
+		if (!input.eof() && input.peek() == Numbers::DIGITS[0]) {
+			// We make sure there isn't more than one zero.
+			input.get(currentCharacter);
+
+			if (input.peek() == '0') {
+				notDone = false;
+
+			} else {
+				input.putback(currentCharacter);
+			}
+		}
+
+		while (notDone && input.get(currentCharacter)) {
+			if (currentCharacter == '-') {
+				// A minus sign is ignored after the number's start.
+				if (constructing.empty()) {
+					constructing.push_back(currentCharacter);
+				}
+
+			} else if (currentCharacter >= '0' && currentCharacter <= '9') {
+				constructing.push_back(currentCharacter);
+
+			} else if (currentCharacter == '.') {
+				if (!inFraction && !inExponent) {
+					inFraction = true;
+					constructing.push_back(currentCharacter);
+				}
+
+			} else if (currentCharacter == 'e' || currentCharacter == 'E') {
+				if (!inExponent) {
+					inExponent = true;
+					constructing.push_back(currentCharacter);
+
+					if (!input.eof() && (input.peek() == '-' || input.peek() == '+')) {
+						input.get(currentCharacter);
+						constructing.push_back(currentCharacter);
+					}
 				}
 
-				// We print the name of the attribute and its value.
-				output << Structural::BEGIN_END_STRING << Value::escapeMinimumCharacters(i->first) << Structural::BEGIN_END_STRING << Whitespace::SPACE << Structural::NAME_SEPARATOR << Whitespace::SPACE << i->second;
+			} else {
+				input.putback(currentCharacter);
+				notDone = false;
+			}
+		}
+
+		if (isJsonNumber(constructing)) {
+			// The conversion waits until the number is accessed.
+			if ((result.type == INTEGER || result.type == DOUBLE) && constructing.size() < result.data.numberValue->capacity) {
+				result.data.numberValue->setText(constructing);
+
+			} else {
+				result.clear();
+				result.data.numberValue = Number::create(constructing);
+			}
+
+			result.type = (inFraction || inExponent) ? (DOUBLE) : (INTEGER);
+
+		} else if (inFraction || inExponent) {
+			double doubleResult;
+			std::stringstream(constructing) >> doubleResult;
+			result.setDouble(doubleResult);
+
+		} else {
+			int intResult;
+			std::stringstream(constructing) >> intResult;
+			result.setInteger(intResult);
+		}
+	}
+
+	bool Value::isJsonNumber(const std::string &text) {
+		std::string::const_iterator i = text.begin();
+
+		if (i != text.end() && *i == '-') {
+			++i;
+		}
+
+		if (i == text.end() || *i < '0' || *i > '9') {
+			return false;
+
+		} else if (*i == '0') {
+			++i;
+
+		} else {
+			while (i != text.end() && *i >= '0' && *i <= '9') {
+				++i;
+			}
+		}
+
+		if (i != text.end() && *i == '.') {
+			++i;
+
+			if (i == text.end() || *i < '0' || *i > '9') {
+				return false;
+			}
+
+			while (i != text.end() && *i >= '0' && *i <= '9') {
+				++i;
+			}
+		}
+
+		if (i != text.end() && (*i == 'e' || *i == 'E')) {
+			++i;
+
+			if (i != text.end() && (*i == '-' || *i == '+')) {
+				++i;
+			}
+
+			if (i == text.end() || *i < '0' || *i > '9') {
+				return false;
+			}
+
+			while (i != text.end() && *i >= '0' && *i <= '9') {
+				++i;
+			}
+		}
+
+		return i == text.end();
+	}
+
+	int Value::getIntegerNumber() const {
+		Number &number = *data.numberValue;
+
+		if (number.state.load(std::memory_order_acquire) == Number::CONVERTED) {
+			return number.value.integerValue;
+
+		} else {
+			int result = readInteger(number.getText());
+			unsigned char expected = Number::TEXT;
+
+			// Only the first thread to convert the number stores it, the
+			// others return their own conversion.
+			if (number.state.compare_exchange_strong(expected, Number::CONVERTING, std::memory_order_relaxed)) {
+				number.value.integerValue = result;
+				number.state.store(Number::CONVERTED, std::memory_order_release);
+			}
+
+			return result;
+		}
+	}
+
+	double Value::getDoubleNumber() const {
+		Number &number = *data.numberValue;
+
+		if (number.state.load(std::memory_order_acquire) == Number::CONVERTED) {
+			return number.value.doubleValue;
+
+		} else {
+			double result = readDouble(number.getText());
+			unsigned char expected = Number::TEXT;
+
+			if (number.state.compare_exchange_strong(expected, Number::CONVERTING, std::memory_order_relaxed)) {
+				number.value.doubleValue = result;
+				number.state.store(Number::CONVERTED, std::memory_order_release);
+			}
+
+			return result;
+		}
+	}
+
+	const std::string &Value::getUnescapedString() const {
+		String &string = *data.stringValue;
+
+		if (!string.escaped) {
+			return string.text;
+
+		} else if (!string.decoded.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(unescapingMutex);
+
+			if (!string.decoded.load(std::memory_order_relaxed)) {
+				unescapeString(string.text, string.unescaped);
+				string.decoded.store(true, std::memory_order_release);
+			}
+		}
+
+		return string.unescaped;
+	}
+
+	const std::string *Value::getVerbatimString() const {
+		return (type == STRING && data.stringValue->verbatim) ? (&data.stringValue->text) : (NULL);
+	}
+
+	const char *Value::getNumberText() const {
+		return ((type == INTEGER || type == DOUBLE) && data.numberValue->length != 0) ? (data.numberValue->getText()) : (NULL);
+	}
+
+	void Value::readToNonWhiteSpace(std::istream &input, char &currentCharacter) {
+		do {
+			input.get(currentCharacter);
+		} while (!input.eof() && isWhiteSpace(currentCharacter));
+	}
+
+	void Value::loadLazilyFromDocument(const std::shared_ptr<std::string> &document) {
+		std::string &json = *document;
+		size_t position;
+		Encoding::Format format = Encoding::detect(json.data(), std::min<size_t>(json.size(), 4), position);
+
+		if (format != Encoding::UTF8) {
+			// The lazy containers are parsed from the UTF-8 text, which
+			// takes the place of the encoded text in the buffer.
+			std::string converted;
+
+			{
+				DocumentStreambuf encoded(json, position);
+				std::istream source(&encoded);
+				TranscodingInputStream transcoded(source, format);
+				converted.assign(std::istreambuf_iterator<char>(transcoded), std::istreambuf_iterator<char>());
 			}
 
-			output.rdbuf(indent.getDestination());
+			json.swap(converted);
+			position = 0;
+		}
+
+		while (position < json.size() && isWhiteSpace(json[position])) {
+			++position;
+		}
+
+		if (position < json.size() && (json[position] == Structural::BEGIN_OBJECT || json[position] == Structural::BEGIN_ARRAY)) {
+			setLazyContainer(document, position);
+
+		} else {
+			// There is nothing to defer in a JSON with no containers.
+			loadFromString(json);
+		}
+	}
+
+	void Value::setLazyContainer(const std::shared_ptr<const std::string> &document,
+	                             size_t position) {
+		LazyContainer *newContainer = new LazyContainer(document, position);
+
+		if ((*document)[position] == Structural::BEGIN_OBJECT) {
+			setObject(Object());
+
+		} else {
+			setArray(Array());
+		}
+
+		getExtension().lazyContainer.store(newContainer, std::memory_order_release);
+	}
+
+	void Value::parseLazyContainer() const {
+		Extension *current = extension.load(std::memory_order_acquire);
+
+		if (current && current->lazyContainer.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(current->mutex);
+			LazyContainer *container = current->lazyContainer.load(std::memory_order_relaxed);
+
+			if (current->lazyError) {
+				std::rethrow_exception(current->lazyError);
+
+			} else if (container) {
+				Value parsed;
 
-			output << std::endl << Structural::END_OBJECT;
+				try {
+					// We start after the container's opening bracket.
+					DocumentStreambuf buffer(*container->document, container->position + 1);
+					std::istream input(&buffer);
+					Parser parser;
+					parsed.beginContainer((*container->document)[container->position], NULL, parser);
+					readContainers(input, container, parser, 0);
+
+				} catch (const JsonParsingError &) {
+					current->lazyError = std::current_exception();
+					throw;
+				}
+
+				// The empty container is only replaced once the contents
+				// are complete. The type stays the same, so the threads
+				// reading it without the lock see no change.
+				std::swap(const_cast<Value &>(*this).data, parsed.data);
+				current->lazyContainer.store(NULL, std::memory_order_release);
+				delete container;
+			}
 		}
+	}
+
+	bool Value::copyLazyContainer(const Value &src) {
+		Extension *source = src.extension.load(std::memory_order_acquire);
+		bool result = false;
+
+		if (source && source->lazyContainer.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(source->mutex);
+			const LazyContainer *container = source->lazyContainer.load(std::memory_order_relaxed);
 
+			if (container) {
+				if (type == OBJECT) {
+					data.objectValue = new Object();
+
+				} else {
+					data.arrayValue = new Array();
+				}
+
+				Extension &copied = getExtension();
+				copied.lazyContainer.store(new LazyContainer(*container), std::memory_order_relaxed);
+				copied.lazyError = source->lazyError;
+				result = true;
+			}
+		}
+
+		return result;
+	}
+
+	void Value::clear() {
+		delete extension.exchange(NULL, std::memory_order_relaxed);
+
+		switch (type) {
+		case STRING:
+			releaseString(data.stringValue);
+			break;
+
+		case RAW_JSON:
+			delete data.rawJsonValue;
+			break;
+
+		case INTEGER:
+		case DOUBLE:
+			delete data.numberValue;
+			break;
+
+		case OBJECT:
+			deleteContainers(data.objectValue, NULL);
+			break;
+
+		case ARRAY:
+			switch (arrayStorage) {
+			case INT32_ARRAY:
+				delete data.int32ArrayValue;
+				break;
+
+			case INT64_ARRAY:
+				delete data.int64ArrayValue;
+				break;
+
+			case FLOAT_ARRAY:
+				delete data.floatArrayValue;
+				break;
+
+			case DOUBLE_ARRAY:
+				delete data.doubleArrayValue;
+				break;
+
+			default:
+				deleteContainers(NULL, data.arrayValue);
+				break;
+			}
+
+			arrayStorage = GENERIC_ARRAY;
+			break;
+
+		case BOOLEAN:
+			delete data.boolValue;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	void Value::deleteContainers(Object *object, Array *array) {
+		// The worklists only allocate when containers are nested.
+		std::vector<Object *> objects;
+		std::vector<Array *> arrays;
+
+		while (object || array) {
+			if (object) {
+				for (Object::iterator i = object->begin(); i != object->end(); ++i) {
+					takeContainer(i->second, objects, arrays);
+				}
+
+				delete object;
+
+			} else {
+				for (Array::iterator i = array->begin(); i != array->end(); ++i) {
+					takeContainer(*i, objects, arrays);
+				}
+
+				delete array;
+			}
+
+			object = NULL;
+			array = NULL;
+
+			if (!objects.empty()) {
+				object = objects.back();
+				objects.pop_back();
+
+			} else if (!arrays.empty()) {
+				array = arrays.back();
+				arrays.pop_back();
+			}
+		}
+	}
+
+	void Value::takeContainer(Value &value, std::vector<Object *> &objects,
+	                          std::vector<Array *> &arrays) {
+		// Empty containers are left to the value's destructor.
+		if (value.type == OBJECT && !value.data.objectValue->empty()) {
+			objects.push_back(value.data.objectValue);
+			value.type = NULL_VALUE;
+
+		} else if (value.type == ARRAY && value.arrayStorage == GENERIC_ARRAY &&
+		           !value.data.arrayValue->empty()) {
+			arrays.push_back(value.data.arrayValue);
+			value.type = NULL_VALUE;
+		}
+	}
+
+	void Value::copyArray(const Value &src) {
+		arrayStorage = src.arrayStorage;
+
+		switch (arrayStorage) {
+		case INT32_ARRAY:
+			data.int32ArrayValue = new std::vector<int32_t>(*src.data.int32ArrayValue);
+			break;
+
+		case INT64_ARRAY:
+			data.int64ArrayValue = new std::vector<int64_t>(*src.data.int64ArrayValue);
+			break;
+
+		case FLOAT_ARRAY:
+			data.floatArrayValue = new std::vector<float>(*src.data.floatArrayValue);
+			break;
+
+		case DOUBLE_ARRAY:
+			data.doubleArrayValue = new std::vector<double>(*src.data.doubleArrayValue);
+			break;
+
+		default:
+			data.arrayValue = new Array(*src.data.arrayValue);
+			break;
+		}
+	}
+
+	void Value::convertToGenericArray() {
+		if (type == ARRAY && arrayStorage != GENERIC_ARRAY) {
+			Array elements;
+
+			switch (arrayStorage) {
+			case INT32_ARRAY:
+				copyToValues(*data.int32ArrayValue, elements);
+				delete data.int32ArrayValue;
+				break;
+
+			case INT64_ARRAY:
+				copyToValues(*data.int64ArrayValue, elements);
+				delete data.int64ArrayValue;
+				break;
+
+			case FLOAT_ARRAY:
+				copyToValues(*data.floatArrayValue, elements);
+				delete data.floatArrayValue;
+				break;
+
+			default:
+				copyToValues(*data.doubleArrayValue, elements);
+				delete data.doubleArrayValue;
+				break;
+			}
+
+			data.arrayValue = new Array();
+			data.arrayValue->swap(elements);
+			arrayStorage = GENERIC_ARRAY;
+		}
+	}
+
+	void Value::detectTypedArray() {
+		if (type == ARRAY && arrayStorage == GENERIC_ARRAY && !data.arrayValue->empty()) {
+			Type elementType = data.arrayValue->front().type;
+
+			if (elementType == INTEGER || elementType == DOUBLE) {
+				Array::const_iterator i = data.arrayValue->begin();
+				bool writtenBack = true;
+
+				// The numbers whose text the writers wouldn't output again,
+				// like 1.10 or integers past the range of an int, keep
+				// their text in the generic storage.
+				while (i != data.arrayValue->end() && i->type == elementType && writtenBack) {
+					const char *text = i->getNumberText();
+
+					if (text && elementType == INTEGER) {
+						writtenBack = isWrittenAs(text, i->getIntegerNumber());
+
+					} else if (text) {
+						writtenBack = isWrittenAs(text, i->getDoubleNumber());
+					}
+
+					++i;
+				}
+
+				if (i == data.arrayValue->end() && writtenBack) {
+					setArrayStorage((elementType == INTEGER) ? (INT32_ARRAY) : (DOUBLE_ARRAY));
+				}
+			}
+		}
+	}
+
+	void Value::convertTypedArrays() {
+		// The worklist only allocates when containers are nested.
+		std::vector<Value *> containers(1, this);
+
+		while (!containers.empty()) {
+			Value &container = *containers.back();
+			containers.pop_back();
+
+			if (container.type == OBJECT) {
+				for (Object::iterator i = container.data.objectValue->begin(); i != container.data.objectValue->end(); ++i) {
+					containers.push_back(&i->second);
+				}
+
+			} else if (container.type == ARRAY && container.arrayStorage == GENERIC_ARRAY) {
+				for (Array::iterator i = container.data.arrayValue->begin(); i != container.data.arrayValue->end(); ++i) {
+					containers.push_back(&*i);
+				}
+
+			} else {
+				container.convertToGenericArray();
+			}
+		}
+	}
+
+	template <typename T>
+	bool Value::copyNumbers(std::vector<T> &result) const {
+		bool converted = true;
+
+		switch (arrayStorage) {
+		case INT32_ARRAY:
+			converted = convertNumbers(*data.int32ArrayValue, result);
+			break;
+
+		case INT64_ARRAY:
+			converted = convertNumbers(*data.int64ArrayValue, result);
+			break;
+
+		case FLOAT_ARRAY:
+			converted = convertNumbers(*data.floatArrayValue, result);
+			break;
+
+		case DOUBLE_ARRAY:
+			converted = convertNumbers(*data.doubleArrayValue, result);
+			break;
+
+		default:
+			result.resize(data.arrayValue->size());
+
+			for (size_t i = 0; converted && i < result.size(); ++i) {
+				const Value &element = (*data.arrayValue)[i];
+
+				if (element.type == INTEGER) {
+					converted = convertNumber(static_cast<int64_t>(element.getIntegerNumber()), result[i]);
+
+				} else if (element.type == DOUBLE) {
+					converted = convertNumber(element.getDoubleNumber(), result[i]);
+
+				} else {
+					converted = false;
+				}
+			}
+
+			break;
+		}
+
+		return converted;
+	}
+
+	size_t Value::getArraySize() const {
+		switch (arrayStorage) {
+		case INT32_ARRAY:
+			return data.int32ArrayValue->size();
+
+		case INT64_ARRAY:
+			return data.int64ArrayValue->size();
+
+		case FLOAT_ARRAY:
+			return data.floatArrayValue->size();
+
+		case DOUBLE_ARRAY:
+			return data.doubleArrayValue->size();
+
+		default:
+			return data.arrayValue->size();
+		}
+	}
+
+	Value Value::getArrayElement(size_t index) const {
+		switch (arrayStorage) {
+		case INT32_ARRAY:
+			return makeNumberValue((*data.int32ArrayValue)[index]);
+
+		case INT64_ARRAY:
+			return makeNumberValue((*data.int64ArrayValue)[index]);
+
+		case FLOAT_ARRAY:
+			return makeNumberValue((*data.floatArrayValue)[index]);
+
+		case DOUBLE_ARRAY:
+			return makeNumberValue((*data.doubleArrayValue)[index]);
+
+		default:
+			return (*data.arrayValue)[index];
+		}
+	}
+
+	bool Value::isArrayEqual(const Value &rhs) const {
+		bool result = true;
+
+		if (arrayStorage == rhs.arrayStorage) {
+			switch (arrayStorage) {
+			case INT32_ARRAY:
+				result = (*data.int32ArrayValue == *rhs.data.int32ArrayValue);
+				break;
+
+			case INT64_ARRAY:
+				result = (*data.int64ArrayValue == *rhs.data.int64ArrayValue);
+				break;
+
+			case FLOAT_ARRAY:
+				result = (*data.floatArrayValue == *rhs.data.floatArrayValue);
+				break;
+
+			case DOUBLE_ARRAY:
+				result = (*data.doubleArrayValue == *rhs.data.doubleArrayValue);
+				break;
+
+			default:
+				result = (*data.arrayValue == *rhs.data.arrayValue);
+				break;
+			}
+
+		} else {
+			// The storages differ, we compare the elements as values.
+			size_t size = getArraySize();
+			result = (size == rhs.getArraySize());
+
+			for (size_t i = 0; result && i < size; ++i) {
+				result = (getArrayElement(i) == rhs.getArrayElement(i));
+			}
+		}
+
+		return result;
+	}
+
+	bool Value::isArrayLess(const Value &rhs) const {
+		bool result = false;
+
+		if (arrayStorage == rhs.arrayStorage) {
+			switch (arrayStorage) {
+			case INT32_ARRAY:
+				result = (*data.int32ArrayValue < *rhs.data.int32ArrayValue);
+				break;
+
+			case INT64_ARRAY:
+				result = (*data.int64ArrayValue < *rhs.data.int64ArrayValue);
+				break;
+
+			case FLOAT_ARRAY:
+				result = (*data.floatArrayValue < *rhs.data.floatArrayValue);
+				break;
+
+			case DOUBLE_ARRAY:
+				result = (*data.doubleArrayValue < *rhs.data.doubleArrayValue);
+				break;
+
+			default:
+				result = (*data.arrayValue < *rhs.data.arrayValue);
+				break;
+			}
+
+		} else {
+			// The storages differ, we compare the elements as values.
+			size_t size = getArraySize(), rhsSize = rhs.getArraySize();
+			bool decided = false;
+
+			for (size_t i = 0; !decided && i < size && i < rhsSize; ++i) {
+				Value element = getArrayElement(i), rhsElement = rhs.getArrayElement(i);
+
+				if (element < rhsElement) {
+					result = true;
+					decided = true;
+
+				} else if (rhsElement < element) {
+					decided = true;
+				}
+			}
+
+			if (!decided) {
+				result = (size < rhsSize);
+			}
+		}
+
+		return result;
+	}
+
+	void Value::discardSerializedForms() {
+		// The extension itself is kept, a writer or a lazy container being
+		// parsed can hold it.
+		Extension *current = extension.load(std::memory_order_relaxed);
+
+		if (current) {
+			current->serializedForms.clear();
+		}
+	}
+
+	Value::Extension &Value::getExtension() const {
+		Extension *result = extension.load(std::memory_order_acquire);
+
+		if (!result) {
+			// Two threads can race to create it, the loser deletes its own.
+			Extension *created = new Extension();
+
+			if (extension.compare_exchange_strong(result, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				result = created;
+
+			} else {
+				delete created;
+			}
+		}
+
+		return *result;
+	}
+
+	const Value::LazyContainer *Value::getLazyContainer() const {
+		Extension *current = extension.load(std::memory_order_acquire);
+		return (current) ? (current->lazyContainer.load(std::memory_order_acquire)) : (NULL);
+	}
+
+	void Value::output(std::ostream &output, bool indent,
+	                   bool escapeAll, unsigned int threadCount) const {
+		if (threadCount != 1) {
+			if (indent) {
+				if (escapeAll) {
+					ParallelWriter<Pretty<>, AllEscaping>::write(output, *this, threadCount);
+
+				} else {
+					ParallelWriter<Pretty<>, MinimumEscaping>::write(output, *this, threadCount);
+				}
+
+			} else {
+				if (escapeAll) {
+					ParallelWriter<Compact, AllEscaping>::write(output, *this, threadCount);
+
+				} else {
+					ParallelWriter<Compact, MinimumEscaping>::write(output, *this, threadCount);
+				}
+			}
+
+		} else if (indent) {
+			if (escapeAll) {
+				Writer<Pretty<>, AllEscaping>::write(output, *this);
+
+			} else {
+				Writer<Pretty<>, MinimumEscaping>::write(output, *this);
+			}
+
+		} else {
+			if (escapeAll) {
+				Writer<Compact, AllEscaping>::write(output, *this);
+
+			} else {
+				Writer<Compact, MinimumEscaping>::write(output, *this);
+			}
+		}
+	}
+
+	std::ostream &operator<<(std::ostream &output, const Value &v) {
+		Writer<Pretty<>, MinimumEscaping>::write(output, v);
+		return output;
+	}
+
+	std::ostream &operator<<(std::ostream &output, const Array &a) {
+		Writer<Pretty<>, MinimumEscaping>::write(output, a);
+		return output;
+	}
+
+	std::ostream &operator<<(std::ostream &output, const Object &o) {
+		Writer<Pretty<>, MinimumEscaping>::write(output, o);
 		return output;
 	}
 }
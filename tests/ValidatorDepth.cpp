@@ -0,0 +1,88 @@
+#include <iostream>
+#include <string>
+
+#include "JsonBox.h"
+
+namespace {
+	/**
+	 * Builds arrays nested in each other, the innermost one empty.
+	 * @param depth Number of arrays.
+	 * @return JSON of the arrays.
+	 */
+	std::string makeArrays(unsigned int depth) {
+		return std::string(depth, '[').append(depth, ']');
+	}
+
+	/**
+	 * Builds objects nested in each other's "a" member, the innermost one
+	 * empty.
+	 * @param depth Number of objects.
+	 * @return JSON of the objects.
+	 */
+	std::string makeObjects(unsigned int depth) {
+		std::string result;
+
+		for (unsigned int i = 1; i < depth; ++i) {
+			result.append("{\"a\":");
+		}
+
+		return result.append("{}").append(depth - 1, '}');
+	}
+
+	/**
+	 * Checks that the validation, the parser and the value agree on a
+	 * document, without any exception.
+	 * @param json JSON to check.
+	 * @param maximumDepth Maximum nesting depth given to all of them.
+	 * @param expected True if the JSON must be accepted.
+	 * @return True if the check passed.
+	 */
+	bool check(const std::string &json, unsigned int maximumDepth,
+	           bool expected) {
+		bool result = true;
+
+		try {
+			JsonBox::Parser parser;
+			JsonBox::Value value;
+			parser.setMaximumDepth(maximumDepth);
+
+			if (JsonBox::validate(json.data(), json.size(), maximumDepth).valid != expected) {
+				std::cerr << "validate() disagrees at depth " << maximumDepth << ": " << json.substr(0, 16) << std::endl;
+				result = false;
+			}
+
+			if (parser.tryParse(json, value).valid != expected) {
+				std::cerr << "tryParse() disagrees at depth " << maximumDepth << ": " << json.substr(0, 16) << std::endl;
+				result = false;
+			}
+
+			if (maximumDepth == JsonBox::Parser::DEFAULT_MAXIMUM_DEPTH &&
+			    value.tryLoadFromString(json).valid != expected) {
+				std::cerr << "tryLoadFromString() disagrees: " << json.substr(0, 16) << std::endl;
+				result = false;
+			}
+
+		} catch (const std::exception &error) {
+			std::cerr << "Exception at depth " << maximumDepth << ": " << error.what() << std::endl;
+			result = false;
+		}
+
+		return result;
+	}
+}
+
+int main() {
+	const unsigned int depths[] = {1, 4, JsonBox::Parser::DEFAULT_MAXIMUM_DEPTH, JsonBox::MAXIMUM_VALIDATION_DEPTH + 100};
+	bool passed = true;
+
+	for (unsigned int i = 0; i < sizeof(depths) / sizeof(depths[0]); ++i) {
+		// An empty container exactly at the limit is accepted, one level
+		// deeper is rejected.
+		passed = check(makeArrays(depths[i]), depths[i], true) && passed;
+		passed = check(makeArrays(depths[i] + 1), depths[i], false) && passed;
+		passed = check(makeObjects(depths[i]), depths[i], true) && passed;
+		passed = check(makeObjects(depths[i] + 1), depths[i], false) && passed;
+	}
+
+	return (passed) ? (0) : (1);
+}
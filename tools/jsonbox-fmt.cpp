@@ -0,0 +1,147 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "JsonBox.h"
+#include "JsonBox/Reformatter.h"
+
+namespace {
+	/**
+	 * Reformats JSON from an input stream to an output stream.
+	 * @param input Input stream to read the JSON from.
+	 * @param output Output stream to write the JSON to.
+	 * @param style Output style: 'c' for compact, 't' for tabs, '2' or '4'
+	 * for that many spaces.
+	 * @return Number of top-level values written.
+	 */
+	size_t reformatStream(std::istream &input, std::ostream &output, char style) {
+		switch (style) {
+		case 'c':
+			return JsonBox::Reformatter<JsonBox::Compact>::reformat(input, output);
+
+		case '2':
+			return JsonBox::Reformatter<JsonBox::Pretty<2, ' '> >::reformat(input, output);
+
+		case '4':
+			return JsonBox::Reformatter<JsonBox::Pretty<4, ' '> >::reformat(input, output);
+
+		default:
+			return JsonBox::Reformatter<JsonBox::Pretty<> >::reformat(input, output);
+		}
+	}
+
+	/**
+	 * Reformats JSON to an output stream, compressing it if the output
+	 * file's extension asks for it.
+	 * @param input Input stream to read the JSON from.
+	 * @param output Output stream to write the JSON to.
+	 * @param outputPath Path of the output file, empty for the standard
+	 * output.
+	 * @param style Output style.
+	 */
+	void reformatTo(std::istream &input, std::ostream &output,
+	                const std::string &outputPath, char style) {
+		JsonBox::Compression::Format format = JsonBox::Compression::getFormat(outputPath);
+
+		if (format != JsonBox::Compression::NONE) {
+			JsonBox::CompressingOutputStream compressed(output, format);
+
+			if (reformatStream(input, compressed, style) > 0) {
+				compressed.put('\n');
+			}
+
+			compressed.finish();
+
+		} else if (reformatStream(input, output, style) > 0) {
+			output.put('\n');
+		}
+	}
+
+	int usage(const char *program) {
+		std::cerr << "Usage: " << program << " [-c | -t | -2 | -4] [input [output]]" << std::endl
+		          << "Minifies (-c) or indents with tabs (-t, the default) or spaces (-2, -4)" << std::endl
+		          << "the JSON values of the input, without loading them. Reads the standard" << std::endl
+		          << "input and writes the standard output when no files are given. Files" << std::endl
+		          << "ending with \".gz\" or \".zst\" are decompressed or compressed." << std::endl;
+		return 2;
+	}
+}
+
+int main(int argc, const char *argv[]) {
+	char style = 't';
+	int argument = 1;
+
+	std::ios::sync_with_stdio(false);
+
+	if (argument < argc && argv[argument][0] == '-' && argv[argument][1] != '\0') {
+		if (std::strlen(argv[argument]) != 2 || !std::strchr("ct24", argv[argument][1])) {
+			return usage(argv[0]);
+		}
+
+		style = argv[argument++][1];
+	}
+
+	if (argc - argument > 2) {
+		return usage(argv[0]);
+	}
+
+	std::string inputPath = (argument < argc) ? (argv[argument]) : ("-");
+	std::string outputPath = (argument + 1 < argc) ? (argv[argument + 1]) : ("-");
+
+	try {
+		std::ifstream inputFile;
+		std::ofstream outputFile;
+		std::istream *input = &std::cin;
+		std::ostream *output = &std::cout;
+
+		if (inputPath != "-") {
+			inputFile.open(inputPath.c_str(), std::ios::binary | std::ios::in);
+
+			if (!inputFile.is_open()) {
+				std::cerr << argv[0] << ": cannot open " << inputPath << std::endl;
+				return 1;
+			}
+
+			input = &inputFile;
+		}
+
+		if (outputPath != "-") {
+			outputFile.open(outputPath.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+
+			if (!outputFile.is_open()) {
+				std::cerr << argv[0] << ": cannot open " << outputPath << std::endl;
+				return 1;
+			}
+
+			output = &outputFile;
+
+		} else {
+			outputPath.clear();
+		}
+
+		JsonBox::Compression::Format format = JsonBox::Compression::getFormat(inputPath);
+
+		if (format != JsonBox::Compression::NONE) {
+			JsonBox::DecompressingInputStream decompressed(*input, format);
+			reformatTo(decompressed, *output, outputPath, style);
+
+		} else {
+			reformatTo(*input, *output, outputPath, style);
+		}
+
+		output->flush();
+
+		if (!output->good()) {
+			std::cerr << argv[0] << ": cannot write the output" << std::endl;
+			return 1;
+		}
+
+	} catch (const std::exception &error) {
+		std::cout.flush();
+		std::cerr << argv[0] << ": " << error.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}